@@ -10,12 +10,16 @@
 #
 
 CC = gcc
+CXX = g++
 LN = ln
 VERSION = 0.5.0
 CPPFLAGS = -Iinclude
 CFLAGS   = -Wall -Werror -Wextra -fPIE
-SOURCES = src/safe_iop.c
+CXXFLAGS = -std=c++20 -Wall -Werror -Wextra -fPIE
+SOURCES = src/safe_iop.c src/safe_iop_array.c
+LIBS     = -pthread
 ARCH = $(shell uname -s)
+MACHINE = $(shell uname -m)
 LIB_TARGET = so
 # You might want to change this
 LIB_INSTALL_PATH = ""
@@ -28,6 +32,22 @@ askme: examples/askme.c include/safe_iop.h
 manual_tests: lib include/safe_iop.h tests/manual.c
 	$(CC) $(CPPFLAGS) $(CFLAGS) -DNDEBUG=1 tests/manual.c -L$(PWD) -lsafe_iop -o $@
 
+# The array kernels built with only portable C, as for compilers without
+# GCC vector extensions.
+novector_tests: $(SOURCES) include/safe_iop.h tests/manual.c
+	$(CC) $(CPPFLAGS) $(CFLAGS) -DNDEBUG=1 -DSAFE_IOP_NO_VECTOR=1 tests/manual.c $(SOURCES) $(LIBS) -o $@
+
+# The fallbacks for compilers without __int128, on one that has it.
+noint128_tests: $(SOURCES) include/safe_iop.h tests/manual.c
+	$(CC) $(CPPFLAGS) $(CFLAGS) -DNDEBUG=1 -U__SIZEOF_INT128__ tests/manual.c $(SOURCES) $(LIBS) -o $@
+
+# Requires a C++20 compiler.  Does not need the library.
+cxx_tests: include/safe_iop.h include/safe_iop.hpp tests/manual_cxx.cc
+	$(CXX) $(CPPFLAGS) $(CXXFLAGS) -DNDEBUG=1 tests/manual_cxx.cc -o $@
+
+cxx_test: cxx_tests
+	./cxx_tests
+
 speed_tests: src/safe_iop.c include/safe_iop.h tests/manual.c
 	$(CC) $(CPPFLAGS) $(CFLAGS) -DSAFE_IOP_SPEED_TEST=1 -DNDEBUG=1 tests/manual.c -o $@
 
@@ -35,23 +55,50 @@ autotests: utils/metatests.rb
 	ruby -Iutils ./utils/metatests.rb > tests/autotests.c
 	$(CC) $(CPPFLAGS) $(CFLAGS) tests/autotests.c -o autotests
 
-tests: autotests manual_tests
-	LD_LIBRARY_PATH=$(PWD) ./manual_tests && ./autotests
+formula_tests: utils/formula_gen.rb tests/formulas.txt tests/formula_tests.c
+	ruby -Iutils ./utils/formula_gen.rb tests/formulas.txt > tests/formulas.h
+	$(CC) $(CPPFLAGS) $(CFLAGS) -DNDEBUG=1 tests/formula_tests.c -o $@
+
+# The library only runs the variant the CPU resolves to, so each variant is
+# also tested on its own.  avx2_tests skips itself without AVX2.
+sse2_tests: $(SOURCES) include/safe_iop.h tests/manual.c
+	$(CC) $(CPPFLAGS) $(CFLAGS) $(DISPATCH_SSE2) -DNDEBUG=1 tests/manual.c $(SOURCES) $(LIBS) -o $@
+
+avx2_tests: $(SOURCES) include/safe_iop.h tests/manual.c
+	$(CC) $(CPPFLAGS) $(CFLAGS) $(DISPATCH_AVX2) -DNDEBUG=1 tests/manual.c $(SOURCES) $(LIBS) -o $@
+
+ifeq ($(ARCH)-$(MACHINE),Linux-x86_64)
+VARIANT_TESTS = sse2_tests avx2_tests
+endif
+
+tests: autotests manual_tests novector_tests noint128_tests cxx_tests formula_tests $(VARIANT_TESTS)
+	LD_LIBRARY_PATH=$(PWD) ./manual_tests && ./novector_tests && ./noint128_tests && ./cxx_tests && ./formula_tests && ./autotests $(VARIANT_TESTS:%=&& ./%)
 
 speed_test: speed_tests
 	./speed_tests
 
 clean:
-	@rm -f manual_tests autotests tests/autotests.c speed_tests askme libsafe_iop.$(VERSION).dylib libsafe_iop.dylib libsafe_iop.$(VERSION).so libsafe_iop.so 2>/dev/null
+	@rm -f manual_tests novector_tests noint128_tests sse2_tests avx2_tests cxx_tests formula_tests tests/formulas.h autotests tests/autotests.c speed_tests askme libsafe_iop.$(VERSION).dylib libsafe_iop.dylib libsafe_iop.$(VERSION).so libsafe_iop.so safe_iop_array.*.o 2>/dev/null
+
+# On x86-64 Linux the array kernels are built once per instruction set and
+# src/safe_iop_dispatch.c binds each to the best one for the CPU at load
+# time, so a single library runs everywhere without -march=native.
+DISPATCH_SSE2 =
+DISPATCH_AVX2 = -mavx2
 
 # This may be built as a library or directly included in source.
 # Unless support for safe_iopf is needed, header inclusion is enough.
-lib: src/safe_iop.c include/safe_iop.h
+lib: $(SOURCES) src/safe_iop_dispatch.c include/safe_iop.h
 ifeq ($(ARCH),Darwin)
-	$(CC) -dynamiclib -Wl,-headerpad_max_install_names,-undefined,dynamic_lookup,-compatibility_version,$(VERSION),-current_version,$(VERSION),-install_name,$(LIB_INSTALL_PATH)libsafe_iop.$(VERSION).dylib $(LDFLAGS) $(SOURCES) -o libsafe_iop.$(VERSION).dylib
+	$(CC) -dynamiclib -Wl,-headerpad_max_install_names,-undefined,dynamic_lookup,-compatibility_version,$(VERSION),-current_version,$(VERSION),-install_name,$(LIB_INSTALL_PATH)libsafe_iop.$(VERSION).dylib $(LDFLAGS) $(SOURCES) $(LIBS) -o libsafe_iop.$(VERSION).dylib
 	$(LN) -sf libsafe_iop.$(VERSION).dylib libsafe_iop.dylib
+else ifeq ($(ARCH)-$(MACHINE),Linux-x86_64)
+	$(CC) $(CPPFLAGS) $(CFLAGS) -fPIC -fvisibility=hidden $(DISPATCH_SSE2) -DSOP_ARRAY_VARIANT=sse2 -c src/safe_iop_array.c -o safe_iop_array.sse2.o
+	$(CC) $(CPPFLAGS) $(CFLAGS) -fPIC -fvisibility=hidden $(DISPATCH_AVX2) -DSOP_ARRAY_VARIANT=avx2 -c src/safe_iop_array.c -o safe_iop_array.avx2.o
+	$(CC) -shared -Wl,-soname,libsafe_iop.so.$(VERSION) $(CPPFLAGS) $(CFLAGS) $(LDFLAGS) src/safe_iop.c src/safe_iop_dispatch.c safe_iop_array.sse2.o safe_iop_array.avx2.o $(LIBS) -o libsafe_iop.so.$(VERSION)
+	$(LN) -sf libsafe_iop.so.$(VERSION) libsafe_iop.so
 else
-	$(CC) -shared -Wl,-soname,libsafe_iop.so.$(VERSION) $(CPPFLAGS) $(CFLAGS) $(LDFLAGS) $(SOURCES) -o libsafe_iop.so.$(VERSION)
+	$(CC) -shared -Wl,-soname,libsafe_iop.so.$(VERSION) $(CPPFLAGS) $(CFLAGS) $(LDFLAGS) $(SOURCES) $(LIBS) -o libsafe_iop.so.$(VERSION)
 	$(LN) -sf libsafe_iop.so.$(VERSION) libsafe_iop.so
 endif
 
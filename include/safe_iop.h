@@ -24,6 +24,32 @@
  *
  * History:
  * = [next milestone]
+ * - sopf follows C operator precedence and accepts parentheses.  Formats are
+ *   compiled to a stack program first, then evaluated in one pass.
+ * - sopf "#" prefix for wide intermediates with a single final range check
+ * - sopf "<type>=" prefix to name the result type, e.g. "u64=u32*u32"
+ * - sopf_compile and sopf_batch for evaluating one format over arrays
+ * - safe_iop.hpp: sop::sopf<"fmt"> parses formats at compile time (C++20)
+ * - utils/formula_gen.rb compiles named sopf formulas to inline C functions
+ * - sop_window_<type>_t sliding window sums, checks proven away at init
+ * - sop_rescale_u64/s64 a * b / c with an exact 128-bit product
+ * - sop_align_up, sop_ceil_div, sop_round_up_multiple and sop_next_pow2
+ * - sop_neg, sop_abs and sop_absdiff checked unary ops
+ * - sop_muladd and sop_mulsub with a single overflow check
+ * - sop_mul_full_u32/u64 and sop_mulhi double-width products
+ * - sop_add_array_<type>/sop_sub_array_<type> vectorized array kernels
+ * - sop_mul_array_<type> using widening vector multiplies
+ * - sop_sum_<type> checked reductions with per-block overflow checks
+ * - sop_dot_s16/s32/u32 exact dot products into a wider result
+ * - sop_gemm_s16/s32 tiled integer matrix multiply with per-tile checks
+ * - sop_group_sum_u64 grouped sums with per-block overflow checks
+ * - sop_exclusive_scan_<type> checked offset tables from lengths
+ * - sop_parallel_sum_<type>/sop_parallel_exclusive_scan_<type> on pthreads
+ * - sop_narrow_array_<src>_to_<dst> checked array conversions
+ * - sop_<op>_sat_array_<type> saturating 8/16-bit kernels with clamp counts
+ * - SAFE_IOP_NO_VECTOR: portable array kernels, add/sub in 64-bit words
+ * - libsafe_iop.so picks SSE2 or AVX2 array kernels at load time
+ * - sop_v_<op>_<type>x<lanes> checked ops on GCC vectors with lane masks
  * - Use cpp concatenation to minimize code duplication
  * -- E.g., sop_addx no longer expands sop_sadd and sop_uadd at each callsite
  * - Re-namespaced to sop_
@@ -118,14 +144,34 @@
  * E.g.,
  *   sop_iopf(&dst, "u16**+", a, b, c. d);
  * is equivalent to ((a*b)*c)+d all of type u16.
- * This function uses FIFO and not any other order of operations/precedence.
  *
- * The operation must be one of the following:
+ * Operators follow C precedence and are left associative, and any operand
+ * may be a parenthesized sub-expression:
+ *   sopf(&sz, "u32+u32*u32*u32+u32*u32", hdr, w, h, bpp, pal, 4);
+ *   sopf(&dst, "(u32+u32)/u32", a, b, c);
+ * Arguments are always consumed in the order their operands appear in the
+ * format.  Every intermediate result is checked in the leftmost type.
+ * Spaces and tabs between operands and operators are ignored.
+ *
+ * A leading '#' selects wide-intermediate mode.  Operands are not cast to the
+ * leftmost type and every operation is performed in the widest integer type
+ * available (__int128 if supported, intmax_t otherwise).  Only overflow of
+ * that wide type is checked along the way and the final value is checked once
+ * against the leftmost type:
+ *   sopf(&dst, "#u32*u32/u32", a, b, c);  -- a*b may exceed UINT32_MAX
+ *
+ * The result type may be given explicitly as "<type_marker>=" ahead of the
+ * expression (after the '#', if any).  It then takes the place of the
+ * leftmost type: every operand is cast to it, operations are checked in it,
+ * and untyped operands default to it:
+ *   sopf(&dst64, "u64=u32*u32", a, b);    -- a and b are widened first
+ *
+ * The operation must be one of the following (tightest binding first):
  * - *   -- multiplication
  * - /   -- division
- * - -   -- subtraction
- * - +   -- addition
  * - %   -- modulo (remainder)
+ * - +   -- addition
+ * - -   -- subtraction
  * - <<  -- left shift
  * - >>  -- right shift
  *
@@ -142,6 +188,548 @@
  */
 int sopf(void *result, const char *const fmt, ...);
 
+/* sopf_prog_t
+ * A compiled sopf format.  The contents are private to safe_iop.c and are
+ * only given here so that programs may be kept on the stack or in a struct.
+ */
+#define SOPF_MAX_INSNS 64
+
+typedef struct {
+  unsigned char op;    /* private */
+  unsigned char type;  /* private */
+} sopf_insn_t;
+
+typedef struct {
+  int lhs;              /* type all operations are performed in */
+  unsigned int flags;
+  unsigned int nargs;   /* number of operands */
+  unsigned int ninsns;
+  sopf_insn_t insns[SOPF_MAX_INSNS];
+} sopf_prog_t;
+
+/* sopf_compile
+ *
+ * Compiles a sopf format once so that it may be evaluated many times with
+ * sopf_batch.  The format syntax is exactly that of sopf.
+ *
+ * Output:
+ * - Returns 1 on success leaving the program in prog
+ * - Returns 0 if the format is malformed or too long
+ */
+int sopf_compile(sopf_prog_t *prog, const char *const fmt);
+
+/* sopf_batch
+ *
+ * Evaluates a compiled program over n rows of struct-of-arrays input.  Each
+ * remaining argument is a pointer to an array of n values, one array per
+ * operand in the order the operands appear in the format, and of the
+ * operand's type (uint32_t for u32, and so on).  Row i computes the format
+ * over the i-th value of each array exactly as sopf would.
+ *   sopf_compile(&p, "u64=u32*u32+u16");
+ *   failed = sopf_batch(&p, n, sizes, mask, widths, heights, pads);
+ *
+ * The work is done in blocks of rows, one operation at a time across the
+ * block, so the kernel for each operation is picked once per call instead
+ * of once per row.
+ *
+ * Args:
+ * - compiled program
+ * - number of rows
+ * - array of n results of the lhs type
+ * - optional failure bitmap of (n + 7) / 8 bytes.  Bit (i % 8) of byte
+ *   (i / 8) is set if row i failed and cleared otherwise.
+ * - one input array per operand
+ * Output:
+ * - Returns the number of rows that failed.  Results of failed rows are
+ *   left untouched.
+ * - Returns -1 if the program, output, or any input array is invalid, or
+ *   if its scratch space cannot be allocated.
+ */
+ssize_t sopf_batch(const sopf_prog_t *prog, size_t n, void *out,
+                   uint8_t *fail_mask, ...);
+
+/* sop_window_<type>_t
+ * A sliding window over the last values pushed, for running totals over a
+ * stream.  sum and count may be read directly; the other fields are private
+ * and only given here so that windows may be kept on the stack or in a
+ * struct.
+ */
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_window_t(_m, _type) \
+  typedef struct { \
+    _type sum;          /* sum of the values in the window */ \
+    size_t count;       /* number of values in the window */ \
+    _type *buf;         /* private */ \
+    size_t capacity;    /* private */ \
+    size_t head;        /* private: index of the oldest value */ \
+    _type min;          /* private */ \
+    _type max;          /* private */ \
+    int proven;         /* private: no window sum can overflow */ \
+  } sop_window_##_m##_t;
+
+OPAQUE_SAFE_IOP_PREFIX_MACRO_window_t(u32, uint32_t)
+OPAQUE_SAFE_IOP_PREFIX_MACRO_window_t(s32, int32_t)
+OPAQUE_SAFE_IOP_PREFIX_MACRO_window_t(u64, uint64_t)
+OPAQUE_SAFE_IOP_PREFIX_MACRO_window_t(s64, int64_t)
+
+/* sop_window_init_<type>
+ *
+ * Sets up an empty window over caller-owned storage for capacity values,
+ * each of which must lie in [min, max].  If capacity * min and
+ * capacity * max both fit the type then no window sum can overflow, and
+ * push and pop add and subtract without any checks.  Otherwise every
+ * step is checked, as with sop_add and sop_sub.
+ *
+ * Args:
+ * - the window
+ * - storage for capacity values, which must outlive the window
+ * - bounds on the values that will be pushed
+ * Output:
+ * - Returns 1 on success
+ * - Returns 0 if buf is NULL, capacity is 0 or min > max
+ */
+int sop_window_init_u32(sop_window_u32_t *w, uint32_t *buf, size_t capacity,
+                        uint32_t min, uint32_t max);
+int sop_window_init_s32(sop_window_s32_t *w, int32_t *buf, size_t capacity,
+                        int32_t min, int32_t max);
+int sop_window_init_u64(sop_window_u64_t *w, uint64_t *buf, size_t capacity,
+                        uint64_t min, uint64_t max);
+int sop_window_init_s64(sop_window_s64_t *w, int64_t *buf, size_t capacity,
+                        int64_t min, int64_t max);
+
+/* sop_window_push_<type>, sop_window_pop_<type>
+ *
+ * push adds a value as the newest in the window, first dropping the oldest
+ * if the window is full.  pop drops the oldest value, storing it in value
+ * if that is not NULL.  sum is always the exact sum of the values in the
+ * window.
+ *
+ * Output:
+ * - Returns 1 on success
+ * - Returns 0, leaving the window untouched, if the new sum would not fit,
+ *   if a pushed value is outside the window's bounds or if the window to
+ *   pop is empty
+ */
+int sop_window_push_u32(sop_window_u32_t *w, uint32_t value);
+int sop_window_push_s32(sop_window_s32_t *w, int32_t value);
+int sop_window_push_u64(sop_window_u64_t *w, uint64_t value);
+int sop_window_push_s64(sop_window_s64_t *w, int64_t value);
+int sop_window_pop_u32(sop_window_u32_t *w, uint32_t *value);
+int sop_window_pop_s32(sop_window_s32_t *w, int32_t *value);
+int sop_window_pop_u64(sop_window_u64_t *w, uint64_t *value);
+int sop_window_pop_s64(sop_window_s64_t *w, int64_t *value);
+
+/* sop_round_t
+ * Rounding of a quotient that is not exact, for sop_rescale_<type>.
+ */
+typedef enum {
+  SOP_ROUND_ZERO = 0,   /* toward zero */
+  SOP_ROUND_DOWN,       /* toward negative infinity */
+  SOP_ROUND_UP,         /* toward positive infinity */
+  SOP_ROUND_NEAREST     /* to nearest, halfway cases away from zero */
+} sop_round_t;
+
+/* sop_rescale_<type>
+ *
+ * Computes a * b / c, rounded as asked, e.g. to convert a timestamp between
+ * timebases, here from 1/90000 to microseconds:
+ *   sop_rescale_s64(&pts_us, pts, 1000000, 90000, SOP_ROUND_DOWN);
+ * The product a * b is kept exactly in 128 bits (__int128 where the
+ * compiler has it, long multiplication otherwise), so this only fails if
+ * the final result does not fit, unlike sop_mul followed by sop_div.
+ *
+ * Args:
+ * - pointer to the result, or NULL to only check
+ * - a, b and the divisor c
+ * - rounding mode
+ * Output:
+ * - Returns 1 on success leaving the result in out
+ * - Returns 0 if c is 0, the rounding mode is unknown or the result does
+ *   not fit, leaving out untouched
+ */
+int sop_rescale_u64(uint64_t *out, uint64_t a, uint64_t b, uint64_t c,
+                    sop_round_t rounding);
+int sop_rescale_s64(int64_t *out, int64_t a, int64_t b, int64_t c,
+                    sop_round_t rounding);
+
+/* sop_mul_full_<type>
+ *
+ * Computes the complete double-width product a * b as its high and low
+ * halves, for callers doing their own wide arithmetic:
+ *   sop_mul_full_u64(&hi, &lo, hash, n);
+ * The product of two values of a type always fits twice its width, so
+ * this cannot fail.  See sop_mulhix for the high half alone.
+ *
+ * Args:
+ * - pointers to the high and low halves, either may be NULL
+ * - a and b
+ */
+void sop_mul_full_u32(uint32_t *hi, uint32_t *lo, uint32_t a, uint32_t b);
+void sop_mul_full_u64(uint64_t *hi, uint64_t *lo, uint64_t a, uint64_t b);
+
+/* sop_<op>_array_<type>
+ *
+ * Element-wise checked operations over arrays:
+ *   dst[i] = a[i] <op> b[i] for i in [0, n)
+ * The arrays are processed many elements at a time with vector
+ * instructions (SSE2 or AVX2, whichever the target has) and overflow is
+ * detected for all lanes at once.  The x86-64 Linux shared library carries
+ * both and picks one for the CPU when it is loaded.  Compilers without GCC
+ * vector extensions, or builds with SAFE_IOP_NO_VECTOR defined, add and
+ * subtract 8- and 16-bit elements eight or four at a time in 64-bit words
+ * instead.
+ * The result is exactly that of calling the same-type macro (sop_uadd,
+ * sop_sadd, ...) on each element in order and stopping at the first
+ * failure.
+ *
+ * Args:
+ * - destination array, or NULL to only check.  It may be the same array as
+ *   a or b but must not otherwise overlap them.
+ * - left and right operand arrays
+ * - number of elements
+ * - optional pointer to the first failing index
+ * Output:
+ * - Returns 1 if every element succeeded
+ * - Returns 0 on the first failure, leaving its index in fail_index.  dst
+ *   holds the results before that index and is untouched from it on.
+ * Caveats:
+ * - Only provided if safe_iop_array.c is compiled and linked into the
+ *   source (it is part of libsafe_iop).
+ */
+int sop_add_array_u8(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                     size_t n, size_t *fail_index);
+int sop_add_array_s8(int8_t *dst, const int8_t *a, const int8_t *b,
+                     size_t n, size_t *fail_index);
+int sop_add_array_u16(uint16_t *dst, const uint16_t *a, const uint16_t *b,
+                      size_t n, size_t *fail_index);
+int sop_add_array_s16(int16_t *dst, const int16_t *a, const int16_t *b,
+                      size_t n, size_t *fail_index);
+int sop_add_array_u32(uint32_t *dst, const uint32_t *a, const uint32_t *b,
+                      size_t n, size_t *fail_index);
+int sop_add_array_s32(int32_t *dst, const int32_t *a, const int32_t *b,
+                      size_t n, size_t *fail_index);
+int sop_add_array_u64(uint64_t *dst, const uint64_t *a, const uint64_t *b,
+                      size_t n, size_t *fail_index);
+int sop_add_array_s64(int64_t *dst, const int64_t *a, const int64_t *b,
+                      size_t n, size_t *fail_index);
+
+int sop_sub_array_u8(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                     size_t n, size_t *fail_index);
+int sop_sub_array_s8(int8_t *dst, const int8_t *a, const int8_t *b,
+                     size_t n, size_t *fail_index);
+int sop_sub_array_u16(uint16_t *dst, const uint16_t *a, const uint16_t *b,
+                      size_t n, size_t *fail_index);
+int sop_sub_array_s16(int16_t *dst, const int16_t *a, const int16_t *b,
+                      size_t n, size_t *fail_index);
+int sop_sub_array_u32(uint32_t *dst, const uint32_t *a, const uint32_t *b,
+                      size_t n, size_t *fail_index);
+int sop_sub_array_s32(int32_t *dst, const int32_t *a, const int32_t *b,
+                      size_t n, size_t *fail_index);
+int sop_sub_array_u64(uint64_t *dst, const uint64_t *a, const uint64_t *b,
+                      size_t n, size_t *fail_index);
+int sop_sub_array_s64(int64_t *dst, const int64_t *a, const int64_t *b,
+                      size_t n, size_t *fail_index);
+
+/* Multiplication widens each lane to twice its width, multiplies exactly
+ * and checks the high half.  64-bit elements are not vectorized but use an
+ * exact 128-bit product where the compiler provides one. */
+int sop_mul_array_u8(uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                     size_t n, size_t *fail_index);
+int sop_mul_array_s8(int8_t *dst, const int8_t *a, const int8_t *b,
+                     size_t n, size_t *fail_index);
+int sop_mul_array_u16(uint16_t *dst, const uint16_t *a, const uint16_t *b,
+                      size_t n, size_t *fail_index);
+int sop_mul_array_s16(int16_t *dst, const int16_t *a, const int16_t *b,
+                      size_t n, size_t *fail_index);
+int sop_mul_array_u32(uint32_t *dst, const uint32_t *a, const uint32_t *b,
+                      size_t n, size_t *fail_index);
+int sop_mul_array_s32(int32_t *dst, const int32_t *a, const int32_t *b,
+                      size_t n, size_t *fail_index);
+int sop_mul_array_u64(uint64_t *dst, const uint64_t *a, const uint64_t *b,
+                      size_t n, size_t *fail_index);
+int sop_mul_array_s64(int64_t *dst, const int64_t *a, const int64_t *b,
+                      size_t n, size_t *fail_index);
+
+/* sop_sum_<type>
+ *
+ * Sums n elements of an array in its own type.  Succeeds exactly when the
+ * serial chain sop_add(&total, total, a[i]) would, including signed sums
+ * that only overflow part way through.  Elements are accumulated unchecked
+ * into wide lanes and the running total is only checked once per block.
+ *
+ * Args:
+ * - pointer to the total, or NULL to only check
+ * - array and number of elements.  An empty array sums to 0.
+ * Output:
+ * - Returns 1 on success leaving the total in result
+ * - Returns 0 on overflow leaving result untouched
+ */
+int sop_sum_u8(uint8_t *result, const uint8_t *a, size_t n);
+int sop_sum_s8(int8_t *result, const int8_t *a, size_t n);
+int sop_sum_u16(uint16_t *result, const uint16_t *a, size_t n);
+int sop_sum_s16(int16_t *result, const int16_t *a, size_t n);
+int sop_sum_u32(uint32_t *result, const uint32_t *a, size_t n);
+int sop_sum_s32(int32_t *result, const int32_t *a, size_t n);
+int sop_sum_u64(uint64_t *result, const uint64_t *a, size_t n);
+int sop_sum_s64(int64_t *result, const int64_t *a, size_t n);
+
+/* sop_dot_<type>
+ *
+ * Computes the dot product sum(a[i] * b[i]) into a result twice as wide as
+ * the elements.  The products and their sum are computed exactly, so this
+ * fails only if the final sum does not fit the result type.  Products are
+ * accumulated with widening multiply-adds and only checked once per block.
+ *
+ * Args:
+ * - pointer to the sum, or NULL to only check
+ * - the two arrays and their common number of elements.  Empty arrays
+ *   give 0.
+ * Output:
+ * - Returns 1 on success leaving the sum in result
+ * - Returns 0 on overflow leaving result untouched
+ */
+int sop_dot_s16(int32_t *result, const int16_t *a, const int16_t *b,
+                size_t n);
+int sop_dot_s32(int64_t *result, const int32_t *a, const int32_t *b,
+                size_t n);
+int sop_dot_u32(uint64_t *result, const uint32_t *a, const uint32_t *b,
+                size_t n);
+
+/* sop_gemm_<type>
+ *
+ * Checked integer matrix multiply C = A x B.  Each element of C is the
+ * exact sum of its products, computed as by sop_dot_<type> into elements
+ * twice as wide as those of A and B, so this fails only if an element of C
+ * does not fit.  C is computed in cache-sized tiles with wide accumulators
+ * and each tile is range checked once rather than per multiply-add.
+ *
+ * Args:
+ * - C, m x n, or NULL to only check
+ * - A, m x k, and B, k x n
+ * - m, n and k.  All matrices are dense and row-major.
+ * Output:
+ * - Returns 1 on success with all of C written
+ * - Returns 0 if an element of C does not fit.  C may then be partly
+ *   written.
+ */
+int sop_gemm_s16(int32_t *c, const int16_t *a, const int16_t *b,
+                 size_t m, size_t n, size_t k);
+int sop_gemm_s32(int64_t *c, const int32_t *a, const int32_t *b,
+                 size_t m, size_t n, size_t k);
+
+/* sop_exclusive_scan_<type>
+ *
+ * Turns an array of lengths into an array of offsets: out[0] is 0 and each
+ * out[i] is the sum of lengths[0] through lengths[i - 1].  Fails as soon as
+ * an offset, including the end offset out[n - 1] + lengths[n - 1], would
+ * overflow, so the end offset may be computed unchecked afterwards.
+ *
+ * Args:
+ * - the offsets array, which may be the lengths array itself
+ * - the lengths array and number of elements
+ * Output:
+ * - Returns 1 on success with all n offsets written
+ * - Returns 0 on overflow.  The offsets that fit are written and the rest
+ *   of out is left untouched.
+ */
+int sop_exclusive_scan_u32(uint32_t *out, const uint32_t *lengths, size_t n);
+int sop_exclusive_scan_u64(uint64_t *out, const uint64_t *lengths, size_t n);
+int sop_exclusive_scan_size_t(size_t *out, const size_t *lengths, size_t n);
+
+/* sop_group_sum_u64
+ *
+ * Adds values[i] into out[keys[i]] for i in [0, n), as a GROUP BY sum into
+ * running per-group totals.  The result is exactly that of calling sop_uadd
+ * on each row in order and stopping at the first failure.  Rows are added a
+ * block at a time with the carries collected unchecked, and only a block
+ * in which some total passed UINT64_MAX is replayed row by row.
+ *
+ * Args:
+ * - keys and values arrays and their number of rows
+ * - the group totals and their number.  Totals are added to, not cleared.
+ * - optional pointer to the first failing row
+ * Output:
+ * - Returns 1 if every row was added
+ * - Returns 0 on the first row that overflows its total or whose key is
+ *   not below ngroups, leaving its index in fail_index.  out then holds
+ *   the totals of the rows before it.
+ */
+int sop_group_sum_u64(const uint32_t *keys, const uint64_t *values, size_t n,
+                      uint64_t *out, size_t ngroups, size_t *fail_index);
+
+/* sop_parallel_set
+ *
+ * Configures the sop_parallel_* functions below.  Not thread-safe; call it
+ * before starting any parallel work.
+ *
+ * Args:
+ * - the number of threads, including the caller, or 0 for one per online
+ *   CPU (the default)
+ * - the least number of elements worth giving a thread, or 0 for the
+ *   default of 2^20.  Arrays shorter than two grains run on the caller.
+ */
+void sop_parallel_set(unsigned int threads, size_t grain);
+
+/* sop_parallel_sum_<type>, sop_parallel_exclusive_scan_<type>
+ *
+ * Same arguments and results as sop_sum_<type> and
+ * sop_exclusive_scan_<type>, including exactly when they fail, but the
+ * array is split across threads.  Each thread summarizes its part in 128
+ * bits and the parts are combined in order with checked adds, so the result
+ * does not depend on the number of threads.  Falls back to the serial
+ * function if no threads can be started.
+ */
+int sop_parallel_sum_u8(uint8_t *result, const uint8_t *a, size_t n);
+int sop_parallel_sum_s8(int8_t *result, const int8_t *a, size_t n);
+int sop_parallel_sum_u16(uint16_t *result, const uint16_t *a, size_t n);
+int sop_parallel_sum_s16(int16_t *result, const int16_t *a, size_t n);
+int sop_parallel_sum_u32(uint32_t *result, const uint32_t *a, size_t n);
+int sop_parallel_sum_s32(int32_t *result, const int32_t *a, size_t n);
+int sop_parallel_sum_u64(uint64_t *result, const uint64_t *a, size_t n);
+int sop_parallel_sum_s64(int64_t *result, const int64_t *a, size_t n);
+int sop_parallel_exclusive_scan_u32(uint32_t *out, const uint32_t *lengths,
+                                    size_t n);
+int sop_parallel_exclusive_scan_u64(uint64_t *out, const uint64_t *lengths,
+                                    size_t n);
+int sop_parallel_exclusive_scan_size_t(size_t *out, const size_t *lengths,
+                                       size_t n);
+
+/* sop_narrow_array_<src>_to_<dst>
+ *
+ * Converts an array to another integer type, accepting exactly the values
+ * sop_safe_cast accepts.  Provided for every pair of types where some
+ * values do not fit: narrowing, same-width sign changes and signed to wider
+ * unsigned.  Whole blocks are range checked with a few vector operations
+ * before being packed into the destination type.
+ *
+ * Args:
+ * - destination array, or NULL to only check
+ * - source array and number of elements
+ * - optional pointer to the first failing index
+ * Output:
+ * - Returns 1 if every element fit
+ * - Returns 0 on the first element that does not, leaving its index in
+ *   fail_index.  dst holds the converted elements before that index and is
+ *   untouched from it on.
+ */
+int sop_narrow_array_u8_to_s8(int8_t *dst, const uint8_t *src, size_t n,
+                              size_t *fail_index);
+int sop_narrow_array_s8_to_u8(uint8_t *dst, const int8_t *src, size_t n,
+                              size_t *fail_index);
+int sop_narrow_array_s8_to_u16(uint16_t *dst, const int8_t *src, size_t n,
+                               size_t *fail_index);
+int sop_narrow_array_s8_to_u32(uint32_t *dst, const int8_t *src, size_t n,
+                               size_t *fail_index);
+int sop_narrow_array_s8_to_u64(uint64_t *dst, const int8_t *src, size_t n,
+                               size_t *fail_index);
+int sop_narrow_array_u16_to_u8(uint8_t *dst, const uint16_t *src, size_t n,
+                               size_t *fail_index);
+int sop_narrow_array_u16_to_s8(int8_t *dst, const uint16_t *src, size_t n,
+                               size_t *fail_index);
+int sop_narrow_array_u16_to_s16(int16_t *dst, const uint16_t *src, size_t n,
+                                size_t *fail_index);
+int sop_narrow_array_s16_to_u8(uint8_t *dst, const int16_t *src, size_t n,
+                               size_t *fail_index);
+int sop_narrow_array_s16_to_s8(int8_t *dst, const int16_t *src, size_t n,
+                               size_t *fail_index);
+int sop_narrow_array_s16_to_u16(uint16_t *dst, const int16_t *src, size_t n,
+                                size_t *fail_index);
+int sop_narrow_array_s16_to_u32(uint32_t *dst, const int16_t *src, size_t n,
+                                size_t *fail_index);
+int sop_narrow_array_s16_to_u64(uint64_t *dst, const int16_t *src, size_t n,
+                                size_t *fail_index);
+int sop_narrow_array_u32_to_u8(uint8_t *dst, const uint32_t *src, size_t n,
+                               size_t *fail_index);
+int sop_narrow_array_u32_to_s8(int8_t *dst, const uint32_t *src, size_t n,
+                               size_t *fail_index);
+int sop_narrow_array_u32_to_u16(uint16_t *dst, const uint32_t *src, size_t n,
+                                size_t *fail_index);
+int sop_narrow_array_u32_to_s16(int16_t *dst, const uint32_t *src, size_t n,
+                                size_t *fail_index);
+int sop_narrow_array_u32_to_s32(int32_t *dst, const uint32_t *src, size_t n,
+                                size_t *fail_index);
+int sop_narrow_array_s32_to_u8(uint8_t *dst, const int32_t *src, size_t n,
+                               size_t *fail_index);
+int sop_narrow_array_s32_to_s8(int8_t *dst, const int32_t *src, size_t n,
+                               size_t *fail_index);
+int sop_narrow_array_s32_to_u16(uint16_t *dst, const int32_t *src, size_t n,
+                                size_t *fail_index);
+int sop_narrow_array_s32_to_s16(int16_t *dst, const int32_t *src, size_t n,
+                                size_t *fail_index);
+int sop_narrow_array_s32_to_u32(uint32_t *dst, const int32_t *src, size_t n,
+                                size_t *fail_index);
+int sop_narrow_array_s32_to_u64(uint64_t *dst, const int32_t *src, size_t n,
+                                size_t *fail_index);
+int sop_narrow_array_u64_to_u8(uint8_t *dst, const uint64_t *src, size_t n,
+                               size_t *fail_index);
+int sop_narrow_array_u64_to_s8(int8_t *dst, const uint64_t *src, size_t n,
+                               size_t *fail_index);
+int sop_narrow_array_u64_to_u16(uint16_t *dst, const uint64_t *src, size_t n,
+                                size_t *fail_index);
+int sop_narrow_array_u64_to_s16(int16_t *dst, const uint64_t *src, size_t n,
+                                size_t *fail_index);
+int sop_narrow_array_u64_to_u32(uint32_t *dst, const uint64_t *src, size_t n,
+                                size_t *fail_index);
+int sop_narrow_array_u64_to_s32(int32_t *dst, const uint64_t *src, size_t n,
+                                size_t *fail_index);
+int sop_narrow_array_u64_to_s64(int64_t *dst, const uint64_t *src, size_t n,
+                                size_t *fail_index);
+int sop_narrow_array_s64_to_u8(uint8_t *dst, const int64_t *src, size_t n,
+                               size_t *fail_index);
+int sop_narrow_array_s64_to_s8(int8_t *dst, const int64_t *src, size_t n,
+                               size_t *fail_index);
+int sop_narrow_array_s64_to_u16(uint16_t *dst, const int64_t *src, size_t n,
+                                size_t *fail_index);
+int sop_narrow_array_s64_to_s16(int16_t *dst, const int64_t *src, size_t n,
+                                size_t *fail_index);
+int sop_narrow_array_s64_to_u32(uint32_t *dst, const int64_t *src, size_t n,
+                                size_t *fail_index);
+int sop_narrow_array_s64_to_s32(int32_t *dst, const int64_t *src, size_t n,
+                                size_t *fail_index);
+int sop_narrow_array_s64_to_u64(uint64_t *dst, const int64_t *src, size_t n,
+                                size_t *fail_index);
+
+/* sop_<op>_sat_array_<type>
+ *
+ * Saturating add, sub and mul over 8- and 16-bit arrays: each result is
+ * clamped to the range of the type instead of failing.  Adds and subtracts
+ * use the native saturating vector instructions; products are computed
+ * exactly in wider lanes and clamped.
+ *
+ * Args:
+ * - destination array, which may be a or b, or NULL to only count
+ * - left and right operand arrays
+ * - number of elements
+ * Output:
+ * - Returns the number of elements that were clamped (0 if the arithmetic
+ *   was exact everywhere)
+ */
+size_t sop_add_sat_array_u8(uint8_t *dst, const uint8_t *a,
+                            const uint8_t *b, size_t n);
+size_t sop_add_sat_array_s8(int8_t *dst, const int8_t *a,
+                            const int8_t *b, size_t n);
+size_t sop_add_sat_array_u16(uint16_t *dst, const uint16_t *a,
+                             const uint16_t *b, size_t n);
+size_t sop_add_sat_array_s16(int16_t *dst, const int16_t *a,
+                             const int16_t *b, size_t n);
+
+size_t sop_sub_sat_array_u8(uint8_t *dst, const uint8_t *a,
+                            const uint8_t *b, size_t n);
+size_t sop_sub_sat_array_s8(int8_t *dst, const int8_t *a,
+                            const int8_t *b, size_t n);
+size_t sop_sub_sat_array_u16(uint16_t *dst, const uint16_t *a,
+                             const uint16_t *b, size_t n);
+size_t sop_sub_sat_array_s16(int16_t *dst, const int16_t *a,
+                             const int16_t *b, size_t n);
+
+size_t sop_mul_sat_array_u8(uint8_t *dst, const uint8_t *a,
+                            const uint8_t *b, size_t n);
+size_t sop_mul_sat_array_s8(int8_t *dst, const int8_t *a,
+                            const int8_t *b, size_t n);
+size_t sop_mul_sat_array_u16(uint16_t *dst, const uint16_t *a,
+                             const uint16_t *b, size_t n);
+size_t sop_mul_sat_array_s16(int16_t *dst, const int16_t *a,
+                             const int16_t *b, size_t n);
+
 
 /* Type markup macros
  * These macros are the user mechanism for marking up
@@ -171,6 +759,16 @@ int sopf(void *result, const char *const fmt, ...);
 #define sop_mod_sop_s8(_a) sop_smod
 #define sop_shl_sop_s8(_a) sop_sshl
 #define sop_shr_sop_s8(_a) sop_sshr
+#define sop_align_up_sop_s8(_a) sop_salign_up
+#define sop_ceil_div_sop_s8(_a) sop_sceil_div
+#define sop_round_up_multiple_sop_s8(_a) sop_sround_up_multiple
+#define sop_next_pow2_sop_s8(_a) sop_snext_pow2
+#define sop_neg_sop_s8(_a) sop_sneg
+#define sop_abs_sop_s8(_a) sop_sabs
+#define sop_absdiff_sop_s8(_a) sop_sabsdiff
+#define sop_muladd_sop_s8(_a) sop_smuladd
+#define sop_mulsub_sop_s8(_a) sop_smulsub
+#define sop_mulhi_sop_s8(_a) sop_smulhi
 
 
 #define sop_typeof_sop_u8(_a) uint8_t
@@ -183,6 +781,16 @@ int sopf(void *result, const char *const fmt, ...);
 #define sop_mod_sop_u8(_a) sop_umod
 #define sop_shl_sop_u8(_a) sop_ushl
 #define sop_shr_sop_u8(_a) sop_ushr
+#define sop_align_up_sop_u8(_a) sop_ualign_up
+#define sop_ceil_div_sop_u8(_a) sop_uceil_div
+#define sop_round_up_multiple_sop_u8(_a) sop_uround_up_multiple
+#define sop_next_pow2_sop_u8(_a) sop_unext_pow2
+#define sop_neg_sop_u8(_a) sop_uneg
+#define sop_abs_sop_u8(_a) sop_uabs
+#define sop_absdiff_sop_u8(_a) sop_uabsdiff
+#define sop_muladd_sop_u8(_a) sop_umuladd
+#define sop_mulsub_sop_u8(_a) sop_umulsub
+#define sop_mulhi_sop_u8(_a) sop_umulhi
 
 
 
@@ -196,6 +804,16 @@ int sopf(void *result, const char *const fmt, ...);
 #define sop_mod_sop_s16(_a) sop_smod
 #define sop_shl_sop_s16(_a) sop_sshl
 #define sop_shr_sop_s16(_a) sop_sshr
+#define sop_align_up_sop_s16(_a) sop_salign_up
+#define sop_ceil_div_sop_s16(_a) sop_sceil_div
+#define sop_round_up_multiple_sop_s16(_a) sop_sround_up_multiple
+#define sop_next_pow2_sop_s16(_a) sop_snext_pow2
+#define sop_neg_sop_s16(_a) sop_sneg
+#define sop_abs_sop_s16(_a) sop_sabs
+#define sop_absdiff_sop_s16(_a) sop_sabsdiff
+#define sop_muladd_sop_s16(_a) sop_smuladd
+#define sop_mulsub_sop_s16(_a) sop_smulsub
+#define sop_mulhi_sop_s16(_a) sop_smulhi
 
 
 #define sop_typeof_sop_u16(_a) uint16_t
@@ -208,6 +826,16 @@ int sopf(void *result, const char *const fmt, ...);
 #define sop_mod_sop_u16(_a) sop_umod
 #define sop_shl_sop_u16(_a) sop_ushl
 #define sop_shr_sop_u16(_a) sop_ushr
+#define sop_align_up_sop_u16(_a) sop_ualign_up
+#define sop_ceil_div_sop_u16(_a) sop_uceil_div
+#define sop_round_up_multiple_sop_u16(_a) sop_uround_up_multiple
+#define sop_next_pow2_sop_u16(_a) sop_unext_pow2
+#define sop_neg_sop_u16(_a) sop_uneg
+#define sop_abs_sop_u16(_a) sop_uabs
+#define sop_absdiff_sop_u16(_a) sop_uabsdiff
+#define sop_muladd_sop_u16(_a) sop_umuladd
+#define sop_mulsub_sop_u16(_a) sop_umulsub
+#define sop_mulhi_sop_u16(_a) sop_umulhi
 
 
 
@@ -221,6 +849,16 @@ int sopf(void *result, const char *const fmt, ...);
 #define sop_mod_sop_s32(_a) sop_smod
 #define sop_shl_sop_s32(_a) sop_sshl
 #define sop_shr_sop_s32(_a) sop_sshr
+#define sop_align_up_sop_s32(_a) sop_salign_up
+#define sop_ceil_div_sop_s32(_a) sop_sceil_div
+#define sop_round_up_multiple_sop_s32(_a) sop_sround_up_multiple
+#define sop_next_pow2_sop_s32(_a) sop_snext_pow2
+#define sop_neg_sop_s32(_a) sop_sneg
+#define sop_abs_sop_s32(_a) sop_sabs
+#define sop_absdiff_sop_s32(_a) sop_sabsdiff
+#define sop_muladd_sop_s32(_a) sop_smuladd
+#define sop_mulsub_sop_s32(_a) sop_smulsub
+#define sop_mulhi_sop_s32(_a) sop_smulhi
 
 
 #define sop_typeof_sop_u32(_a) uint32_t
@@ -233,6 +871,16 @@ int sopf(void *result, const char *const fmt, ...);
 #define sop_mod_sop_u32(_a) sop_umod
 #define sop_shl_sop_u32(_a) sop_ushl
 #define sop_shr_sop_u32(_a) sop_ushr
+#define sop_align_up_sop_u32(_a) sop_ualign_up
+#define sop_ceil_div_sop_u32(_a) sop_uceil_div
+#define sop_round_up_multiple_sop_u32(_a) sop_uround_up_multiple
+#define sop_next_pow2_sop_u32(_a) sop_unext_pow2
+#define sop_neg_sop_u32(_a) sop_uneg
+#define sop_abs_sop_u32(_a) sop_uabs
+#define sop_absdiff_sop_u32(_a) sop_uabsdiff
+#define sop_muladd_sop_u32(_a) sop_umuladd
+#define sop_mulsub_sop_u32(_a) sop_umulsub
+#define sop_mulhi_sop_u32(_a) sop_umulhi
 
 
 
@@ -246,6 +894,16 @@ int sopf(void *result, const char *const fmt, ...);
 #define sop_mod_sop_s64(_a) sop_smod
 #define sop_shl_sop_s64(_a) sop_sshl
 #define sop_shr_sop_s64(_a) sop_sshr
+#define sop_align_up_sop_s64(_a) sop_salign_up
+#define sop_ceil_div_sop_s64(_a) sop_sceil_div
+#define sop_round_up_multiple_sop_s64(_a) sop_sround_up_multiple
+#define sop_next_pow2_sop_s64(_a) sop_snext_pow2
+#define sop_neg_sop_s64(_a) sop_sneg
+#define sop_abs_sop_s64(_a) sop_sabs
+#define sop_absdiff_sop_s64(_a) sop_sabsdiff
+#define sop_muladd_sop_s64(_a) sop_smuladd
+#define sop_mulsub_sop_s64(_a) sop_smulsub
+#define sop_mulhi_sop_s64(_a) sop_smulhi
 
 
 #define sop_typeof_sop_u64(_a) uint64_t
@@ -258,6 +916,16 @@ int sopf(void *result, const char *const fmt, ...);
 #define sop_mod_sop_u64(_a) sop_umod
 #define sop_shl_sop_u64(_a) sop_ushl
 #define sop_shr_sop_u64(_a) sop_ushr
+#define sop_align_up_sop_u64(_a) sop_ualign_up
+#define sop_ceil_div_sop_u64(_a) sop_uceil_div
+#define sop_round_up_multiple_sop_u64(_a) sop_uround_up_multiple
+#define sop_next_pow2_sop_u64(_a) sop_unext_pow2
+#define sop_neg_sop_u64(_a) sop_uneg
+#define sop_abs_sop_u64(_a) sop_uabs
+#define sop_absdiff_sop_u64(_a) sop_uabsdiff
+#define sop_muladd_sop_u64(_a) sop_umuladd
+#define sop_mulsub_sop_u64(_a) sop_umulsub
+#define sop_mulhi_sop_u64(_a) sop_umulhi
 
 
 
@@ -271,6 +939,16 @@ int sopf(void *result, const char *const fmt, ...);
 #define sop_mod_sop_sl(_a) sop_smod
 #define sop_shl_sop_sl(_a) sop_sshl
 #define sop_shr_sop_sl(_a) sop_sshr
+#define sop_align_up_sop_sl(_a) sop_salign_up
+#define sop_ceil_div_sop_sl(_a) sop_sceil_div
+#define sop_round_up_multiple_sop_sl(_a) sop_sround_up_multiple
+#define sop_next_pow2_sop_sl(_a) sop_snext_pow2
+#define sop_neg_sop_sl(_a) sop_sneg
+#define sop_abs_sop_sl(_a) sop_sabs
+#define sop_absdiff_sop_sl(_a) sop_sabsdiff
+#define sop_muladd_sop_sl(_a) sop_smuladd
+#define sop_mulsub_sop_sl(_a) sop_smulsub
+#define sop_mulhi_sop_sl(_a) sop_smulhi
 
 
 #define sop_typeof_sop_ul(_a) unsigned long
@@ -283,6 +961,16 @@ int sopf(void *result, const char *const fmt, ...);
 #define sop_mod_sop_ul(_a) sop_umod
 #define sop_shl_sop_ul(_a) sop_ushl
 #define sop_shr_sop_ul(_a) sop_ushr
+#define sop_align_up_sop_ul(_a) sop_ualign_up
+#define sop_ceil_div_sop_ul(_a) sop_uceil_div
+#define sop_round_up_multiple_sop_ul(_a) sop_uround_up_multiple
+#define sop_next_pow2_sop_ul(_a) sop_unext_pow2
+#define sop_neg_sop_ul(_a) sop_uneg
+#define sop_abs_sop_ul(_a) sop_uabs
+#define sop_absdiff_sop_ul(_a) sop_uabsdiff
+#define sop_muladd_sop_ul(_a) sop_umuladd
+#define sop_mulsub_sop_ul(_a) sop_umulsub
+#define sop_mulhi_sop_ul(_a) sop_umulhi
 
 
 
@@ -296,6 +984,16 @@ int sopf(void *result, const char *const fmt, ...);
 #define sop_mod_sop_sll(_a) sop_smod
 #define sop_shl_sop_sll(_a) sop_sshl
 #define sop_shr_sop_sll(_a) sop_sshr
+#define sop_align_up_sop_sll(_a) sop_salign_up
+#define sop_ceil_div_sop_sll(_a) sop_sceil_div
+#define sop_round_up_multiple_sop_sll(_a) sop_sround_up_multiple
+#define sop_next_pow2_sop_sll(_a) sop_snext_pow2
+#define sop_neg_sop_sll(_a) sop_sneg
+#define sop_abs_sop_sll(_a) sop_sabs
+#define sop_absdiff_sop_sll(_a) sop_sabsdiff
+#define sop_muladd_sop_sll(_a) sop_smuladd
+#define sop_mulsub_sop_sll(_a) sop_smulsub
+#define sop_mulhi_sop_sll(_a) sop_smulhi
 
 
 #define sop_typeof_sop_ull(_a) unsigned long long
@@ -308,6 +1006,16 @@ int sopf(void *result, const char *const fmt, ...);
 #define sop_mod_sop_ull(_a) sop_umod
 #define sop_shl_sop_ull(_a) sop_ushl
 #define sop_shr_sop_ull(_a) sop_ushr
+#define sop_align_up_sop_ull(_a) sop_ualign_up
+#define sop_ceil_div_sop_ull(_a) sop_uceil_div
+#define sop_round_up_multiple_sop_ull(_a) sop_uround_up_multiple
+#define sop_next_pow2_sop_ull(_a) sop_unext_pow2
+#define sop_neg_sop_ull(_a) sop_uneg
+#define sop_abs_sop_ull(_a) sop_uabs
+#define sop_absdiff_sop_ull(_a) sop_uabsdiff
+#define sop_muladd_sop_ull(_a) sop_umuladd
+#define sop_mulsub_sop_ull(_a) sop_umulsub
+#define sop_mulhi_sop_ull(_a) sop_umulhi
 
 
 
@@ -321,6 +1029,16 @@ int sopf(void *result, const char *const fmt, ...);
 #define sop_mod_sop_si(_a) sop_smod
 #define sop_shl_sop_si(_a) sop_sshl
 #define sop_shr_sop_si(_a) sop_sshr
+#define sop_align_up_sop_si(_a) sop_salign_up
+#define sop_ceil_div_sop_si(_a) sop_sceil_div
+#define sop_round_up_multiple_sop_si(_a) sop_sround_up_multiple
+#define sop_next_pow2_sop_si(_a) sop_snext_pow2
+#define sop_neg_sop_si(_a) sop_sneg
+#define sop_abs_sop_si(_a) sop_sabs
+#define sop_absdiff_sop_si(_a) sop_sabsdiff
+#define sop_muladd_sop_si(_a) sop_smuladd
+#define sop_mulsub_sop_si(_a) sop_smulsub
+#define sop_mulhi_sop_si(_a) sop_smulhi
 
 
 #define sop_typeof_sop_ui(_a) unsigned int
@@ -333,6 +1051,16 @@ int sopf(void *result, const char *const fmt, ...);
 #define sop_mod_sop_ui(_a) sop_umod
 #define sop_shl_sop_ui(_a) sop_ushl
 #define sop_shr_sop_ui(_a) sop_ushr
+#define sop_align_up_sop_ui(_a) sop_ualign_up
+#define sop_ceil_div_sop_ui(_a) sop_uceil_div
+#define sop_round_up_multiple_sop_ui(_a) sop_uround_up_multiple
+#define sop_next_pow2_sop_ui(_a) sop_unext_pow2
+#define sop_neg_sop_ui(_a) sop_uneg
+#define sop_abs_sop_ui(_a) sop_uabs
+#define sop_absdiff_sop_ui(_a) sop_uabsdiff
+#define sop_muladd_sop_ui(_a) sop_umuladd
+#define sop_mulsub_sop_ui(_a) sop_umulsub
+#define sop_mulhi_sop_ui(_a) sop_umulhi
 
 
 
@@ -346,6 +1074,16 @@ int sopf(void *result, const char *const fmt, ...);
 #define sop_mod_sop_sc(_a) sop_smod
 #define sop_shl_sop_sc(_a) sop_sshl
 #define sop_shr_sop_sc(_a) sop_sshr
+#define sop_align_up_sop_sc(_a) sop_salign_up
+#define sop_ceil_div_sop_sc(_a) sop_sceil_div
+#define sop_round_up_multiple_sop_sc(_a) sop_sround_up_multiple
+#define sop_next_pow2_sop_sc(_a) sop_snext_pow2
+#define sop_neg_sop_sc(_a) sop_sneg
+#define sop_abs_sop_sc(_a) sop_sabs
+#define sop_absdiff_sop_sc(_a) sop_sabsdiff
+#define sop_muladd_sop_sc(_a) sop_smuladd
+#define sop_mulsub_sop_sc(_a) sop_smulsub
+#define sop_mulhi_sop_sc(_a) sop_smulhi
 
 
 #define sop_typeof_sop_uc(_a) unsigned char
@@ -358,6 +1096,16 @@ int sopf(void *result, const char *const fmt, ...);
 #define sop_mod_sop_uc(_a) sop_umod
 #define sop_shl_sop_uc(_a) sop_ushl
 #define sop_shr_sop_uc(_a) sop_ushr
+#define sop_align_up_sop_uc(_a) sop_ualign_up
+#define sop_ceil_div_sop_uc(_a) sop_uceil_div
+#define sop_round_up_multiple_sop_uc(_a) sop_uround_up_multiple
+#define sop_next_pow2_sop_uc(_a) sop_unext_pow2
+#define sop_neg_sop_uc(_a) sop_uneg
+#define sop_abs_sop_uc(_a) sop_uabs
+#define sop_absdiff_sop_uc(_a) sop_uabsdiff
+#define sop_muladd_sop_uc(_a) sop_umuladd
+#define sop_mulsub_sop_uc(_a) sop_umulsub
+#define sop_mulhi_sop_uc(_a) sop_umulhi
 
 
 
@@ -371,6 +1119,16 @@ int sopf(void *result, const char *const fmt, ...);
 #define sop_mod_sop_sszt(_a) sop_smod
 #define sop_shl_sop_sszt(_a) sop_sshl
 #define sop_shr_sop_sszt(_a) sop_sshr
+#define sop_align_up_sop_sszt(_a) sop_salign_up
+#define sop_ceil_div_sop_sszt(_a) sop_sceil_div
+#define sop_round_up_multiple_sop_sszt(_a) sop_sround_up_multiple
+#define sop_next_pow2_sop_sszt(_a) sop_snext_pow2
+#define sop_neg_sop_sszt(_a) sop_sneg
+#define sop_abs_sop_sszt(_a) sop_sabs
+#define sop_absdiff_sop_sszt(_a) sop_sabsdiff
+#define sop_muladd_sop_sszt(_a) sop_smuladd
+#define sop_mulsub_sop_sszt(_a) sop_smulsub
+#define sop_mulhi_sop_sszt(_a) sop_smulhi
 
 
 #define sop_typeof_sop_szt(_a) size_t
@@ -383,6 +1141,16 @@ int sopf(void *result, const char *const fmt, ...);
 #define sop_mod_sop_szt(_a) sop_umod
 #define sop_shl_sop_szt(_a) sop_ushl
 #define sop_shr_sop_szt(_a) sop_ushr
+#define sop_align_up_sop_szt(_a) sop_ualign_up
+#define sop_ceil_div_sop_szt(_a) sop_uceil_div
+#define sop_round_up_multiple_sop_szt(_a) sop_uround_up_multiple
+#define sop_next_pow2_sop_szt(_a) sop_unext_pow2
+#define sop_neg_sop_szt(_a) sop_uneg
+#define sop_abs_sop_szt(_a) sop_uabs
+#define sop_absdiff_sop_szt(_a) sop_uabsdiff
+#define sop_muladd_sop_szt(_a) sop_umuladd
+#define sop_mulsub_sop_szt(_a) sop_umulsub
+#define sop_mulhi_sop_szt(_a) sop_umulhi
 
 
 
@@ -424,6 +1192,14 @@ int sopf(void *result, const char *const fmt, ...);
 #define sop_mod_NULL(_A,_B,_C,_D,_E,_F,_G,_H,_I) 0
 #define sop_shl_NULL(_A,_B,_C,_D,_E,_F,_G,_H,_I) 0
 #define sop_shr_NULL(_A,_B,_C,_D,_E,_F,_G,_H,_I) 0
+#define sop_align_up_NULL(_A,_B,_C,_D,_E,_F,_G,_H,_I) 0
+#define sop_ceil_div_NULL(_A,_B,_C,_D,_E,_F,_G,_H,_I) 0
+#define sop_round_up_multiple_NULL(_A,_B,_C,_D,_E,_F,_G,_H,_I) 0
+#define sop_next_pow2_NULL(_A,_B,_C,_D,_E,_F) 0
+#define sop_neg_NULL(_A,_B,_C,_D,_E,_F) 0
+#define sop_muladd_NULL(_A,_B,_C,_D,_E,_F,_G,_H,_I,_J,_K,_L) 0
+#define sop_mulsub_NULL(_A,_B,_C,_D,_E,_F,_G,_H,_I,_J,_K,_L) 0
+#define sop_mulhi_NULL(_A,_B,_C,_D,_E,_F,_G,_H,_I) 0
 
 /*****************************************************************************
  * Safe-checking Implementation Macros
@@ -650,6 +1426,337 @@ int sopf(void *result, const char *const fmt, ...);
     0 : ((((void *)(_ptr)) != NULL) ? \
          *((_ptr_type*)(_ptr)) = ((_ptr_type)(_a) >> (_ptr_type)(_b)),1 : 1))
 
+/*** Same-type alignment and rounding macros ***/
+
+/* align_up rounds a up to a multiple of b, which must be a power of two.
+ * round_up_multiple rounds a up to a multiple of any b > 0, and ceil_div
+ * divides rounding up.  Signed a may be negative; all of them round
+ * toward positive infinity.  next_pow2 gives the smallest power of two at
+ * least a, which is 1 for any a <= 1.
+ *
+ * The range is checked before any sum is formed, so no intermediate can
+ * overflow and they only fail if the result does not fit.  Powers of two
+ * are masked rather than divided, and with GNU C next_pow2 and unsigned
+ * ceil_div use count leading/trailing zeros.
+ */
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_is_pow2(_x) \
+  ((_x) > 0 && ((_x) & ((_x) - 1)) == 0)
+
+/* The largest power of two no greater than _max, a type's maximum */
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_pow2_top(_max) (((_max) >> 1) + 1)
+
+/* What must be added to _a to reach a multiple of _b > 0.  _a & (_b - 1)
+ * is the low bits of _a in two's complement, even when _a is negative. */
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_round_up_add(_type, _a, _b) \
+  (__sop(m)(is_pow2)(_b) ? \
+    (_type)(((_b) - ((_a) & ((_b) - 1))) & ((_b) - 1)) : \
+  ((_a) % (_b) > 0) ? (_type)((_b) - (_a) % (_b)) : (_type)(0 - (_a) % (_b)))
+
+/* pow2_ceil is the smallest power of two at least _x, an unsigned long long
+ * from 2 to 2^63.  Without clz the highest set bit of _x - 1 is smeared
+ * into every lower bit. */
+#if defined(__GNUC__)
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_pow2_ceil(_x) \
+  (1ULL << (sizeof(unsigned long long) * CHAR_BIT - \
+            __builtin_clzll((_x) - 1)))
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_ceil_udiv(_type, _a, _b) \
+  (__sop(m)(is_pow2)(_b) ? \
+    (_type)(((_a) >> __builtin_ctzll(_b)) + (((_a) & ((_b) - 1)) != 0)) : \
+    (_type)((_a) / (_b) + ((_a) % (_b) != 0)))
+#else
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_smear(_v, _s) ((_v) | (_v) >> (_s))
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_pow2_ceil(_x) \
+  (__sop(m)(smear)(__sop(m)(smear)(__sop(m)(smear)(__sop(m)(smear)( \
+   __sop(m)(smear)(__sop(m)(smear)((_x) - 1, 1), 2), 4), 8), 16), 32) + 1)
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_ceil_udiv(_type, _a, _b) \
+  (_type)((_a) / (_b) + ((_a) % (_b) != 0))
+#endif
+
+/* GCC type-limits hack: b == 1 is split out so that a constant b never
+ * leaves a compare against the type's maximum.  The | 1 changes nothing
+ * for any other power of two. */
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_align_up(_max, _ptr_type, _ptr, _a, _b) \
+  ((__sop(m)(is_pow2)((_ptr_type)(_b)) && \
+    ((_ptr_type)(_b) == 1 || \
+     (_ptr_type)(_a) <= \
+       (_ptr_type)((_max) & ~(((_ptr_type)(_b) - 1) | 1)))) \
+  ? \
+    ((((void *)(_ptr)) != NULL) ? *((_ptr_type*)(_ptr)) = \
+      (_ptr_type)(((_ptr_type)(_a) + ((_ptr_type)(_b) - 1)) & \
+                  ~((_ptr_type)(_b) - 1)),1 : 1) \
+  : 0)
+
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_round_up(_max, _ptr_type, _ptr, _a, _b) \
+  (((_ptr_type)(_b) > 0 && \
+    (_ptr_type)(_a) <= (_ptr_type)((_max) - __sop(m)(round_up_add)( \
+                         _ptr_type, (_ptr_type)(_a), (_ptr_type)(_b)))) \
+  ? \
+    ((((void *)(_ptr)) != NULL) ? *((_ptr_type*)(_ptr)) = \
+      (_ptr_type)((_ptr_type)(_a) + __sop(m)(round_up_add)( \
+                    _ptr_type, (_ptr_type)(_a), (_ptr_type)(_b))),1 : 1) \
+  : 0)
+
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_next_pow2(_max, _ptr_type, _ptr, _a) \
+  (((_ptr_type)(_a) <= (_ptr_type)__sop(m)(pow2_top)(_max)) \
+  ? \
+    ((((void *)(_ptr)) != NULL) ? *((_ptr_type*)(_ptr)) = \
+      (((_ptr_type)(_a) > 1) ? \
+        (_ptr_type)__sop(m)(pow2_ceil)( \
+          (unsigned long long)(_ptr_type)(_a)) : \
+        (_ptr_type)1),1 : 1) \
+  : 0)
+
+#define sop_ualign_up(_ptr_sign, _ptr_type, _ptr, \
+                      _a_sign, _a_type, _a, _b_sign, _b_type, _b) \
+  __sop(m)(align_up)(__sop(m)(umax)(_ptr_type), _ptr_type, _ptr, _a, _b)
+
+#define sop_salign_up(_ptr_sign, _ptr_type, _ptr, \
+                      _a_sign, _a_type, _a, _b_sign, _b_type, _b) \
+  __sop(m)(align_up)(__sop(m)(smax)(_ptr_type), _ptr_type, _ptr, _a, _b)
+
+#define sop_uround_up_multiple(_ptr_sign, _ptr_type, _ptr, \
+                               _a_sign, _a_type, _a, _b_sign, _b_type, _b) \
+  __sop(m)(round_up)(__sop(m)(umax)(_ptr_type), _ptr_type, _ptr, _a, _b)
+
+#define sop_sround_up_multiple(_ptr_sign, _ptr_type, _ptr, \
+                               _a_sign, _a_type, _a, _b_sign, _b_type, _b) \
+  __sop(m)(round_up)(__sop(m)(smax)(_ptr_type), _ptr_type, _ptr, _a, _b)
+
+#define sop_uceil_div(_ptr_sign, _ptr_type, _ptr, \
+                      _a_sign, _a_type, _a, _b_sign, _b_type, _b) \
+  (((_ptr_type)(_b) != 0) ? ((((void *)(_ptr)) != NULL) ? \
+    *((_ptr_type*)(_ptr)) = __sop(m)(ceil_udiv)(_ptr_type, (_ptr_type)(_a), \
+                                                (_ptr_type)(_b)),1 : 1) \
+  : 0)
+
+/* Addresses div by zero and smin / -1.  The quotient truncates, so it is
+ * one short when there is a remainder and a and b have the same sign.
+ * GCC type-limits hack: the sign tests should just check if < 0, but the
+ * GNU C interface expands this for unsigned types too. */
+#define sop_sceil_div(_ptr_sign, _ptr_type, _ptr, \
+                      _a_sign, _a_type, _a, _b_sign, _b_type, _b) \
+  ((((_ptr_type)(_b) != 0) && \
+   (((_ptr_type)(_a) != __sop(m)(smin)(_ptr_type)) || \
+   /* GCC type-limits hack: */ \
+    ((_b_type)(_b) != (_b_type)-1))) \
+   ? \
+    ((((void *)(_ptr)) != NULL) ? *((_ptr_type*)(_ptr)) = \
+      (_ptr_type)((_ptr_type)(_a) / (_ptr_type)(_b) + \
+                  ((_ptr_type)(_a) % (_ptr_type)(_b) != 0 && \
+                   !((_ptr_type)(_a) > 0 || (_ptr_type)(_a) == 0) == \
+                   !((_ptr_type)(_b) > 0 || (_ptr_type)(_b) == 0))),1 : 1) \
+  : \
+    0 \
+  )
+
+#define sop_unext_pow2(_ptr_sign, _ptr_type, _ptr, _a_sign, _a_type, _a) \
+  __sop(m)(next_pow2)(__sop(m)(umax)(_ptr_type), _ptr_type, _ptr, _a)
+
+#define sop_snext_pow2(_ptr_sign, _ptr_type, _ptr, _a_sign, _a_type, _a) \
+  __sop(m)(next_pow2)(__sop(m)(smax)(_ptr_type), _ptr_type, _ptr, _a)
+
+/*** Same-type negation, absolute value and absolute difference ***/
+
+/* neg works in ptr's type like the binary ops, and only fails for smin,
+ * or for any unsigned value but 0.  abs and absdiff work in a's type and
+ * fail only if the magnitude does not fit ptr's type, so |smin| fits an
+ * unsigned result of the same width and no absdiff of two values fails
+ * into one.  Magnitudes are formed in uintmax_t without branches, as
+ * (d ^ m) - m with m all ones if d is negative.
+ */
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_umag(_d, _neg) \
+  (((uintmax_t)(_d) ^ (0 - (uintmax_t)(_neg))) + (uintmax_t)(_neg))
+
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_store_mag(_ptr_sign, _ptr_type, _ptr, \
+                                               _mag) \
+  /* both limits are 2^k - 1, so a mask avoids a type-limit warning */ \
+  (((_mag) & ~(_ptr_sign ? (uintmax_t) __sop(m)(smax)(_ptr_type) : \
+                           (uintmax_t) __sop(m)(umax)(_ptr_type))) == 0 ? \
+    ((((void *)(_ptr)) != NULL) ? \
+      *((_ptr_type*)(_ptr)) = (_ptr_type)(_mag),1 : 1) \
+  : 0)
+
+#define sop_sneg(_ptr_sign, _ptr_type, _ptr, _a_sign, _a_type, _a) \
+  (((_ptr_type)(_a) != __sop(m)(smin)(_ptr_type)) ? \
+    ((((void *)(_ptr)) != NULL) ? *((_ptr_type*)(_ptr)) = \
+      (_ptr_type)(-(_ptr_type)(_a)),1 : 1) \
+  : 0)
+
+#define sop_uneg(_ptr_sign, _ptr_type, _ptr, _a_sign, _a_type, _a) \
+  (((_ptr_type)(_a) == 0) ? \
+    ((((void *)(_ptr)) != NULL) ? *((_ptr_type*)(_ptr)) = 0,1 : 1) \
+  : 0)
+
+/* GCC type-limit hack: should just check if < 0 */
+#define sop_sabs(_ptr_sign, _ptr_type, _ptr, _a_sign, _a_type, _a) \
+  __sop(m)(store_mag)(_ptr_sign, _ptr_type, _ptr, \
+    __sop(m)(umag)((_a_type)(_a), \
+                   !((_a_type)(_a) > 0 || (_a_type)(_a) == 0)))
+
+#define sop_uabs(_ptr_sign, _ptr_type, _ptr, _a_sign, _a_type, _a) \
+  __sop(m)(store_mag)(_ptr_sign, _ptr_type, _ptr, (uintmax_t)(_a_type)(_a))
+
+#define sop_sabsdiff(_ptr_sign, _ptr_type, _ptr, \
+                     _a_sign, _a_type, _a, _b_sign, _b_type, _b) \
+  __sop(m)(store_mag)(_ptr_sign, _ptr_type, _ptr, \
+    __sop(m)(umag)((uintmax_t)(_a_type)(_a) - (uintmax_t)(_a_type)(_b), \
+                   (_a_type)(_a) < (_a_type)(_b)))
+
+#define sop_uabsdiff sop_sabsdiff
+
+/*** Same-type multiply-add macros ***/
+
+/* a * b + c and a * b - c with one check.  The exact result is formed in
+ * the wide type, __int128 where the compiler has it and intmax_t
+ * otherwise, and checked against the limits of ptr's type once.  A type
+ * as wide as the wide type (64 bits without __int128) falls back to
+ * checking the product and then the add or sub; the product is never
+ * stored through ptr.
+ */
+#if defined(__SIZEOF_INT128__)
+#  define OPAQUE_SAFE_IOP_PREFIX_MACRO_wide_t __int128
+#  define OPAQUE_SAFE_IOP_PREFIX_MACRO_uwide_t unsigned __int128
+#else
+#  define OPAQUE_SAFE_IOP_PREFIX_MACRO_wide_t intmax_t
+#  define OPAQUE_SAFE_IOP_PREFIX_MACRO_uwide_t uintmax_t
+#endif
+
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_is_narrow(_type) \
+  (sizeof(_type) < sizeof(__sop(m)(wide_t)))
+
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_uwmul(_type, _a, _b) \
+  ((__sop(m)(uwide_t))(_type)(_a) * (__sop(m)(uwide_t))(_type)(_b))
+
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_swmul(_type, _a, _b) \
+  ((__sop(m)(wide_t))(_type)(_a) * (__sop(m)(wide_t))(_type)(_b))
+
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_store(_ptr_type, _ptr, _v) \
+  ((((void *)(_ptr)) != NULL) ? *((_ptr_type*)(_ptr)) = (_ptr_type)(_v),1 : 1)
+
+/* The wrapped product, for the fallback once the product is checked */
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_nmul(_type, _a, _b) \
+  ((_type)((_type)(_a) * (_type)(_b)))
+
+#define sop_umuladd(_ptr_sign, _ptr_type, _ptr, _a_sign, _a_type, _a, \
+                    _b_sign, _b_type, _b, _c_sign, _c_type, _c) \
+  (__sop(m)(is_narrow)(_ptr_type) \
+  ? \
+    (((__sop(m)(uwide_t))(__sop(m)(uwmul)(_ptr_type, _a, _b) + \
+                          (_ptr_type)(_c)) <= \
+      (__sop(m)(uwide_t))__sop(m)(umax)(_ptr_type)) ? \
+      __sop(m)(store)(_ptr_type, _ptr, \
+                      __sop(m)(uwmul)(_ptr_type, _a, _b) + (_ptr_type)(_c)) \
+    : 0) \
+  : \
+    (sop_umul(_ptr_sign, _ptr_type, 0, _a_sign, _a_type, _a, \
+              _b_sign, _b_type, _b) ? \
+      sop_uadd(_ptr_sign, _ptr_type, _ptr, _ptr_sign, _ptr_type, \
+               __sop(m)(nmul)(_ptr_type, _a, _b), _c_sign, _c_type, _c) \
+    : 0))
+
+#define sop_smuladd(_ptr_sign, _ptr_type, _ptr, _a_sign, _a_type, _a, \
+                    _b_sign, _b_type, _b, _c_sign, _c_type, _c) \
+  (__sop(m)(is_narrow)(_ptr_type) \
+  ? \
+    ((__sop(m)(swmul)(_ptr_type, _a, _b) + (_ptr_type)(_c) >= \
+        __sop(m)(smin)(_ptr_type) && \
+      __sop(m)(swmul)(_ptr_type, _a, _b) + (_ptr_type)(_c) <= \
+        __sop(m)(smax)(_ptr_type)) ? \
+      __sop(m)(store)(_ptr_type, _ptr, \
+                      __sop(m)(swmul)(_ptr_type, _a, _b) + (_ptr_type)(_c)) \
+    : 0) \
+  : \
+    (sop_smul(_ptr_sign, _ptr_type, 0, _a_sign, _a_type, _a, \
+              _b_sign, _b_type, _b) ? \
+      sop_sadd(_ptr_sign, _ptr_type, _ptr, _ptr_sign, _ptr_type, \
+               __sop(m)(nmul)(_ptr_type, _a, _b), _c_sign, _c_type, _c) \
+    : 0))
+
+#define sop_umulsub(_ptr_sign, _ptr_type, _ptr, _a_sign, _a_type, _a, \
+                    _b_sign, _b_type, _b, _c_sign, _c_type, _c) \
+  (__sop(m)(is_narrow)(_ptr_type) \
+  ? \
+    ((__sop(m)(uwmul)(_ptr_type, _a, _b) >= \
+        (__sop(m)(uwide_t))(_ptr_type)(_c) && \
+      (__sop(m)(uwide_t))(__sop(m)(uwmul)(_ptr_type, _a, _b) - \
+                          (_ptr_type)(_c)) <= \
+        (__sop(m)(uwide_t))__sop(m)(umax)(_ptr_type)) ? \
+      __sop(m)(store)(_ptr_type, _ptr, \
+                      __sop(m)(uwmul)(_ptr_type, _a, _b) - (_ptr_type)(_c)) \
+    : 0) \
+  : \
+    (sop_umul(_ptr_sign, _ptr_type, 0, _a_sign, _a_type, _a, \
+              _b_sign, _b_type, _b) ? \
+      sop_usub(_ptr_sign, _ptr_type, _ptr, _ptr_sign, _ptr_type, \
+               __sop(m)(nmul)(_ptr_type, _a, _b), _c_sign, _c_type, _c) \
+    : 0))
+
+#define sop_smulsub(_ptr_sign, _ptr_type, _ptr, _a_sign, _a_type, _a, \
+                    _b_sign, _b_type, _b, _c_sign, _c_type, _c) \
+  (__sop(m)(is_narrow)(_ptr_type) \
+  ? \
+    ((__sop(m)(swmul)(_ptr_type, _a, _b) - (_ptr_type)(_c) >= \
+        __sop(m)(smin)(_ptr_type) && \
+      __sop(m)(swmul)(_ptr_type, _a, _b) - (_ptr_type)(_c) <= \
+        __sop(m)(smax)(_ptr_type)) ? \
+      __sop(m)(store)(_ptr_type, _ptr, \
+                      __sop(m)(swmul)(_ptr_type, _a, _b) - (_ptr_type)(_c)) \
+    : 0) \
+  : \
+    (sop_smul(_ptr_sign, _ptr_type, 0, _a_sign, _a_type, _a, \
+              _b_sign, _b_type, _b) ? \
+      sop_ssub(_ptr_sign, _ptr_type, _ptr, _ptr_sign, _ptr_type, \
+               __sop(m)(nmul)(_ptr_type, _a, _b), _c_sign, _c_type, _c) \
+    : 0))
+
+/*** Same-type high-half multiplication macros ***/
+
+/* The high half of the double-width product, which cannot overflow.  Types
+ * up to 32 bits are widened to 64 bits; 64-bit types use __int128 or the
+ * partial products of their 32-bit halves.  The signed 64-bit high half is
+ * the unsigned one less b when a is negative and less a when b is.
+ */
+#if defined(__SIZEOF_INT128__)
+#  define OPAQUE_SAFE_IOP_PREFIX_MACRO_mulhi64(_a, _b) \
+  ((uint64_t)(((unsigned __int128)(uint64_t)(_a) * (uint64_t)(_b)) >> 64))
+#else
+#  define OPAQUE_SAFE_IOP_PREFIX_MACRO_mulhi64(_a, _b) \
+  (((uint64_t)(_a) >> 32) * ((uint64_t)(_b) >> 32) + \
+   (((uint64_t)(_a) >> 32) * ((uint64_t)(_b) & UINT32_MAX) >> 32) + \
+   (((uint64_t)(_a) & UINT32_MAX) * ((uint64_t)(_b) >> 32) >> 32) + \
+   (((((uint64_t)(_a) & UINT32_MAX) * ((uint64_t)(_b) & UINT32_MAX) >> 32) + \
+     (((uint64_t)(_a) >> 32) * ((uint64_t)(_b) & UINT32_MAX) & UINT32_MAX) + \
+     (((uint64_t)(_a) & UINT32_MAX) * ((uint64_t)(_b) >> 32) & UINT32_MAX)) \
+    >> 32))
+#endif
+
+/* Shifted in two halves so the unused 64-bit case does not warn */
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_mulhi(_type, _a, _b) \
+  ((_type)(sizeof(_type) < sizeof(uint64_t) ? \
+    (uint64_t)(_type)(_a) * (_type)(_b) >> (sizeof(_type) * CHAR_BIT / 2) \
+                                        >> (sizeof(_type) * CHAR_BIT / 2) \
+  : \
+    __sop(m)(mulhi64)((_type)(_a), (_type)(_b))))
+
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_smulhi(_type, _a, _b) \
+  ((_type)(sizeof(_type) < sizeof(uint64_t) ? \
+    (uint64_t)((int64_t)(_type)(_a) * (_type)(_b)) \
+      >> (sizeof(_type) * CHAR_BIT / 2) >> (sizeof(_type) * CHAR_BIT / 2) \
+  : \
+    __sop(m)(mulhi64)((_type)(_a), (_type)(_b)) - \
+      (!((_type)(_a) > 0 || (_type)(_a) == 0) ? (uint64_t)(_type)(_b) : 0) - \
+      (!((_type)(_b) > 0 || (_type)(_b) == 0) ? (uint64_t)(_type)(_a) : 0)))
+
+#define sop_umulhi(_ptr_sign, _ptr_type, _ptr, \
+                   _a_sign, _a_type, _a, _b_sign, _b_type, _b) \
+  ((((void *)(_ptr)) != NULL) ? *((_ptr_type*)(_ptr)) = \
+    __sop(m)(mulhi)(_ptr_type, _a, _b),1 : 1)
+
+#define sop_smulhi(_ptr_sign, _ptr_type, _ptr, \
+                   _a_sign, _a_type, _a, _b_sign, _b_type, _b) \
+  ((((void *)(_ptr)) != NULL) ? *((_ptr_type*)(_ptr)) = \
+    __sop(m)(smulhi)(_ptr_type, _a, _b),1 : 1)
+
 
 /* sop_safe_cast
  * sop_safe_cast takes the signedness, type, and value of two variables. It
@@ -956,6 +2063,215 @@ int sopf(void *result, const char *const fmt, ...);
                  sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b)) \
   : 0)
 
+/* sop_align_upx, sop_ceil_divx, sop_round_up_multiplex, sop_next_pow2x
+ * Buffer and block sizing.  With the casts of the other (x) macros:
+ *   if (!sop_align_upx(sop_szt(&padded), sop_szt(len), sop_szt(16)) ||
+ *       !sop_ceil_divx(sop_u32(&blocks), sop_szt(padded), sop_u32(bsize)))
+ *     goto ERR_too_big;
+ * align_up needs a power of two alignment; see "Same-type alignment and
+ * rounding macros" for what each one computes.  sop_next_pow2x takes a
+ * single operand.
+ */
+#define sop_align_upx(_ptr, _a, _b) \
+  (sop_safe_cast_##_ptr(\
+    sop_signed_##_ptr, sop_typeof_##_ptr, sop_valueof_##_ptr, \
+    sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+    sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b) ? \
+    /* PCC won't do an extra dereference here! */ \
+    (((void *)(sop_valueof_##_ptr)) != NULL ? \
+      sop_align_up_##_ptr( \
+                 sop_signed_##_ptr, sop_typeof_##_ptr, sop_valueof_##_ptr, \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+                 sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b) \
+    : \
+      sop_align_up_##_a( \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_ptr, \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+                 sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b)) \
+  : 0)
+
+#define sop_ceil_divx(_ptr, _a, _b) \
+  (sop_safe_cast_##_ptr(\
+    sop_signed_##_ptr, sop_typeof_##_ptr, sop_valueof_##_ptr, \
+    sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+    sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b) ? \
+    /* PCC won't do an extra dereference here! */ \
+    (((void *)(sop_valueof_##_ptr)) != NULL ? \
+      sop_ceil_div_##_ptr( \
+                 sop_signed_##_ptr, sop_typeof_##_ptr, sop_valueof_##_ptr, \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+                 sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b) \
+    : \
+      sop_ceil_div_##_a( \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_ptr, \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+                 sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b)) \
+  : 0)
+
+#define sop_round_up_multiplex(_ptr, _a, _b) \
+  (sop_safe_cast_##_ptr(\
+    sop_signed_##_ptr, sop_typeof_##_ptr, sop_valueof_##_ptr, \
+    sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+    sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b) ? \
+    /* PCC won't do an extra dereference here! */ \
+    (((void *)(sop_valueof_##_ptr)) != NULL ? \
+      sop_round_up_multiple_##_ptr( \
+                 sop_signed_##_ptr, sop_typeof_##_ptr, sop_valueof_##_ptr, \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+                 sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b) \
+    : \
+      sop_round_up_multiple_##_a( \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_ptr, \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+                 sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b)) \
+  : 0)
+
+#define sop_next_pow2x(_ptr, _a) \
+  (sop_safe_cast_##_ptr(\
+    sop_signed_##_ptr, sop_typeof_##_ptr, sop_valueof_##_ptr, \
+    sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+    sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a) ? \
+    /* PCC won't do an extra dereference here! */ \
+    (((void *)(sop_valueof_##_ptr)) != NULL ? \
+      sop_next_pow2_##_ptr( \
+                 sop_signed_##_ptr, sop_typeof_##_ptr, sop_valueof_##_ptr, \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a) \
+    : \
+      sop_next_pow2_##_a( \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_ptr, \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a)) \
+  : 0)
+
+/* sop_negx, sop_absx, sop_absdiffx
+ * Checked unary minus, absolute value and absolute difference:
+ *   if (!sop_absdiffx(sop_u32(&span), sop_s32(first), sop_s32(last)))
+ *     goto ERR_range;
+ * sop_negx casts its operand to the pointer's type like the binary
+ * macros.  sop_absx and sop_absdiffx work in the type of a (b must cast
+ * to it safely) and only check that the result fits the pointer's type,
+ * which is usually unsigned, or a's type if the pointer is NULL.
+ */
+#define sop_negx(_ptr, _a) \
+  (sop_safe_cast_##_ptr(\
+    sop_signed_##_ptr, sop_typeof_##_ptr, sop_valueof_##_ptr, \
+    sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+    sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a) ? \
+    /* PCC won't do an extra dereference here! */ \
+    (((void *)(sop_valueof_##_ptr)) != NULL ? \
+      sop_neg_##_ptr( \
+                 sop_signed_##_ptr, sop_typeof_##_ptr, sop_valueof_##_ptr, \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a) \
+    : \
+      sop_neg_##_a( \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_ptr, \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a)) \
+  : 0)
+
+#define sop_absx(_ptr, _a) \
+  (((void *)(sop_valueof_##_ptr)) != NULL ? \
+    sop_abs_##_a(sop_signed_##_ptr, sop_typeof_##_ptr, sop_valueof_##_ptr, \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a) \
+  : \
+    sop_abs_##_a(sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_ptr, \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a))
+
+#define sop_absdiffx(_ptr, _a, _b) \
+  (sop_safe_cast(sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+                 sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b) ? \
+    (((void *)(sop_valueof_##_ptr)) != NULL ? \
+      sop_absdiff_##_a( \
+                 sop_signed_##_ptr, sop_typeof_##_ptr, sop_valueof_##_ptr, \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+                 sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b) \
+    : \
+      sop_absdiff_##_a( \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_ptr, \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+                 sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b)) \
+  : 0)
+
+/* sop_muladdx, sop_mulsubx
+ * Checked a * b + c and a * b - c, with every operand cast-checked to
+ * the pointer's type once and a single overflow check on the exact
+ * result:
+ *   if (!sop_muladdx(sop_szt(&off), sop_szt(index), sop_szt(stride),
+ *                    sop_szt(base)))
+ *     goto ERR_offset;
+ */
+#define sop_muladdx(_ptr, _a, _b, _c) \
+  (sop_safe_cast_##_ptr(\
+    sop_signed_##_ptr, sop_typeof_##_ptr, sop_valueof_##_ptr, \
+    sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+    sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b) && \
+   sop_safe_cast_##_ptr(\
+    sop_signed_##_ptr, sop_typeof_##_ptr, sop_valueof_##_ptr, \
+    sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+    sop_signed_##_c, sop_typeof_##_c, sop_valueof_##_c) ? \
+    /* PCC won't do an extra dereference here! */ \
+    (((void *)(sop_valueof_##_ptr)) != NULL ? \
+      sop_muladd_##_ptr( \
+                 sop_signed_##_ptr, sop_typeof_##_ptr, sop_valueof_##_ptr, \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+                 sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b, \
+                 sop_signed_##_c, sop_typeof_##_c, sop_valueof_##_c) \
+    : \
+      sop_muladd_##_a( \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_ptr, \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+                 sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b, \
+                 sop_signed_##_c, sop_typeof_##_c, sop_valueof_##_c)) \
+  : 0)
+
+#define sop_mulsubx(_ptr, _a, _b, _c) \
+  (sop_safe_cast_##_ptr(\
+    sop_signed_##_ptr, sop_typeof_##_ptr, sop_valueof_##_ptr, \
+    sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+    sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b) && \
+   sop_safe_cast_##_ptr(\
+    sop_signed_##_ptr, sop_typeof_##_ptr, sop_valueof_##_ptr, \
+    sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+    sop_signed_##_c, sop_typeof_##_c, sop_valueof_##_c) ? \
+    /* PCC won't do an extra dereference here! */ \
+    (((void *)(sop_valueof_##_ptr)) != NULL ? \
+      sop_mulsub_##_ptr( \
+                 sop_signed_##_ptr, sop_typeof_##_ptr, sop_valueof_##_ptr, \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+                 sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b, \
+                 sop_signed_##_c, sop_typeof_##_c, sop_valueof_##_c) \
+    : \
+      sop_mulsub_##_a( \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_ptr, \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+                 sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b, \
+                 sop_signed_##_c, sop_typeof_##_c, sop_valueof_##_c)) \
+  : 0)
+
+/* sop_mulhix
+ * The high half of the double-width product, e.g. to map a hash onto
+ * [0, n) without a division:
+ *   sop_mulhix(sop_u64(&bucket), sop_u64(hash), sop_u64(n));
+ * The operands are cast-checked to the pointer's type.  The product itself
+ * never overflows.  For signed types the high half is rounded toward
+ * negative infinity, as an arithmetic shift of the full product would be.
+ */
+#define sop_mulhix(_ptr, _a, _b) \
+  (sop_safe_cast_##_ptr(\
+    sop_signed_##_ptr, sop_typeof_##_ptr, sop_valueof_##_ptr, \
+    sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+    sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b) ? \
+    /* PCC won't do an extra dereference here! */ \
+    (((void *)(sop_valueof_##_ptr)) != NULL ? \
+      sop_mulhi_##_ptr( \
+                 sop_signed_##_ptr, sop_typeof_##_ptr, sop_valueof_##_ptr, \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+                 sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b) \
+    : \
+      sop_mulhi_##_a( \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_ptr, \
+                 sop_signed_##_a, sop_typeof_##_a, sop_valueof_##_a, \
+                 sop_signed_##_b, sop_typeof_##_b, sop_valueof_##_b)) \
+  : 0)
+
 /* Generic interface convenience functions */
 
 /* sop_incx
@@ -2320,6 +3636,523 @@ int sopf(void *result, const char *const fmt, ...);
 #define sop_inc(_a)  sop_add(&(_a), (_a), 1)
 #define sop_dec(_a)  sop_sub(&(_a), (_a), 1)
 
+/* sop_align_up, sop_ceil_div, sop_round_up_multiple, sop_next_pow2
+ * GNU C versions of sop_align_upx and friends:
+ *   if (!sop_align_up(&padded, len, 16)) goto ERR_too_big;
+ */
+#define sop_align_up(_dst, _A, _B) ({ \
+  /* Protect against side effects */ \
+  typeof(_A) __sop(var)(_a) = (_A); \
+  typeof(_B) __sop(var)(_b) = (_B); \
+  typeof(_A) *__sop(var)(_ptr) = (_dst); \
+  int __sop(var)(ok) =  \
+    (sop_safe_cast(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                   __sop(m)(is_signed)(_B), typeof(_B), __sop(var)(_b)) ? \
+      ( __sop(m)(is_signed)(_A) ? \
+          sop_salign_up(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_ptr),\
+                    __sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                    __sop(m)(is_signed)(_B), typeof(_B), __sop(var)(_b)) \
+        :  \
+          sop_ualign_up(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_ptr), \
+                    __sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                    __sop(m)(is_signed)(_B), typeof(_B), __sop(var)(_b))) \
+      : 0 ); \
+   __sop(var)(ok); \
+})
+
+#define sop_ceil_div(_dst, _A, _B) ({ \
+  /* Protect against side effects */ \
+  typeof(_A) __sop(var)(_a) = (_A); \
+  typeof(_B) __sop(var)(_b) = (_B); \
+  typeof(_A) *__sop(var)(_ptr) = (_dst); \
+  int __sop(var)(ok) =  \
+    (sop_safe_cast(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                   __sop(m)(is_signed)(_B), typeof(_B), __sop(var)(_b)) ? \
+      ( __sop(m)(is_signed)(_A) ? \
+          sop_sceil_div(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_ptr),\
+                    __sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                    __sop(m)(is_signed)(_B), typeof(_B), __sop(var)(_b)) \
+        :  \
+          sop_uceil_div(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_ptr), \
+                    __sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                    __sop(m)(is_signed)(_B), typeof(_B), __sop(var)(_b))) \
+      : 0 ); \
+   __sop(var)(ok); \
+})
+
+#define sop_round_up_multiple(_dst, _A, _B) ({ \
+  /* Protect against side effects */ \
+  typeof(_A) __sop(var)(_a) = (_A); \
+  typeof(_B) __sop(var)(_b) = (_B); \
+  typeof(_A) *__sop(var)(_ptr) = (_dst); \
+  int __sop(var)(ok) =  \
+    (sop_safe_cast(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                   __sop(m)(is_signed)(_B), typeof(_B), __sop(var)(_b)) ? \
+      ( __sop(m)(is_signed)(_A) ? \
+          sop_sround_up_multiple(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_ptr),\
+                    __sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                    __sop(m)(is_signed)(_B), typeof(_B), __sop(var)(_b)) \
+        :  \
+          sop_uround_up_multiple(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_ptr), \
+                    __sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                    __sop(m)(is_signed)(_B), typeof(_B), __sop(var)(_b))) \
+      : 0 ); \
+   __sop(var)(ok); \
+})
+
+#define sop_next_pow2(_dst, _A) ({ \
+  /* Protect against side effects */ \
+  typeof(_A) __sop(var)(_a) = (_A); \
+  typeof(_A) *__sop(var)(_ptr) = (_dst); \
+  int __sop(var)(ok) =  \
+    ( __sop(m)(is_signed)(_A) ? \
+        sop_snext_pow2(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_ptr),\
+                       __sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a)) \
+      :  \
+        sop_unext_pow2(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_ptr),\
+                       __sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a))); \
+   __sop(var)(ok); \
+})
+
+/* sop_neg, sop_abs, sop_absdiff
+ * GNU C versions of sop_negx and friends.  sop_neg and sop_abs store into
+ * the type of A, so both fail for its minimum.  sop_absdiff stores into
+ * the unsigned type of A's width (uint8_t to uint64_t) and so only fails
+ * if B cannot be cast to the type of A:
+ *   uint32_t span;
+ *   if (!sop_absdiff(&span, first, last)) goto ERR_range;
+ */
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_utype(_x) \
+  typeof(__builtin_choose_expr(sizeof(_x) == 1, (uint8_t)0, \
+         __builtin_choose_expr(sizeof(_x) == 2, (uint16_t)0, \
+         __builtin_choose_expr(sizeof(_x) == 4, (uint32_t)0, (uint64_t)0))))
+
+#define sop_neg(_dst, _A) ({ \
+  /* Protect against side effects */ \
+  typeof(_A) __sop(var)(_a) = (_A); \
+  typeof(_A) *__sop(var)(_ptr) = (_dst); \
+  int __sop(var)(ok) =  \
+    ( __sop(m)(is_signed)(_A) ? \
+        sop_sneg(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_ptr), \
+                 __sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a)) \
+      :  \
+        sop_uneg(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_ptr), \
+                 __sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a))); \
+   __sop(var)(ok); \
+})
+
+#define sop_abs(_dst, _A) ({ \
+  /* Protect against side effects */ \
+  typeof(_A) __sop(var)(_a) = (_A); \
+  typeof(_A) *__sop(var)(_ptr) = (_dst); \
+  int __sop(var)(ok) =  \
+    ( __sop(m)(is_signed)(_A) ? \
+        sop_sabs(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_ptr), \
+                 __sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a)) \
+      :  \
+        sop_uabs(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_ptr), \
+                 __sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a))); \
+   __sop(var)(ok); \
+})
+
+#define sop_absdiff(_dst, _A, _B) ({ \
+  /* Protect against side effects */ \
+  typeof(_A) __sop(var)(_a) = (_A); \
+  typeof(_B) __sop(var)(_b) = (_B); \
+  __sop(m)(utype)(_A) *__sop(var)(_ptr) = (_dst); \
+  int __sop(var)(ok) =  \
+    (sop_safe_cast(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                   __sop(m)(is_signed)(_B), typeof(_B), __sop(var)(_b)) ? \
+      sop_sabsdiff(0, __sop(m)(utype)(_A), __sop(var)(_ptr), \
+                   __sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                   __sop(m)(is_signed)(_B), typeof(_B), __sop(var)(_b)) \
+      : 0 ); \
+   __sop(var)(ok); \
+})
+
+/* sop_muladd, sop_mulsub
+ * GNU C versions of sop_muladdx and sop_mulsubx, in the type of A:
+ *   if (!sop_muladd(&off, index, stride, base)) goto ERR_offset;
+ */
+#define sop_muladd(_dst, _A, _B, _C) ({ \
+  /* Protect against side effects */ \
+  typeof(_A) __sop(var)(_a) = (_A); \
+  typeof(_B) __sop(var)(_b) = (_B); \
+  typeof(_C) __sop(var)(_c) = (_C); \
+  typeof(_A) *__sop(var)(_ptr) = (_dst); \
+  int __sop(var)(ok) =  \
+    (sop_safe_cast(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                   __sop(m)(is_signed)(_B), typeof(_B), __sop(var)(_b)) && \
+     sop_safe_cast(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                   __sop(m)(is_signed)(_C), typeof(_C), __sop(var)(_c)) ? \
+      ( __sop(m)(is_signed)(_A) ? \
+          sop_smuladd(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_ptr),\
+                    __sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                    __sop(m)(is_signed)(_B), typeof(_B), __sop(var)(_b), \
+                    __sop(m)(is_signed)(_C), typeof(_C), __sop(var)(_c)) \
+        :  \
+          sop_umuladd(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_ptr), \
+                    __sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                    __sop(m)(is_signed)(_B), typeof(_B), __sop(var)(_b), \
+                    __sop(m)(is_signed)(_C), typeof(_C), __sop(var)(_c))) \
+      : 0 ); \
+   __sop(var)(ok); \
+})
+
+#define sop_mulsub(_dst, _A, _B, _C) ({ \
+  /* Protect against side effects */ \
+  typeof(_A) __sop(var)(_a) = (_A); \
+  typeof(_B) __sop(var)(_b) = (_B); \
+  typeof(_C) __sop(var)(_c) = (_C); \
+  typeof(_A) *__sop(var)(_ptr) = (_dst); \
+  int __sop(var)(ok) =  \
+    (sop_safe_cast(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                   __sop(m)(is_signed)(_B), typeof(_B), __sop(var)(_b)) && \
+     sop_safe_cast(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                   __sop(m)(is_signed)(_C), typeof(_C), __sop(var)(_c)) ? \
+      ( __sop(m)(is_signed)(_A) ? \
+          sop_smulsub(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_ptr),\
+                    __sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                    __sop(m)(is_signed)(_B), typeof(_B), __sop(var)(_b), \
+                    __sop(m)(is_signed)(_C), typeof(_C), __sop(var)(_c)) \
+        :  \
+          sop_umulsub(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_ptr), \
+                    __sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                    __sop(m)(is_signed)(_B), typeof(_B), __sop(var)(_b), \
+                    __sop(m)(is_signed)(_C), typeof(_C), __sop(var)(_c))) \
+      : 0 ); \
+   __sop(var)(ok); \
+})
+
+/* sop_mulhi
+ * GNU C version of sop_mulhix, in the type of A:
+ *   uint64_t bucket;
+ *   sop_mulhi(&bucket, hash, n);
+ */
+#define sop_mulhi(_dst, _A, _B) ({ \
+  /* Protect against side effects */ \
+  typeof(_A) __sop(var)(_a) = (_A); \
+  typeof(_B) __sop(var)(_b) = (_B); \
+  typeof(_A) *__sop(var)(_ptr) = (_dst); \
+  int __sop(var)(ok) =  \
+    (sop_safe_cast(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                   __sop(m)(is_signed)(_B), typeof(_B), __sop(var)(_b)) ? \
+      ( __sop(m)(is_signed)(_A) ? \
+          sop_smulhi(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_ptr),\
+                    __sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                    __sop(m)(is_signed)(_B), typeof(_B), __sop(var)(_b)) \
+        :  \
+          sop_umulhi(__sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_ptr), \
+                    __sop(m)(is_signed)(_A), typeof(_A), __sop(var)(_a), \
+                    __sop(m)(is_signed)(_B), typeof(_B), __sop(var)(_b))) \
+      : 0 ); \
+   __sop(var)(ok); \
+})
+
+/* sop_v_<op>_<type>x<lanes>
+ *
+ * Checked lane-wise operations on GCC vector types, for fusing overflow
+ * checks into SIMD loops of your own:
+ *   sop_v_u32x8_t a, b, r;
+ *   sop_v_s32x8_t ov = sop_v_add_u32x8(&r, a, b);
+ * Vectors of 8-, 16-, 32- and 64-bit lanes are provided in 16-, 32- and
+ * 64-byte sizes (SSE2, AVX2 and AVX-512 registers), named
+ * sop_v_<type>x<lanes>_t, e.g. sop_v_s16x16_t.  The ops are add, sub and mul.
+ *
+ * Each lane behaves exactly like the same-type macro (sop_uadd, sop_smul,
+ * ...) on that lane's elements.  The returned mask has the signed lane type
+ * of the same width and is -1 in the lanes that overflowed and 0 elsewhere,
+ * like a vector comparison.  *_dst gets every lane's wrapped result, so the
+ * lanes the mask clears hold the checked result.  _dst may be NULL.
+ * sop_v_any(mask) is 1 if any lane of a mask is set.
+ *
+ * Masks may be or'ed together across several operations and tested once.
+ * No lane is ever extracted to scalar code: add and sub use bitwise tests,
+ * 8- to 32-bit mul widens the lanes with __builtin_convertvector and 64-bit
+ * mul combines 32-bit partial products.  Vectors wider than the target's
+ * registers work but are split by the compiler.
+ */
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_v_types(_bits, _n) \
+  typedef uint##_bits##_t sop_v_u##_bits##x##_n##_t \
+    __attribute__((vector_size(_bits / CHAR_BIT * _n))); \
+  typedef int##_bits##_t sop_v_s##_bits##x##_n##_t \
+    __attribute__((vector_size(_bits / CHAR_BIT * _n)));
+
+__sop(m)(v_types)(8, 16)
+__sop(m)(v_types)(16, 8)
+__sop(m)(v_types)(32, 4)
+__sop(m)(v_types)(64, 2)
+__sop(m)(v_types)(8, 32)
+__sop(m)(v_types)(16, 16)
+__sop(m)(v_types)(32, 8)
+__sop(m)(v_types)(64, 4)
+__sop(m)(v_types)(8, 64)
+__sop(m)(v_types)(16, 32)
+__sop(m)(v_types)(32, 16)
+__sop(m)(v_types)(64, 8)
+
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_v_int_u(_bits) uint##_bits##_t
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_v_int_s(_bits) int##_bits##_t
+
+/* Lane tests on the unsigned twins _a, _b of the operands.  Each stores the
+ * wrapped result in _r and yields the mask.  A signed lane overflowed if the
+ * top bit of the expression is set, as in the array kernels.
+ */
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_v_uadd(_mt, _a, _b, _r) \
+  ((_r) = (_a) + (_b), (_mt) ((_r) < (_a)))
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_v_usub(_mt, _a, _b, _r) \
+  ((_r) = (_a) - (_b), (_mt) ((_a) < (_b)))
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_v_sadd(_mt, _a, _b, _r) \
+  ((_r) = (_a) + (_b), (_mt) ((_mt) (((_a) ^ (_r)) & ((_b) ^ (_r))) < 0))
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_v_ssub(_mt, _a, _b, _r) \
+  ((_r) = (_a) - (_b), (_mt) ((_mt) (((_a) ^ (_b)) & ((_a) ^ (_r))) < 0))
+
+/* Add and sub of sop_v_<_s><_bits>x<_n>_t */
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_v_arith(_op, _s, _bits, _n, \
+                                             _dst, _A, _B) ({ \
+  sop_v_##_s##_bits##x##_n##_t __sop(var)(va) = (_A); \
+  sop_v_##_s##_bits##x##_n##_t __sop(var)(vb) = (_B); \
+  sop_v_##_s##_bits##x##_n##_t *__sop(var)(vptr) = (_dst); \
+  sop_v_u##_bits##x##_n##_t __sop(var)(vr); \
+  sop_v_s##_bits##x##_n##_t __sop(var)(vov) = \
+    __sop(m)(v_##_s##_op)(sop_v_s##_bits##x##_n##_t, \
+                          (sop_v_u##_bits##x##_n##_t) __sop(var)(va), \
+                          (sop_v_u##_bits##x##_n##_t) __sop(var)(vb), \
+                          __sop(var)(vr)); \
+  if (__sop(var)(vptr)) \
+    *__sop(var)(vptr) = (sop_v_##_s##_bits##x##_n##_t) __sop(var)(vr); \
+  __sop(var)(vov); \
+})
+
+/* Mul of 8- to 32-bit lanes: the exact product is formed in lanes of
+ * _wbits and a lane overflowed if it does not survive the round trip
+ * through the narrow type.
+ */
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_v_mulw(_s, _bits, _n, _wbits, \
+                                            _dst, _A, _B) ({ \
+  typedef __sop(m)(v_int_##_s)(_wbits) __sop(var)(vw_t) \
+    __attribute__((vector_size(_wbits / CHAR_BIT * _n))); \
+  sop_v_##_s##_bits##x##_n##_t __sop(var)(va) = (_A); \
+  sop_v_##_s##_bits##x##_n##_t __sop(var)(vb) = (_B); \
+  sop_v_##_s##_bits##x##_n##_t *__sop(var)(vptr) = (_dst); \
+  __sop(var)(vw_t) __sop(var)(vp) = \
+    __builtin_convertvector(__sop(var)(va), __sop(var)(vw_t)) * \
+    __builtin_convertvector(__sop(var)(vb), __sop(var)(vw_t)); \
+  sop_v_##_s##_bits##x##_n##_t __sop(var)(vr) = \
+    (sop_v_##_s##_bits##x##_n##_t) __builtin_convertvector( \
+      __sop(var)(vp), sop_v_u##_bits##x##_n##_t); \
+  if (__sop(var)(vptr)) \
+    *__sop(var)(vptr) = __sop(var)(vr); \
+  __builtin_convertvector( \
+    __builtin_convertvector(__sop(var)(vr), __sop(var)(vw_t)) != \
+      __sop(var)(vp), sop_v_s##_bits##x##_n##_t); \
+})
+
+/* Mul of 64-bit lanes from 32-bit halves.  If both high halves are set the
+ * lane overflowed; otherwise the single cross product and the final carry
+ * are checked.  Signed lanes multiply magnitudes and then check them
+ * against INT64_MAX, or INT64_MAX + 1 for a negative result.
+ */
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_v_umul64(_mt, _a, _b, _r) ({ \
+  __typeof__(_a) __sop(var)(vc) = ((_a) >> 32) * ((_b) & UINT32_MAX) + \
+                                  ((_a) & UINT32_MAX) * ((_b) >> 32); \
+  __typeof__(_a) __sop(var)(vlo) = ((_a) & UINT32_MAX) * ((_b) & UINT32_MAX); \
+  (_r) = __sop(var)(vlo) + (__sop(var)(vc) << 32); \
+  (_mt) ((((_a) >> 32) != 0) & (((_b) >> 32) != 0)) | \
+    (_mt) ((__sop(var)(vc) >> 32) != 0) | \
+    (_mt) ((_r) < __sop(var)(vlo)); \
+})
+
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_v_umul64x(_n, _a, _b, _r) \
+  __sop(m)(v_umul64)(sop_v_s64x##_n##_t, _a, _b, _r)
+
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_v_smul64x(_n, _a, _b, _r) ({ \
+  sop_v_u64x##_n##_t __sop(var)(vna) = \
+    (sop_v_u64x##_n##_t) ((sop_v_s64x##_n##_t) (_a) < 0); \
+  sop_v_u64x##_n##_t __sop(var)(vnb) = \
+    (sop_v_u64x##_n##_t) ((sop_v_s64x##_n##_t) (_b) < 0); \
+  sop_v_u64x##_n##_t __sop(var)(vneg) = __sop(var)(vna) ^ __sop(var)(vnb); \
+  sop_v_u64x##_n##_t __sop(var)(vmag); \
+  sop_v_s64x##_n##_t __sop(var)(vov) = __sop(m)(v_umul64)( \
+    sop_v_s64x##_n##_t, \
+    ((_a) ^ __sop(var)(vna)) - __sop(var)(vna), \
+    ((_b) ^ __sop(var)(vnb)) - __sop(var)(vnb), __sop(var)(vmag)); \
+  (_r) = (__sop(var)(vmag) ^ __sop(var)(vneg)) - __sop(var)(vneg); \
+  __sop(var)(vov) | (sop_v_s64x##_n##_t) \
+    (__sop(var)(vmag) > (uint64_t) INT64_MAX - __sop(var)(vneg)); \
+})
+
+#define OPAQUE_SAFE_IOP_PREFIX_MACRO_v_mul64(_s, _n, _dst, _A, _B) ({ \
+  sop_v_##_s##64x##_n##_t __sop(var)(va) = (_A); \
+  sop_v_##_s##64x##_n##_t __sop(var)(vb) = (_B); \
+  sop_v_##_s##64x##_n##_t *__sop(var)(vptr) = (_dst); \
+  sop_v_u64x##_n##_t __sop(var)(vr); \
+  sop_v_s64x##_n##_t __sop(var)(vov) = \
+    __sop(m)(v_##_s##mul64x)(_n, (sop_v_u64x##_n##_t) __sop(var)(va), \
+                             (sop_v_u64x##_n##_t) __sop(var)(vb), \
+                             __sop(var)(vr)); \
+  if (__sop(var)(vptr)) \
+    *__sop(var)(vptr) = (sop_v_##_s##64x##_n##_t) __sop(var)(vr); \
+  __sop(var)(vov); \
+})
+
+#define sop_v_any(_M) ({ \
+  typedef uint64_t __sop(var)(vq_t) __attribute__((vector_size(sizeof(_M)))); \
+  __sop(var)(vq_t) __sop(var)(vq) = (__sop(var)(vq_t)) (_M); \
+  uint64_t __sop(var)(vany) = 0; \
+  size_t __sop(var)(vi); \
+  for (__sop(var)(vi) = 0; \
+       __sop(var)(vi) < sizeof(__sop(var)(vq)) / sizeof(uint64_t); \
+       ++__sop(var)(vi)) \
+    __sop(var)(vany) |= __sop(var)(vq)[__sop(var)(vi)]; \
+  __sop(var)(vany) != 0; \
+})
+
+#define sop_v_add_u8x16(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, u, 8, 16, _dst, _A, _B)
+#define sop_v_sub_u8x16(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, u, 8, 16, _dst, _A, _B)
+#define sop_v_mul_u8x16(_dst, _A, _B) \
+  __sop(m)(v_mulw)(u, 8, 16, 16, _dst, _A, _B)
+#define sop_v_add_s8x16(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, s, 8, 16, _dst, _A, _B)
+#define sop_v_sub_s8x16(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, s, 8, 16, _dst, _A, _B)
+#define sop_v_mul_s8x16(_dst, _A, _B) \
+  __sop(m)(v_mulw)(s, 8, 16, 16, _dst, _A, _B)
+#define sop_v_add_u16x8(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, u, 16, 8, _dst, _A, _B)
+#define sop_v_sub_u16x8(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, u, 16, 8, _dst, _A, _B)
+#define sop_v_mul_u16x8(_dst, _A, _B) \
+  __sop(m)(v_mulw)(u, 16, 8, 32, _dst, _A, _B)
+#define sop_v_add_s16x8(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, s, 16, 8, _dst, _A, _B)
+#define sop_v_sub_s16x8(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, s, 16, 8, _dst, _A, _B)
+#define sop_v_mul_s16x8(_dst, _A, _B) \
+  __sop(m)(v_mulw)(s, 16, 8, 32, _dst, _A, _B)
+#define sop_v_add_u32x4(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, u, 32, 4, _dst, _A, _B)
+#define sop_v_sub_u32x4(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, u, 32, 4, _dst, _A, _B)
+#define sop_v_mul_u32x4(_dst, _A, _B) \
+  __sop(m)(v_mulw)(u, 32, 4, 64, _dst, _A, _B)
+#define sop_v_add_s32x4(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, s, 32, 4, _dst, _A, _B)
+#define sop_v_sub_s32x4(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, s, 32, 4, _dst, _A, _B)
+#define sop_v_mul_s32x4(_dst, _A, _B) \
+  __sop(m)(v_mulw)(s, 32, 4, 64, _dst, _A, _B)
+#define sop_v_add_u64x2(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, u, 64, 2, _dst, _A, _B)
+#define sop_v_sub_u64x2(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, u, 64, 2, _dst, _A, _B)
+#define sop_v_mul_u64x2(_dst, _A, _B) \
+  __sop(m)(v_mul64)(u, 2, _dst, _A, _B)
+#define sop_v_add_s64x2(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, s, 64, 2, _dst, _A, _B)
+#define sop_v_sub_s64x2(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, s, 64, 2, _dst, _A, _B)
+#define sop_v_mul_s64x2(_dst, _A, _B) \
+  __sop(m)(v_mul64)(s, 2, _dst, _A, _B)
+#define sop_v_add_u8x32(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, u, 8, 32, _dst, _A, _B)
+#define sop_v_sub_u8x32(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, u, 8, 32, _dst, _A, _B)
+#define sop_v_mul_u8x32(_dst, _A, _B) \
+  __sop(m)(v_mulw)(u, 8, 32, 16, _dst, _A, _B)
+#define sop_v_add_s8x32(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, s, 8, 32, _dst, _A, _B)
+#define sop_v_sub_s8x32(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, s, 8, 32, _dst, _A, _B)
+#define sop_v_mul_s8x32(_dst, _A, _B) \
+  __sop(m)(v_mulw)(s, 8, 32, 16, _dst, _A, _B)
+#define sop_v_add_u16x16(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, u, 16, 16, _dst, _A, _B)
+#define sop_v_sub_u16x16(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, u, 16, 16, _dst, _A, _B)
+#define sop_v_mul_u16x16(_dst, _A, _B) \
+  __sop(m)(v_mulw)(u, 16, 16, 32, _dst, _A, _B)
+#define sop_v_add_s16x16(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, s, 16, 16, _dst, _A, _B)
+#define sop_v_sub_s16x16(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, s, 16, 16, _dst, _A, _B)
+#define sop_v_mul_s16x16(_dst, _A, _B) \
+  __sop(m)(v_mulw)(s, 16, 16, 32, _dst, _A, _B)
+#define sop_v_add_u32x8(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, u, 32, 8, _dst, _A, _B)
+#define sop_v_sub_u32x8(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, u, 32, 8, _dst, _A, _B)
+#define sop_v_mul_u32x8(_dst, _A, _B) \
+  __sop(m)(v_mulw)(u, 32, 8, 64, _dst, _A, _B)
+#define sop_v_add_s32x8(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, s, 32, 8, _dst, _A, _B)
+#define sop_v_sub_s32x8(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, s, 32, 8, _dst, _A, _B)
+#define sop_v_mul_s32x8(_dst, _A, _B) \
+  __sop(m)(v_mulw)(s, 32, 8, 64, _dst, _A, _B)
+#define sop_v_add_u64x4(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, u, 64, 4, _dst, _A, _B)
+#define sop_v_sub_u64x4(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, u, 64, 4, _dst, _A, _B)
+#define sop_v_mul_u64x4(_dst, _A, _B) \
+  __sop(m)(v_mul64)(u, 4, _dst, _A, _B)
+#define sop_v_add_s64x4(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, s, 64, 4, _dst, _A, _B)
+#define sop_v_sub_s64x4(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, s, 64, 4, _dst, _A, _B)
+#define sop_v_mul_s64x4(_dst, _A, _B) \
+  __sop(m)(v_mul64)(s, 4, _dst, _A, _B)
+#define sop_v_add_u8x64(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, u, 8, 64, _dst, _A, _B)
+#define sop_v_sub_u8x64(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, u, 8, 64, _dst, _A, _B)
+#define sop_v_mul_u8x64(_dst, _A, _B) \
+  __sop(m)(v_mulw)(u, 8, 64, 16, _dst, _A, _B)
+#define sop_v_add_s8x64(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, s, 8, 64, _dst, _A, _B)
+#define sop_v_sub_s8x64(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, s, 8, 64, _dst, _A, _B)
+#define sop_v_mul_s8x64(_dst, _A, _B) \
+  __sop(m)(v_mulw)(s, 8, 64, 16, _dst, _A, _B)
+#define sop_v_add_u16x32(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, u, 16, 32, _dst, _A, _B)
+#define sop_v_sub_u16x32(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, u, 16, 32, _dst, _A, _B)
+#define sop_v_mul_u16x32(_dst, _A, _B) \
+  __sop(m)(v_mulw)(u, 16, 32, 32, _dst, _A, _B)
+#define sop_v_add_s16x32(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, s, 16, 32, _dst, _A, _B)
+#define sop_v_sub_s16x32(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, s, 16, 32, _dst, _A, _B)
+#define sop_v_mul_s16x32(_dst, _A, _B) \
+  __sop(m)(v_mulw)(s, 16, 32, 32, _dst, _A, _B)
+#define sop_v_add_u32x16(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, u, 32, 16, _dst, _A, _B)
+#define sop_v_sub_u32x16(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, u, 32, 16, _dst, _A, _B)
+#define sop_v_mul_u32x16(_dst, _A, _B) \
+  __sop(m)(v_mulw)(u, 32, 16, 64, _dst, _A, _B)
+#define sop_v_add_s32x16(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, s, 32, 16, _dst, _A, _B)
+#define sop_v_sub_s32x16(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, s, 32, 16, _dst, _A, _B)
+#define sop_v_mul_s32x16(_dst, _A, _B) \
+  __sop(m)(v_mulw)(s, 32, 16, 64, _dst, _A, _B)
+#define sop_v_add_u64x8(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, u, 64, 8, _dst, _A, _B)
+#define sop_v_sub_u64x8(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, u, 64, 8, _dst, _A, _B)
+#define sop_v_mul_u64x8(_dst, _A, _B) \
+  __sop(m)(v_mul64)(u, 8, _dst, _A, _B)
+#define sop_v_add_s64x8(_dst, _A, _B) \
+  __sop(m)(v_arith)(add, s, 64, 8, _dst, _A, _B)
+#define sop_v_sub_s64x8(_dst, _A, _B) \
+  __sop(m)(v_arith)(sub, s, 64, 8, _dst, _A, _B)
+#define sop_v_mul_s64x8(_dst, _A, _B) \
+  __sop(m)(v_mul64)(s, 8, _dst, _A, _B)
+
 #endif /* __GNUC__ */
 
 #endif  /* _SAFE_IOP_H */
@@ -0,0 +1,385 @@
+/* safe_iop.hpp
+ * Author:: Will Drewry <redpig@dataspill.org>
+ * See safe_iop.h for more info.
+ *
+ * Copyright (c) 2007,2008 Will Drewry <redpig@dataspill.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * C++20 interface to sopf formats
+ *
+ * sop::sopf takes the format as a template argument.  The format is parsed
+ * while compiling and a malformed format is a compile error, as is passing
+ * the wrong number of arguments.  What is left at runtime is the sequence of
+ * same-type safe_iop macros the format describes, exactly as if the
+ * sop_<op>x calls had been written out by hand.  Nothing is parsed at
+ * runtime, there are no varargs, and libsafe_iop is not needed.
+ *
+ *   uint64_t sz;
+ *   if (!sop::sopf<"u64=u32*u32+u16">(&sz, w, h, pad))
+ *     abort();
+ *
+ * The format language is the one documented for sopf in safe_iop.h, with a
+ * few differences that fall out of having real argument types:
+ * - each argument is range checked against its operand's type marker
+ *   instead of being truncated to it.
+ * - the final value is range checked against the type of *result.
+ * - result may be NULL, in which case only the checks are performed.
+ *
+ * Requires a C++20 compiler (class type template arguments and consteval).
+ */
+#ifndef _SAFE_IOP_HPP
+#define _SAFE_IOP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <safe_iop.h>
+
+namespace sop {
+namespace detail {
+
+enum class type : unsigned char { none, u8, s8, u16, s16, u32, s32, u64, s64 };
+enum class op : unsigned char { arg = 1, add, sub, mul, div, mod, shl, shr };
+
+/* Same limits, and the same precedence levels, as sopf in safe_iop.c */
+inline constexpr std::size_t max_insns = SOPF_MAX_INSNS;
+inline constexpr std::size_t max_depth = 16;
+inline constexpr int prec_shift = 1;
+inline constexpr int prec_add = 2;
+inline constexpr int prec_mul = 3;
+
+struct insn {
+  op o = op::arg;
+  type t = type::none;
+  unsigned char sp = 0;   /* stack depth before the instruction */
+  unsigned char arg = 0;  /* argument index of op::arg */
+};
+
+struct program {
+  bool ok = false;
+  bool wide = false;
+  type lhs = type::s32;
+  std::size_t nargs = 0;
+  std::size_t ninsns = 0;
+  std::size_t depth = 0;  /* deepest the stack gets */
+  insn insns[max_insns] = {};
+};
+
+/* parser
+ * A constexpr copy of the sopf compiler in safe_iop.c.  Precedence climbing
+ * emits a postfix program with the stack slot of every instruction already
+ * worked out.
+ */
+class parser {
+ public:
+  constexpr explicit parser(const char *fmt) : c_(fmt) {}
+
+  constexpr program compile() {
+    if (c_ == nullptr || *c_ == '\0')
+      return prog_;
+    if (*c_ == '#') {
+      prog_.wide = true;
+      c_++;
+    }
+    parse_result();
+    if (!parse_expr(prec_shift))
+      return prog_;
+    /* Trailing garbage, an unmatched ')', or an unknown operator */
+    if (*c_ != '\0' || sp_ != 1)
+      return prog_;
+    prog_.ok = true;
+    return prog_;
+  }
+
+ private:
+  constexpr void skip_space() {
+    while (*c_ == ' ' || *c_ == '\t')
+      c_++;
+  }
+
+  /* Advances past a type marker if there is one.  Unknown markers are left
+   * in place to be caught as trailing garbage. */
+  constexpr void read_type(type *t) {
+    const bool u = (*c_ == 'u');
+    if (!u && *c_ != 's')
+      return;
+    if (c_[1] == '8') {
+      *t = u ? type::u8 : type::s8;
+      c_ += 2;
+    } else if (c_[1] == '1' && c_[2] == '6') {
+      *t = u ? type::u16 : type::s16;
+      c_ += 3;
+    } else if (c_[1] == '3' && c_[2] == '2') {
+      *t = u ? type::u32 : type::s32;
+      c_ += 3;
+    } else if (c_[1] == '6' && c_[2] == '4') {
+      *t = u ? type::u64 : type::s64;
+      c_ += 3;
+    }
+  }
+
+  constexpr bool emit(op o, type t) {
+    if (prog_.ninsns == max_insns)
+      return false;
+    insn &i = prog_.insns[prog_.ninsns++];
+    i.o = o;
+    i.t = t;
+    i.sp = static_cast<unsigned char>(sp_);
+    if (o == op::arg) {
+      if (sp_ == max_depth)
+        return false;
+      i.arg = static_cast<unsigned char>(prog_.nargs++);
+      if (++sp_ > prog_.depth)
+        prog_.depth = sp_;
+      return true;
+    }
+    if (sp_ < 2)
+      return false;
+    sp_--;
+    return true;
+  }
+
+  /* result := [type_marker '='] */
+  constexpr void parse_result() {
+    const char *start;
+    type t = prog_.lhs;
+    skip_space();
+    start = c_;
+    read_type(&t);
+    if (c_ != start) {
+      skip_space();
+      if (*c_ == '=') {
+        prog_.lhs = t;
+        result_given_ = true;
+        c_++;
+        return;
+      }
+    }
+    c_ = start;
+  }
+
+  /* primary := '(' expr ')' | [type_marker] */
+  constexpr bool parse_primary() {
+    skip_space();
+    if (*c_ == '(') {
+      if (++nesting_ > max_depth)
+        return false;
+      c_++;
+      if (!parse_expr(prec_shift))
+        return false;
+      skip_space();
+      if (*c_ != ')')
+        return false;
+      c_++;
+      nesting_--;
+    } else {
+      type t = prog_.lhs;
+      read_type(&t);
+      if (prog_.nargs == 0 && !result_given_)
+        prog_.lhs = t;
+      if (!emit(op::arg, t))
+        return false;
+    }
+    skip_space();
+    return true;
+  }
+
+  /* Returns the length of the operator at c_, or 0. */
+  constexpr std::size_t read_op(op *o, int *prec) const {
+    switch (*c_) {
+      case '*': *o = op::mul; *prec = prec_mul; return 1;
+      case '/': *o = op::div; *prec = prec_mul; return 1;
+      case '%': *o = op::mod; *prec = prec_mul; return 1;
+      case '+': *o = op::add; *prec = prec_add; return 1;
+      case '-': *o = op::sub; *prec = prec_add; return 1;
+      case '<':
+        if (c_[1] != '<')
+          return 0;
+        *o = op::shl; *prec = prec_shift; return 2;
+      case '>':
+        if (c_[1] != '>')
+          return 0;
+        *o = op::shr; *prec = prec_shift; return 2;
+      default:
+        return 0;
+    }
+  }
+
+  /* expr := primary (operator expr)*, climbing by precedence */
+  constexpr bool parse_expr(int min_prec) {
+    if (!parse_primary())
+      return false;
+    for (;;) {
+      op o = op::arg;
+      int prec = 0;
+      std::size_t len;
+      skip_space();
+      len = read_op(&o, &prec);
+      if (len == 0 || prec < min_prec)
+        return true;
+      c_ += len;
+      if (!parse_expr(prec + 1))
+        return false;
+      if (!emit(o, prog_.lhs))
+        return false;
+    }
+  }
+
+  const char *c_;
+  program prog_{};
+  std::size_t sp_ = 0;
+  std::size_t nesting_ = 0;
+  bool result_given_ = false;
+};
+
+constexpr program compile(const char *fmt) {
+  return parser(fmt).compile();
+}
+
+/* Called from a consteval context to turn a bad format into a compile
+ * error.  Deliberately not constexpr. */
+inline void malformed_sopf_format() {}
+
+template <type T> struct ctype;
+template <> struct ctype<type::u8>  { typedef uint8_t t; };
+template <> struct ctype<type::s8>  { typedef int8_t t; };
+template <> struct ctype<type::u16> { typedef uint16_t t; };
+template <> struct ctype<type::s16> { typedef int16_t t; };
+template <> struct ctype<type::u32> { typedef uint32_t t; };
+template <> struct ctype<type::s32> { typedef int32_t t; };
+template <> struct ctype<type::u64> { typedef uint64_t t; };
+template <> struct ctype<type::s64> { typedef int64_t t; };
+
+/* The "#" wide-intermediate type, as in safe_iop.c */
+#if defined(__SIZEOF_INT128__)
+typedef __int128 wide_t;
+#else
+typedef intmax_t wide_t;
+#endif
+
+/* std::is_signed is false for __int128 in strict modes */
+template <class T>
+inline constexpr bool is_signed = (static_cast<T>(-1) < static_cast<T>(0));
+
+template <class To, class From>
+inline bool cast(To *r, From v) {
+  if (!sop_safe_cast(is_signed<To>, To, 0, is_signed<From>, From, v))
+    return false;
+  *r = static_cast<To>(v);
+  return true;
+}
+
+#define _SOP_HPP_APPLY(_op) \
+  if constexpr (O == op::_op) { \
+    if constexpr (is_signed<T>) \
+      return sop_s##_op(1, T, r, 1, T, a, 1, T, b); \
+    else \
+      return sop_u##_op(0, T, r, 0, T, a, 0, T, b); \
+  }
+
+/* apply
+ * r = a op b in T using the same-type macros.
+ */
+template <op O, class T>
+inline bool apply(T *r, T a, T b) {
+  _SOP_HPP_APPLY(add)
+  _SOP_HPP_APPLY(sub)
+  _SOP_HPP_APPLY(mul)
+  _SOP_HPP_APPLY(div)
+  _SOP_HPP_APPLY(mod)
+  _SOP_HPP_APPLY(shl)
+  _SOP_HPP_APPLY(shr)
+  return false;
+}
+
+#undef _SOP_HPP_APPLY
+
+/* step
+ * Runs a single instruction.  Every index and type is a constant, so each
+ * step is one checked cast or one same-type macro.
+ */
+template <insn I, class W, class Args>
+inline bool step(W *stack, const Args &args) {
+  if constexpr (I.o == op::arg) {
+    typedef typename ctype<I.t>::t M;
+    typedef std::remove_cvref_t<std::tuple_element_t<I.arg, Args>> A;
+    static_assert(std::is_integral_v<A>,
+                  "sop::sopf: arguments must be of integral type");
+    M m = 0;
+    return cast(&m, std::get<I.arg>(args)) && cast(&stack[I.sp], m);
+  } else {
+    return apply<I.o>(&stack[I.sp - 2], stack[I.sp - 2], stack[I.sp - 1]);
+  }
+}
+
+}  /* namespace detail */
+
+/* format
+ * A sopf format checked at compile time.  Only ever constructed from a
+ * string literal template argument.
+ */
+struct format {
+  detail::program prog;
+
+  consteval format(const char *fmt) : prog(detail::compile(fmt)) {
+    if (!prog.ok)
+      detail::malformed_sopf_format();
+  }
+};
+
+/* sopf
+ *
+ * Evaluates the format F over args and stores the value in *result.
+ * Output:
+ * - Returns true on success
+ * - Returns false on failure leaving *result untouched
+ */
+template <format F, class R, class... A>
+inline bool sopf(R *result, A... args) {
+  constexpr detail::program p = F.prog;
+  typedef typename detail::ctype<p.lhs>::t L;
+  typedef std::conditional_t<p.wide, detail::wide_t, L> W;
+  static_assert(sizeof...(A) == p.nargs,
+                "sop::sopf: argument count does not match the format");
+  static_assert(std::is_integral_v<R>,
+                "sop::sopf: result must be of integral type");
+
+  W stack[p.depth];
+  const std::tuple<A...> tup(args...);
+  const bool ok = [&]<std::size_t... I>(std::index_sequence<I...>) {
+    return (detail::step<p.insns[I]>(stack, tup) && ...);
+  }(std::make_index_sequence<p.ninsns>{});
+  L value = 0;
+  R out = 0;
+
+  if (!ok || !detail::cast(&value, stack[0]) || !detail::cast(&out, value))
+    return false;
+  if (result != nullptr)
+    *result = out;
+  return true;
+}
+
+/* A literal NULL or nullptr result only checks, in the format's own type. */
+template <format F, class... A>
+inline bool sopf(std::nullptr_t, A... args) {
+  typedef typename detail::ctype<F.prog.lhs>::t L;
+  return sopf<F>(static_cast<L *>(nullptr), args...);
+}
+
+}  /* namespace sop */
+
+#endif  /* _SAFE_IOP_HPP */
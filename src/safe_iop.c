@@ -18,6 +18,7 @@
  */
 #include <stdint.h>
 #include <stdarg.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 #include <safe_iop.h>
@@ -99,2302 +100,928 @@ static int _sopf_read_type(sop_type_t *type, const char **c) {
   return 1;
 }
 
-/* Repeated code for va_args is here.  More code is not factored out this
- * way due to the C99 4096 byte limit for expanded macro text.  */
-#define _SAFE_IOP_TYPE_CASE(_lhs, _va_lhs, _lhs_a, _rhs, _va_rhs, _rhs_a, _func) { \
-  _rhs a; \
-  _lhs value, *_h = (_lhs *) holder; \
-  if (!baseline) { \
-    value = (_lhs) va_arg(ap, _va_lhs); \
-    a = (_rhs) va_arg(ap, _va_rhs); \
-    baseline = 1; \
-  } else { \
-    value = *_h; \
-    a = (_rhs) va_arg(ap, _va_rhs); \
-  } \
-  if (! _func(sop_##_lhs_a(_h), sop_##_lhs_a(value), sop_##_rhs_a(a))) \
-    return 0; \
+/* sopf programs
+ * sopf compiles the format string into a small stack program before any of
+ * the arguments are touched.  Operands are emitted in the order they appear
+ * in the format, which is also the va_arg order, and operators are emitted
+ * after their operands (postfix).  This means precedence and parentheses are
+ * resolved entirely at compile time and evaluation is a single pass over the
+ * program and the argument list.
+ */
+typedef enum { SOPF_OP_ARG = 1, /* push the next argument */
+               SOPF_OP_ADD,
+               SOPF_OP_SUB,
+               SOPF_OP_MUL,
+               SOPF_OP_DIV,
+               SOPF_OP_MOD,
+               SOPF_OP_SHL,
+               SOPF_OP_SHR,
+               } sopf_op_t;
+
+/* Binding strength of the operators.  These follow C: shifts bind loosest,
+ * then addition and subtraction, then multiplication, division and modulo.
+ * All operators are left associative.
+ */
+#define SOPF_PREC_SHIFT 1
+#define SOPF_PREC_ADD 2
+#define SOPF_PREC_MUL 3
+
+/* Upper bound on the evaluation stack.  This keeps the stack off of the heap.
+ * The program size limit, SOPF_MAX_INSNS, lives in the header.
+ */
+#define SOPF_MAX_DEPTH 16
+
+/* Wide-intermediate mode ("#" prefix) evaluates in the widest type
+ * available and only checks the final value against the lhs type.
+ */
+#if defined(__SIZEOF_INT128__)
+typedef __int128 sopf_wide_t;
+#else
+typedef intmax_t sopf_wide_t;
+#endif
+
+#define SOPF_FLAG_WIDE 0x1
+
+/* Compile-time state which does not need to outlive _sopf_compile. */
+typedef struct {
+  sopf_prog_t *prog;
+  const char *c;
+  unsigned int depth;    /* stack depth at the current instruction */
+  unsigned int nesting;  /* parenthesis nesting */
+  int result_given;      /* lhs type was given explicitly with "<type>=" */
+} sopf_parser_t;
+
+/* Holds a single value of the lhs type on the evaluation stack. */
+typedef union {
+  uint8_t u8;
+  int8_t s8;
+  uint16_t u16;
+  int16_t s16;
+  uint32_t u32;
+  int32_t s32;
+  uint64_t u64;
+  int64_t s64;
+  sopf_wide_t wide;
+} sopf_value_t;
+
+static void _sopf_skip_space(sopf_parser_t *p) {
+  while (*p->c == ' ' || *p->c == '\t')
+    p->c++;
+}
+
+/* _sopf_emit
+ * Appends an instruction to the program while keeping track of the
+ * stack depth the program will need at runtime.
+ */
+static int _sopf_emit(sopf_parser_t *p, sopf_op_t op, sop_type_t type) {
+  if (p->prog->ninsns >= SOPF_MAX_INSNS)
+    return 0;
+  if (op == SOPF_OP_ARG) {
+    if (++p->depth > SOPF_MAX_DEPTH)
+      return 0;
+    p->prog->nargs++;
+  } else {
+    /* pops two, pushes one */
+    if (p->depth < 2)
+      return 0;
+    p->depth--;
+  }
+  p->prog->insns[p->prog->ninsns].op = (unsigned char) op;
+  p->prog->insns[p->prog->ninsns].type = (unsigned char) type;
+  p->prog->ninsns++;
+  return 1;
+}
+
+/* _sopf_read_op
+ * Reads the operator at c, if any, without advancing past it.
+ * Returns the length of the operator or 0 if there isn't one.
+ */
+static int _sopf_read_op(const char *c, sopf_op_t *op, int *prec) {
+  switch (*c) {
+    case '*': *op = SOPF_OP_MUL; *prec = SOPF_PREC_MUL; return 1;
+    case '/': *op = SOPF_OP_DIV; *prec = SOPF_PREC_MUL; return 1;
+    case '%': *op = SOPF_OP_MOD; *prec = SOPF_PREC_MUL; return 1;
+    case '+': *op = SOPF_OP_ADD; *prec = SOPF_PREC_ADD; return 1;
+    case '-': *op = SOPF_OP_SUB; *prec = SOPF_PREC_ADD; return 1;
+    case '<':
+      if (*(c+1) != '<')
+        return 0;
+      *op = SOPF_OP_SHL; *prec = SOPF_PREC_SHIFT;
+      return 2;
+    case '>':
+      if (*(c+1) != '>')
+        return 0;
+      *op = SOPF_OP_SHR; *prec = SOPF_PREC_SHIFT;
+      return 2;
+    default:
+      return 0;
+  }
+}
+
+static int _sopf_parse_expr(sopf_parser_t *p, int min_prec);
+
+/* _sopf_parse_primary
+ * primary := '(' expr ')' | [type_marker]
+ * An operand may be empty, in which case it takes on the lhs type.  Unless
+ * a result type was given, the first operand seen fixes the lhs type.
+ */
+static int _sopf_parse_primary(sopf_parser_t *p) {
+  _sopf_skip_space(p);
+  if (*p->c == '(') {
+    if (++p->nesting > SOPF_MAX_DEPTH)
+      return 0;
+    p->c++;
+    if (!_sopf_parse_expr(p, SOPF_PREC_SHIFT))
+      return 0;
+    _sopf_skip_space(p);
+    if (*p->c != ')')
+      return 0;
+    p->c++;
+    p->nesting--;
+  } else {
+    sop_type_t type = p->prog->lhs;
+    if (!_sopf_read_type(&type, &p->c))
+      return 0;
+    if (p->prog->nargs == 0 && !p->result_given)
+      p->prog->lhs = type;
+    if (!_sopf_emit(p, SOPF_OP_ARG, type))
+      return 0;
+  }
+  _sopf_skip_space(p);
+  return 1;
+}
+
+/* _sopf_parse_expr
+ * Precedence climbing: parses a run of operators which bind at least as
+ * tightly as min_prec.
+ */
+static int _sopf_parse_expr(sopf_parser_t *p, int min_prec) {
+  sopf_op_t op;
+  int prec = 0, len = 0;
+  if (!_sopf_parse_primary(p))
+    return 0;
+  while ((len = _sopf_read_op(p->c, &op, &prec)) != 0 && prec >= min_prec) {
+    p->c += len;
+    /* left associative: the right-hand side must bind strictly tighter */
+    if (!_sopf_parse_expr(p, prec + 1))
+      return 0;
+    if (!_sopf_emit(p, op, p->prog->lhs))
+      return 0;
+  }
+  return 1;
+}
+
+/* _sopf_parse_result
+ * result := [type_marker '=']
+ * Consumes an explicit result type if one is present.  Otherwise the format
+ * is left untouched.
+ */
+static void _sopf_parse_result(sopf_parser_t *p) {
+  sop_type_t type = p->prog->lhs;
+  const char *c;
+  _sopf_skip_space(p);
+  c = p->c;
+  if (!_sopf_read_type(&type, &c) || c == p->c)
+    return;
+  while (*c == ' ' || *c == '\t')
+    c++;
+  if (*c != '=')
+    return;
+  p->prog->lhs = type;
+  p->result_given = 1;
+  p->c = c + 1;
 }
 
+/* See header file for details. */
+int sopf_compile(sopf_prog_t *prog, const char *const fmt) {
+  sopf_parser_t p;
+  if (prog == NULL || fmt == NULL || *fmt == '\0')
+    return 0;
+  memset(prog, 0, sizeof(*prog));
+  prog->lhs = SAFE_IOP_TYPE_DEFAULT;
+  p.prog = prog;
+  p.c = fmt;
+  if (*p.c == '#') {
+    prog->flags |= SOPF_FLAG_WIDE;
+    p.c++;
+  }
+  p.depth = 0;
+  p.nesting = 0;
+  p.result_given = 0;
+  _sopf_parse_result(&p);
+  if (!_sopf_parse_expr(&p, SOPF_PREC_SHIFT))
+    return 0;
+  /* Trailing garbage, an unmatched ')', or an unknown operator */
+  if (*p.c != '\0')
+    return 0;
+  return (p.depth == 1);
+}
+
+/* _sopf_read_arg
+ * Reads the next argument as the given type.  Signed values are returned in
+ * s and unsigned values in u.
+ */
+static int _sopf_read_arg(sop_type_t type, va_list *ap,
+                          int *sign, intmax_t *s, uintmax_t *u) {
+  *sign = 0;
+  switch (type) {
+    case SAFE_IOP_TYPE_U8: *u = (uint8_t) va_arg(*ap, uint32_t); break;
+    case SAFE_IOP_TYPE_U16: *u = (uint16_t) va_arg(*ap, uint32_t); break;
+    case SAFE_IOP_TYPE_U32: *u = va_arg(*ap, uint32_t); break;
+    case SAFE_IOP_TYPE_U64: *u = va_arg(*ap, uint64_t); break;
+    case SAFE_IOP_TYPE_S8: *s = (int8_t) va_arg(*ap, int32_t); *sign = 1; break;
+    case SAFE_IOP_TYPE_S16: *s = (int16_t) va_arg(*ap, int32_t); *sign = 1; break;
+    case SAFE_IOP_TYPE_S32: *s = va_arg(*ap, int32_t); *sign = 1; break;
+    case SAFE_IOP_TYPE_S64: *s = va_arg(*ap, int64_t); *sign = 1; break;
+    default:
+      return 0;
+  }
+  return 1;
+}
+
+/* Stores a value in the lhs type if it can be represented without a change
+ * in value (see sop_safe_cast). */
+#define _SOPF_CAST_CASE(_enum, _field, _type, _sign) \
+  case _enum: \
+    if (sign ? !sop_safe_cast(_sign, _type, 0, 1, intmax_t, s) \
+             : !sop_safe_cast(_sign, _type, 0, 0, uintmax_t, u)) \
+      return 0; \
+    v->_field = sign ? (_type) s : (_type) u; \
+    return 1;
+
+/* _sopf_cast
+ * Casts a signed (s) or unsigned (u) value to the lhs type.
+ */
+static int _sopf_cast(sopf_value_t *v, sop_type_t lhs,
+                      int sign, intmax_t s, uintmax_t u) {
+  switch (lhs) {
+    _SOPF_CAST_CASE(SAFE_IOP_TYPE_U8, u8, uint8_t, 0)
+    _SOPF_CAST_CASE(SAFE_IOP_TYPE_S8, s8, int8_t, 1)
+    _SOPF_CAST_CASE(SAFE_IOP_TYPE_U16, u16, uint16_t, 0)
+    _SOPF_CAST_CASE(SAFE_IOP_TYPE_S16, s16, int16_t, 1)
+    _SOPF_CAST_CASE(SAFE_IOP_TYPE_U32, u32, uint32_t, 0)
+    _SOPF_CAST_CASE(SAFE_IOP_TYPE_S32, s32, int32_t, 1)
+    _SOPF_CAST_CASE(SAFE_IOP_TYPE_U64, u64, uint64_t, 0)
+    _SOPF_CAST_CASE(SAFE_IOP_TYPE_S64, s64, int64_t, 1)
+    default:
+      return 0;
+  }
+}
+
+/* _sopf_load
+ * Reads the next argument as the given type and casts it to the lhs type, or
+ * to sopf_wide_t in wide mode.
+ */
+static int _sopf_load(sopf_value_t *v, const sopf_prog_t *prog,
+                      sop_type_t type, va_list *ap) {
+  intmax_t s = 0;
+  uintmax_t u = 0;
+  int sign = 0;
+  if (!_sopf_read_arg(type, ap, &sign, &s, &u))
+    return 0;
+  if (!(prog->flags & SOPF_FLAG_WIDE))
+    return _sopf_cast(v, prog->lhs, sign, s, u);
+  /* Only fails when sopf_wide_t is no wider than uintmax_t */
+  if (!sign && !sop_safe_cast(1, sopf_wide_t, 0, 0, uintmax_t, u))
+    return 0;
+  v->wide = sign ? (sopf_wide_t) s : (sopf_wide_t) u;
+  return 1;
+}
+
+/* _sopf_narrow
+ * Performs the single range check of wide mode: casts the final wide value
+ * back to the lhs type.
+ */
+static int _sopf_narrow(sopf_value_t *v, sop_type_t lhs) {
+  sopf_wide_t w = v->wide;
+  if (sop_safe_cast(1, intmax_t, 0, 1, sopf_wide_t, w))
+    return _sopf_cast(v, lhs, 1, (intmax_t) w, 0);
+  if (sop_safe_cast(0, uintmax_t, 0, 1, sopf_wide_t, w))
+    return _sopf_cast(v, lhs, 0, 0, (uintmax_t) w);
+  return 0;
+}
+
+/* Both operands are already of the lhs type so the same-type macros are
+ * called directly rather than going through the cast checks in sop_<op>x. */
+#define _SOPF_OP(_op, _m, _r, _a, _b) \
+  sop_##_op##_sop_##_m(_r)(sop_signed_sop_##_m(_r), sop_typeof_sop_##_m(_r), \
+                             (_r), \
+                           sop_signed_sop_##_m(_a), sop_typeof_sop_##_m(_a), \
+                             (_a), \
+                           sop_signed_sop_##_m(_b), sop_typeof_sop_##_m(_b), \
+                             (_b))
+
+#define _SOPF_APPLY_CASE(_enum, _m) \
+  case _enum: { \
+    sop_typeof_sop_##_m(x) x = a->_m, y = b->_m; \
+    switch (op) { \
+      case SOPF_OP_ADD: return _SOPF_OP(add, _m, &a->_m, x, y); \
+      case SOPF_OP_SUB: return _SOPF_OP(sub, _m, &a->_m, x, y); \
+      case SOPF_OP_MUL: return _SOPF_OP(mul, _m, &a->_m, x, y); \
+      case SOPF_OP_DIV: return _SOPF_OP(div, _m, &a->_m, x, y); \
+      case SOPF_OP_MOD: return _SOPF_OP(mod, _m, &a->_m, x, y); \
+      case SOPF_OP_SHL: return _SOPF_OP(shl, _m, &a->_m, x, y); \
+      case SOPF_OP_SHR: return _SOPF_OP(shr, _m, &a->_m, x, y); \
+      default: return 0; \
+    } \
+  }
+
+#define _SOPF_WIDE_OP(_op, _r, _a, _b) \
+  sop_s##_op(1, sopf_wide_t, (_r), 1, sopf_wide_t, (_a), 1, sopf_wide_t, (_b))
+
+/* _sopf_apply_wide
+ * Performs a op= b in sopf_wide_t.  Only overflow of sopf_wide_t itself
+ * is checked here.
+ */
+static int _sopf_apply_wide(sopf_op_t op,
+                            sopf_value_t *a, const sopf_value_t *b) {
+  sopf_wide_t x = a->wide, y = b->wide;
+  switch (op) {
+    case SOPF_OP_ADD: return _SOPF_WIDE_OP(add, &a->wide, x, y);
+    case SOPF_OP_SUB: return _SOPF_WIDE_OP(sub, &a->wide, x, y);
+    case SOPF_OP_MUL: return _SOPF_WIDE_OP(mul, &a->wide, x, y);
+    case SOPF_OP_DIV: return _SOPF_WIDE_OP(div, &a->wide, x, y);
+    case SOPF_OP_MOD: return _SOPF_WIDE_OP(mod, &a->wide, x, y);
+    case SOPF_OP_SHL: return _SOPF_WIDE_OP(shl, &a->wide, x, y);
+    case SOPF_OP_SHR: return _SOPF_WIDE_OP(shr, &a->wide, x, y);
+    default: return 0;
+  }
+}
+
+/* _sopf_apply
+ * Performs a op= b in the lhs type.  a is left untouched on failure.
+ */
+static int _sopf_apply(sop_type_t lhs, sopf_op_t op,
+                       sopf_value_t *a, const sopf_value_t *b) {
+  switch (lhs) {
+    _SOPF_APPLY_CASE(SAFE_IOP_TYPE_U8, u8)
+    _SOPF_APPLY_CASE(SAFE_IOP_TYPE_S8, s8)
+    _SOPF_APPLY_CASE(SAFE_IOP_TYPE_U16, u16)
+    _SOPF_APPLY_CASE(SAFE_IOP_TYPE_S16, s16)
+    _SOPF_APPLY_CASE(SAFE_IOP_TYPE_U32, u32)
+    _SOPF_APPLY_CASE(SAFE_IOP_TYPE_S32, s32)
+    _SOPF_APPLY_CASE(SAFE_IOP_TYPE_U64, u64)
+    _SOPF_APPLY_CASE(SAFE_IOP_TYPE_S64, s64)
+    default:
+      return 0;
+  }
+}
+
+/* _sopf_run
+ * Evaluates a compiled program against the argument list.  result is only
+ * written to if every operation succeeds.
+ */
+static int _sopf_run(const sopf_prog_t *prog, void *result, va_list *ap) {
+  sopf_value_t stack[SOPF_MAX_DEPTH];
+  unsigned int i, sp = 0;
+
+  for (i = 0; i < prog->ninsns; ++i) {
+    const sopf_insn_t *insn = &prog->insns[i];
+    if (insn->op == SOPF_OP_ARG) {
+      if (!_sopf_load(&stack[sp++], prog, (sop_type_t) insn->type, ap))
+        return 0;
+    } else if (prog->flags & SOPF_FLAG_WIDE) {
+      sp--;
+      if (!_sopf_apply_wide((sopf_op_t) insn->op, &stack[sp-1], &stack[sp]))
+        return 0;
+    } else {
+      sp--;
+      if (!_sopf_apply(prog->lhs, (sopf_op_t) insn->op,
+                       &stack[sp-1], &stack[sp]))
+        return 0;
+    }
+  }
+  if ((prog->flags & SOPF_FLAG_WIDE) && !_sopf_narrow(&stack[0], prog->lhs))
+    return 0;
+  /* Success! Assign the value back to result using the stored lhs */
+  if (result) {
+    switch (prog->lhs) {
+      case SAFE_IOP_TYPE_U8: *((uint8_t *) result) = stack[0].u8; break;
+      case SAFE_IOP_TYPE_S8: *((int8_t *) result) = stack[0].s8; break;
+      case SAFE_IOP_TYPE_U16: *((uint16_t *) result) = stack[0].u16; break;
+      case SAFE_IOP_TYPE_S16: *((int16_t *) result) = stack[0].s16; break;
+      case SAFE_IOP_TYPE_U32: *((uint32_t *) result) = stack[0].u32; break;
+      case SAFE_IOP_TYPE_S32: *((int32_t *) result) = stack[0].s32; break;
+      case SAFE_IOP_TYPE_U64: *((uint64_t *) result) = stack[0].u64; break;
+      case SAFE_IOP_TYPE_S64: *((int64_t *) result) = stack[0].s64; break;
+      default:
+        /* bad sign. maybe this should abort. */
+        return 0;
+    }
+  }
+  return 1;
+}
 
 /* See header file for details. Or the README :) */
 int sopf(void *result, const char *const fmt, ...) {
   va_list ap;
-  int baseline = 0; /* indicates if the base value is present */
+  sopf_prog_t prog;
+  int ok = 0;
 
-  const char *c = NULL;
-  /* Holds the interim values and allows for result to be NULL. */
-  unsigned char holder[sizeof(intmax_t)] = {0};
-  sop_type_t lhs = SAFE_IOP_TYPE_DEFAULT, rhs = SAFE_IOP_TYPE_DEFAULT;
+  if (!sopf_compile(&prog, fmt))
+    return 0;
 
   va_start(ap, fmt);
-  if (fmt == NULL || fmt[0] == '\0')
-    return 0;
+  ok = _sopf_run(&prog, result, &ap);
+  va_end(ap);
+  return ok;
+}
 
-  /* Read the left-hand side type for the operation type if giveṅ.
-   * sop_iop(f) always casts to the left so this is only read once
-   * then carried through.
-   */
-  c=fmt;
-  if (!_sopf_read_type(&lhs, &c)) {
-    return 0;
+/* sopf_batch
+ * Evaluates a program column-wise: SOPF_BATCH_ROWS rows at a time, each
+ * instruction is applied to a whole block of rows before moving on to the
+ * next.  Every instruction maps to one kernel, a tight loop over the block
+ * for a single operand type and operation, and the kernels are looked up
+ * once per call rather than once per row.
+ */
+#define SOPF_BATCH_ROWS 128
+
+typedef void (*sopf_kern_t)(void *dst, const void *src,
+                            unsigned char *fail, size_t n);
+
+/* Casts a block of operands to the lhs type (or sopf_wide_t). */
+#define _SOPF_LOAD_KERN(_dm, _dt, _ds, _sm, _st, _ss) \
+  static void _sopf_load_##_sm##_##_dm(void *dst, const void *src, \
+                                       unsigned char *fail, size_t n) { \
+    const _st *s = (const _st *) src; \
+    _dt *d = (_dt *) dst; \
+    size_t i; \
+    for (i = 0; i < n; ++i) { \
+      if (sop_safe_cast(_ds, _dt, 0, _ss, _st, s[i])) { \
+        d[i] = (_dt) s[i]; \
+      } else { \
+        d[i] = 0; \
+        fail[i] = 1; \
+      } \
+    } \
   }
 
-  while (*c) {
-    /* Process the the operations */
-    switch(*(c++)) { /* operation */
-      case '+': /* add */
-        /* Read the right-hand side type for the operation type if given */
-        if (!_sopf_read_type(&rhs, &c))
-          return 0;
-        switch (lhs) {
-          case SAFE_IOP_TYPE_U8:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint8_t, uint32_t, u8, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int8_t, int32_t, s8, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint16_t, uint32_t, u16, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int16_t, int32_t, s16, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint32_t, uint32_t, u32, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int32_t, int32_t, s32, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint64_t, uint64_t, u64, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int64_t, int64_t, s64, sop_addx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S8:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint8_t, uint32_t, u8, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int8_t, int32_t, s8, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint16_t, uint32_t, u16, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int16_t, int32_t, s16, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint32_t, uint32_t, u32, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int32_t, int32_t, s32, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint64_t, uint64_t, u64, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int64_t, int64_t, s64, sop_addx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_U16:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint8_t, uint32_t, u8, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int8_t, int32_t, s8, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint16_t, uint32_t, u16, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int16_t, int32_t, s16, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint32_t, uint32_t, u32, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int32_t, int32_t, s32, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint64_t, uint64_t, u64, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int64_t, int64_t, s64, sop_addx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S16:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint8_t, uint32_t, u8, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int8_t, int32_t, s8, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint16_t, uint32_t, u16, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int16_t, int32_t, s16, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint32_t, uint32_t, u32, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int32_t, int32_t, s32, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint64_t, uint64_t, u64, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int64_t, int64_t, s64, sop_addx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_U32:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint8_t, uint32_t, u8, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int8_t, int32_t, s8, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint16_t, uint32_t, u16, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int16_t, int32_t, s16, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint32_t, uint32_t, u32, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int32_t, int32_t, s32, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint64_t, uint64_t, u64, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int64_t, int64_t, s64, sop_addx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S32:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint8_t, uint32_t, u8, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int8_t, int32_t, s8, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint16_t, uint32_t, u16, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int16_t, int32_t, s16, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint32_t, uint32_t, u32, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int32_t, int32_t, s32, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint64_t, uint64_t, u64, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int64_t, int64_t, s64, sop_addx);
-                break;
-              default:
-                return 0;
-            }
-
-            break;
-          case SAFE_IOP_TYPE_U64:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint8_t, uint32_t, u8, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int8_t, int32_t, s8, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint16_t, uint32_t, u16, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int16_t, int32_t, s16, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint32_t, uint32_t, u32, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int32_t, int32_t, s32, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint64_t, uint64_t, u64, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int64_t, int64_t, s64, sop_addx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S64:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint8_t, uint32_t, u8, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int8_t, int32_t, s8, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint16_t, uint32_t, u16, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int16_t, int32_t, s16, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint32_t, uint32_t, u32, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int32_t, int32_t, s32, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint64_t, uint64_t, u64, sop_addx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int64_t, int64_t, s64, sop_addx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          default:
-            return 0;
-        }
-        break;
-      case '-': /* sub */
-        if (!_sopf_read_type(&rhs, &c))
-          return 0;
-        switch (lhs) {
-          case SAFE_IOP_TYPE_U8:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint8_t, uint32_t, u8, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int8_t, int32_t, s8, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint16_t, uint32_t, u16, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int16_t, int32_t, s16, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint32_t, uint32_t, u32, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int32_t, int32_t, s32, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint64_t, uint64_t, u64, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int64_t, int64_t, s64, sop_subx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S8:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint8_t, uint32_t, u8, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int8_t, int32_t, s8, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint16_t, uint32_t, u16, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int16_t, int32_t, s16, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint32_t, uint32_t, u32, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int32_t, int32_t, s32, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint64_t, uint64_t, u64, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int64_t, int64_t, s64, sop_subx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_U16:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint8_t, uint32_t, u8, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int8_t, int32_t, s8, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint16_t, uint32_t, u16, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int16_t, int32_t, s16, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint32_t, uint32_t, u32, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int32_t, int32_t, s32, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint64_t, uint64_t, u64, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int64_t, int64_t, s64, sop_subx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S16:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint8_t, uint32_t, u8, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int8_t, int32_t, s8, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint16_t, uint32_t, u16, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int16_t, int32_t, s16, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint32_t, uint32_t, u32, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int32_t, int32_t, s32, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint64_t, uint64_t, u64, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int64_t, int64_t, s64, sop_subx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_U32:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint8_t, uint32_t, u8, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int8_t, int32_t, s8, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint16_t, uint32_t, u16, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int16_t, int32_t, s16, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint32_t, uint32_t, u32, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int32_t, int32_t, s32, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint64_t, uint64_t, u64, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int64_t, int64_t, s64, sop_subx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S32:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint8_t, uint32_t, u8, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int8_t, int32_t, s8, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint16_t, uint32_t, u16, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int16_t, int32_t, s16, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint32_t, uint32_t, u32, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int32_t, int32_t, s32, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint64_t, uint64_t, u64, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int64_t, int64_t, s64, sop_subx);
-                break;
-              default:
-                return 0;
-            }
-
-            break;
-          case SAFE_IOP_TYPE_U64:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint8_t, uint32_t, u8, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int8_t, int32_t, s8, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint16_t, uint32_t, u16, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int16_t, int32_t, s16, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint32_t, uint32_t, u32, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int32_t, int32_t, s32, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint64_t, uint64_t, u64, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int64_t, int64_t, s64, sop_subx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S64:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint8_t, uint32_t, u8, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int8_t, int32_t, s8, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint16_t, uint32_t, u16, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int16_t, int32_t, s16, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint32_t, uint32_t, u32, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int32_t, int32_t, s32, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint64_t, uint64_t, u64, sop_subx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int64_t, int64_t, s64, sop_subx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          default:
-            return 0;
-        }
-        break;
-      case '*': /* mul */
-        if (!_sopf_read_type(&rhs, &c))
-          return 0;
-        switch (lhs) {
-          case SAFE_IOP_TYPE_U8:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint8_t, uint32_t, u8, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int8_t, int32_t, s8, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint16_t, uint32_t, u16, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int16_t, int32_t, s16, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint32_t, uint32_t, u32, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int32_t, int32_t, s32, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint64_t, uint64_t, u64, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int64_t, int64_t, s64, sop_mulx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S8:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint8_t, uint32_t, u8, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int8_t, int32_t, s8, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint16_t, uint32_t, u16, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int16_t, int32_t, s16, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint32_t, uint32_t, u32, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int32_t, int32_t, s32, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint64_t, uint64_t, u64, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int64_t, int64_t, s64, sop_mulx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_U16:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint8_t, uint32_t, u8, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int8_t, int32_t, s8, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint16_t, uint32_t, u16, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int16_t, int32_t, s16, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint32_t, uint32_t, u32, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int32_t, int32_t, s32, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint64_t, uint64_t, u64, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int64_t, int64_t, s64, sop_mulx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S16:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint8_t, uint32_t, u8, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int8_t, int32_t, s8, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint16_t, uint32_t, u16, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int16_t, int32_t, s16, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint32_t, uint32_t, u32, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int32_t, int32_t, s32, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint64_t, uint64_t, u64, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int64_t, int64_t, s64, sop_mulx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_U32:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint8_t, uint32_t, u8, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int8_t, int32_t, s8, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint16_t, uint32_t, u16, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int16_t, int32_t, s16, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint32_t, uint32_t, u32, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int32_t, int32_t, s32, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint64_t, uint64_t, u64, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int64_t, int64_t, s64, sop_mulx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S32:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint8_t, uint32_t, u8, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int8_t, int32_t, s8, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint16_t, uint32_t, u16, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int16_t, int32_t, s16, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint32_t, uint32_t, u32, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int32_t, int32_t, s32, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint64_t, uint64_t, u64, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int64_t, int64_t, s64, sop_mulx);
-                break;
-              default:
-                return 0;
-            }
-
-            break;
-          case SAFE_IOP_TYPE_U64:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint8_t, uint32_t, u8, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int8_t, int32_t, s8, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint16_t, uint32_t, u16, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int16_t, int32_t, s16, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint32_t, uint32_t, u32, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int32_t, int32_t, s32, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint64_t, uint64_t, u64, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int64_t, int64_t, s64, sop_mulx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S64:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint8_t, uint32_t, u8, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int8_t, int32_t, s8, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint16_t, uint32_t, u16, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int16_t, int32_t, s16, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint32_t, uint32_t, u32, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int32_t, int32_t, s32, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint64_t, uint64_t, u64, sop_mulx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int64_t, int64_t, s64, sop_mulx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          default:
-            return 0;
-        }
-        break;
-      case '/': /* div */
-        if (!_sopf_read_type(&rhs, &c))
-          return 0;
-        switch (lhs) {
-          case SAFE_IOP_TYPE_U8:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint8_t, uint32_t, u8, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int8_t, int32_t, s8, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint16_t, uint32_t, u16, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int16_t, int32_t, s16, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint32_t, uint32_t, u32, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int32_t, int32_t, s32, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint64_t, uint64_t, u64, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int64_t, int64_t, s64, sop_divx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S8:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint8_t, uint32_t, u8, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int8_t, int32_t, s8, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint16_t, uint32_t, u16, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int16_t, int32_t, s16, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint32_t, uint32_t, u32, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int32_t, int32_t, s32, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint64_t, uint64_t, u64, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int64_t, int64_t, s64, sop_divx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_U16:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint8_t, uint32_t, u8, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int8_t, int32_t, s8, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint16_t, uint32_t, u16, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int16_t, int32_t, s16, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint32_t, uint32_t, u32, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int32_t, int32_t, s32, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint64_t, uint64_t, u64, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int64_t, int64_t, s64, sop_divx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S16:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint8_t, uint32_t, u8, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int8_t, int32_t, s8, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint16_t, uint32_t, u16, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int16_t, int32_t, s16, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint32_t, uint32_t, u32, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int32_t, int32_t, s32, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint64_t, uint64_t, u64, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int64_t, int64_t, s64, sop_divx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_U32:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint8_t, uint32_t, u8, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int8_t, int32_t, s8, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint16_t, uint32_t, u16, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int16_t, int32_t, s16, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint32_t, uint32_t, u32, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int32_t, int32_t, s32, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint64_t, uint64_t, u64, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int64_t, int64_t, s64, sop_divx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S32:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint8_t, uint32_t, u8, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int8_t, int32_t, s8, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint16_t, uint32_t, u16, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int16_t, int32_t, s16, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint32_t, uint32_t, u32, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int32_t, int32_t, s32, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint64_t, uint64_t, u64, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int64_t, int64_t, s64, sop_divx);
-                break;
-              default:
-                return 0;
-            }
-
-            break;
-          case SAFE_IOP_TYPE_U64:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint8_t, uint32_t, u8, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int8_t, int32_t, s8, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint16_t, uint32_t, u16, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int16_t, int32_t, s16, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint32_t, uint32_t, u32, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int32_t, int32_t, s32, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint64_t, uint64_t, u64, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int64_t, int64_t, s64, sop_divx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S64:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint8_t, uint32_t, u8, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int8_t, int32_t, s8, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint16_t, uint32_t, u16, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int16_t, int32_t, s16, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint32_t, uint32_t, u32, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int32_t, int32_t, s32, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint64_t, uint64_t, u64, sop_divx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int64_t, int64_t, s64, sop_divx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          default:
-            return 0;
-        }
-        break;
-      case '%': /* mod */
-        if (!_sopf_read_type(&rhs, &c))
-          return 0;
-        switch (lhs) {
-          case SAFE_IOP_TYPE_U8:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint8_t, uint32_t, u8, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int8_t, int32_t, s8, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint16_t, uint32_t, u16, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int16_t, int32_t, s16, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint32_t, uint32_t, u32, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int32_t, int32_t, s32, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint64_t, uint64_t, u64, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int64_t, int64_t, s64, sop_modx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S8:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint8_t, uint32_t, u8, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int8_t, int32_t, s8, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint16_t, uint32_t, u16, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int16_t, int32_t, s16, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint32_t, uint32_t, u32, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int32_t, int32_t, s32, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint64_t, uint64_t, u64, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int64_t, int64_t, s64, sop_modx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_U16:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint8_t, uint32_t, u8, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int8_t, int32_t, s8, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint16_t, uint32_t, u16, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int16_t, int32_t, s16, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint32_t, uint32_t, u32, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int32_t, int32_t, s32, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint64_t, uint64_t, u64, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int64_t, int64_t, s64, sop_modx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S16:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint8_t, uint32_t, u8, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int8_t, int32_t, s8, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint16_t, uint32_t, u16, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int16_t, int32_t, s16, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint32_t, uint32_t, u32, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int32_t, int32_t, s32, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint64_t, uint64_t, u64, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int64_t, int64_t, s64, sop_modx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_U32:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint8_t, uint32_t, u8, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int8_t, int32_t, s8, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint16_t, uint32_t, u16, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int16_t, int32_t, s16, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint32_t, uint32_t, u32, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int32_t, int32_t, s32, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint64_t, uint64_t, u64, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int64_t, int64_t, s64, sop_modx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S32:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint8_t, uint32_t, u8, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int8_t, int32_t, s8, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint16_t, uint32_t, u16, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int16_t, int32_t, s16, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint32_t, uint32_t, u32, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int32_t, int32_t, s32, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint64_t, uint64_t, u64, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int64_t, int64_t, s64, sop_modx);
-                break;
-              default:
-                return 0;
-            }
-
-            break;
-          case SAFE_IOP_TYPE_U64:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint8_t, uint32_t, u8, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int8_t, int32_t, s8, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint16_t, uint32_t, u16, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int16_t, int32_t, s16, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint32_t, uint32_t, u32, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int32_t, int32_t, s32, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint64_t, uint64_t, u64, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int64_t, int64_t, s64, sop_modx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S64:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint8_t, uint32_t, u8, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int8_t, int32_t, s8, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint16_t, uint32_t, u16, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int16_t, int32_t, s16, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint32_t, uint32_t, u32, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int32_t, int32_t, s32, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint64_t, uint64_t, u64, sop_modx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int64_t, int64_t, s64, sop_modx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          default:
-            return 0;
-        }
+#define _SOPF_LOAD_KERNS(_dm, _dt, _ds) \
+  _SOPF_LOAD_KERN(_dm, _dt, _ds, u8, uint8_t, 0) \
+  _SOPF_LOAD_KERN(_dm, _dt, _ds, s8, int8_t, 1) \
+  _SOPF_LOAD_KERN(_dm, _dt, _ds, u16, uint16_t, 0) \
+  _SOPF_LOAD_KERN(_dm, _dt, _ds, s16, int16_t, 1) \
+  _SOPF_LOAD_KERN(_dm, _dt, _ds, u32, uint32_t, 0) \
+  _SOPF_LOAD_KERN(_dm, _dt, _ds, s32, int32_t, 1) \
+  _SOPF_LOAD_KERN(_dm, _dt, _ds, u64, uint64_t, 0) \
+  _SOPF_LOAD_KERN(_dm, _dt, _ds, s64, int64_t, 1)
+
+/* Performs dst op= src over a block in the lhs type.  Rows which already
+ * failed keep going; their values are never stored. */
+#define _SOPF_OP_KERN(_op, _m) \
+  static void _sopf_##_op##_##_m(void *dst, const void *src, \
+                                 unsigned char *fail, size_t n) { \
+    sop_typeof_sop_##_m(x) *x = (sop_typeof_sop_##_m(x) *) dst; \
+    const sop_typeof_sop_##_m(x) *y = (const sop_typeof_sop_##_m(x) *) src; \
+    size_t i; \
+    for (i = 0; i < n; ++i) \
+      fail[i] |= !_SOPF_OP(_op, _m, &x[i], x[i], y[i]); \
+  }
+
+#define _SOPF_WIDE_KERN(_op) \
+  static void _sopf_##_op##_wide(void *dst, const void *src, \
+                                 unsigned char *fail, size_t n) { \
+    sopf_wide_t *x = (sopf_wide_t *) dst; \
+    const sopf_wide_t *y = (const sopf_wide_t *) src; \
+    size_t i; \
+    for (i = 0; i < n; ++i) \
+      fail[i] |= !_SOPF_WIDE_OP(_op, &x[i], x[i], y[i]); \
+  }
+
+/* Writes back every row which did not fail.  In wide mode this is also
+ * where the single range check against the lhs type happens. */
+#define _SOPF_STORE_KERN(_m) \
+  static void _sopf_store_##_m(void *dst, const void *src, \
+                               unsigned char *fail, size_t n) { \
+    sop_typeof_sop_##_m(x) *d = (sop_typeof_sop_##_m(x) *) dst; \
+    const sop_typeof_sop_##_m(x) *s = (const sop_typeof_sop_##_m(x) *) src; \
+    size_t i; \
+    for (i = 0; i < n; ++i) \
+      if (!fail[i]) \
+        d[i] = s[i]; \
+  } \
+  static void _sopf_narrow_##_m(void *dst, const void *src, \
+                                unsigned char *fail, size_t n) { \
+    sop_typeof_sop_##_m(x) *d = (sop_typeof_sop_##_m(x) *) dst; \
+    const sopf_wide_t *s = (const sopf_wide_t *) src; \
+    size_t i; \
+    for (i = 0; i < n; ++i) { \
+      if (fail[i]) \
+        continue; \
+      if (sop_safe_cast(sop_signed_sop_##_m(x), sop_typeof_sop_##_m(x), 0, \
+                        1, sopf_wide_t, s[i])) \
+        d[i] = (sop_typeof_sop_##_m(x)) s[i]; \
+      else \
+        fail[i] = 1; \
+    } \
+  }
+
+#define _SOPF_KERNS(_m, _t, _s) \
+  _SOPF_LOAD_KERNS(_m, _t, _s) \
+  _SOPF_OP_KERN(add, _m) \
+  _SOPF_OP_KERN(sub, _m) \
+  _SOPF_OP_KERN(mul, _m) \
+  _SOPF_OP_KERN(div, _m) \
+  _SOPF_OP_KERN(mod, _m) \
+  _SOPF_OP_KERN(shl, _m) \
+  _SOPF_OP_KERN(shr, _m) \
+  _SOPF_STORE_KERN(_m)
+
+_SOPF_KERNS(u8, uint8_t, 0)
+_SOPF_KERNS(s8, int8_t, 1)
+_SOPF_KERNS(u16, uint16_t, 0)
+_SOPF_KERNS(s16, int16_t, 1)
+_SOPF_KERNS(u32, uint32_t, 0)
+_SOPF_KERNS(s32, int32_t, 1)
+_SOPF_KERNS(u64, uint64_t, 0)
+_SOPF_KERNS(s64, int64_t, 1)
+_SOPF_LOAD_KERNS(wide, sopf_wide_t, 1)
+_SOPF_WIDE_KERN(add)
+_SOPF_WIDE_KERN(sub)
+_SOPF_WIDE_KERN(mul)
+_SOPF_WIDE_KERN(div)
+_SOPF_WIDE_KERN(mod)
+_SOPF_WIDE_KERN(shl)
+_SOPF_WIDE_KERN(shr)
+
+/* Kernel tables are indexed by sop_type_t.  As the types start at 1, row 0
+ * holds the sopf_wide_t kernels. */
+#define _SOPF_LOAD_ROW(_dm) \
+  { NULL, _sopf_load_u8_##_dm, _sopf_load_s8_##_dm, _sopf_load_u16_##_dm, \
+    _sopf_load_s16_##_dm, _sopf_load_u32_##_dm, _sopf_load_s32_##_dm, \
+    _sopf_load_u64_##_dm, _sopf_load_s64_##_dm }
+
+static const sopf_kern_t _sopf_load_kerns[SAFE_IOP_TYPE_S64+1]
+                                          [SAFE_IOP_TYPE_S64+1] = {
+  _SOPF_LOAD_ROW(wide),
+  _SOPF_LOAD_ROW(u8), _SOPF_LOAD_ROW(s8),
+  _SOPF_LOAD_ROW(u16), _SOPF_LOAD_ROW(s16),
+  _SOPF_LOAD_ROW(u32), _SOPF_LOAD_ROW(s32),
+  _SOPF_LOAD_ROW(u64), _SOPF_LOAD_ROW(s64),
+};
+
+/* Indexed by sopf_op_t - SOPF_OP_ADD */
+#define _SOPF_OP_ROW(_m) \
+  { _sopf_add_##_m, _sopf_sub_##_m, _sopf_mul_##_m, _sopf_div_##_m, \
+    _sopf_mod_##_m, _sopf_shl_##_m, _sopf_shr_##_m }
+
+static const sopf_kern_t _sopf_op_kerns[SAFE_IOP_TYPE_S64+1]
+                                        [SOPF_OP_SHR-SOPF_OP_ADD+1] = {
+  _SOPF_OP_ROW(wide),
+  _SOPF_OP_ROW(u8), _SOPF_OP_ROW(s8),
+  _SOPF_OP_ROW(u16), _SOPF_OP_ROW(s16),
+  _SOPF_OP_ROW(u32), _SOPF_OP_ROW(s32),
+  _SOPF_OP_ROW(u64), _SOPF_OP_ROW(s64),
+};
+
+static const sopf_kern_t _sopf_store_kerns[SAFE_IOP_TYPE_S64+1] = {
+  NULL, _sopf_store_u8, _sopf_store_s8, _sopf_store_u16, _sopf_store_s16,
+  _sopf_store_u32, _sopf_store_s32, _sopf_store_u64, _sopf_store_s64,
+};
+
+static const sopf_kern_t _sopf_narrow_kerns[SAFE_IOP_TYPE_S64+1] = {
+  NULL, _sopf_narrow_u8, _sopf_narrow_s8, _sopf_narrow_u16, _sopf_narrow_s16,
+  _sopf_narrow_u32, _sopf_narrow_s32, _sopf_narrow_u64, _sopf_narrow_s64,
+};
+
+static const size_t _sopf_type_size[SAFE_IOP_TYPE_S64+1] = {
+  sizeof(sopf_wide_t), sizeof(uint8_t), sizeof(int8_t), sizeof(uint16_t),
+  sizeof(int16_t), sizeof(uint32_t), sizeof(int32_t), sizeof(uint64_t),
+  sizeof(int64_t),
+};
+
+/* Scratch for one call, allocated once: the kernel tables and a stack of
+ * one block of rows per level the program reaches, each row as wide as
+ * the type the program runs in. */
+typedef struct {
+  sopf_kern_t kerns[SOPF_MAX_INSNS];
+  const unsigned char *cols[SOPF_MAX_INSNS];
+  size_t sizes[SOPF_MAX_INSNS];
+  unsigned char fail[SOPF_BATCH_ROWS];
+  sopf_wide_t stack[];
+} _sopf_batch_t;
+
+/* See header file for details. */
+ssize_t sopf_batch(const sopf_prog_t *prog, size_t n, void *out,
+                   uint8_t *fail_mask, ...) {
+  _sopf_batch_t *b;
+  sopf_kern_t *kerns;
+  sopf_kern_t store;
+  const unsigned char **cols;
+  unsigned char *stack, *fail;
+  size_t *sizes;
+  size_t lhs_size, block, start, rows, r;
+  ssize_t failed = 0;
+  unsigned int i, sp = 0, depth = 0, arg = 0, kt;
+  va_list ap;
+
+  if (prog == NULL || out == NULL || prog->ninsns > SOPF_MAX_INSNS ||
+      prog->lhs < SAFE_IOP_TYPE_U8 || prog->lhs > SAFE_IOP_TYPE_S64)
+    return -1;
+  kt = (prog->flags & SOPF_FLAG_WIDE) ? 0 : (unsigned int) prog->lhs;
+  for (i = 0; i < prog->ninsns; ++i) {
+    if (prog->insns[i].op == SOPF_OP_ARG) {
+      if (++sp > depth)
+        depth = sp;
+    } else if (sp > 0) {
+      sp--;
+    }
+  }
+  block = SOPF_BATCH_ROWS * _sopf_type_size[kt];
+  b = (_sopf_batch_t *) malloc(sizeof(*b) + depth * block);
+  if (b == NULL)
+    return -1;
+  kerns = b->kerns;
+  cols = b->cols;
+  sizes = b->sizes;
+  fail = b->fail;
+  stack = (unsigned char *) b->stack;
+
+  /* Resolve every kernel, and validate the program, up front. */
+  sp = 0;
+  va_start(ap, fail_mask);
+  for (i = 0; i < prog->ninsns; ++i) {
+    const sopf_insn_t *insn = &prog->insns[i];
+    if (insn->op == SOPF_OP_ARG) {
+      if (insn->type < SAFE_IOP_TYPE_U8 || insn->type > SAFE_IOP_TYPE_S64 ||
+          sp == SOPF_MAX_DEPTH)
         break;
-      case '<': /* shl */
-        if (*c && *c == '<') {
-          c++;
-          if (!_sopf_read_type(&rhs, &c))
-            return 0;
-        switch (lhs) {
-          case SAFE_IOP_TYPE_U8:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint8_t, uint32_t, u8, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int8_t, int32_t, s8, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint16_t, uint32_t, u16, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int16_t, int32_t, s16, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint32_t, uint32_t, u32, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int32_t, int32_t, s32, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint64_t, uint64_t, u64, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int64_t, int64_t, s64, sop_shlx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S8:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint8_t, uint32_t, u8, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int8_t, int32_t, s8, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint16_t, uint32_t, u16, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int16_t, int32_t, s16, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint32_t, uint32_t, u32, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int32_t, int32_t, s32, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint64_t, uint64_t, u64, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int64_t, int64_t, s64, sop_shlx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_U16:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint8_t, uint32_t, u8, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int8_t, int32_t, s8, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint16_t, uint32_t, u16, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int16_t, int32_t, s16, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint32_t, uint32_t, u32, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int32_t, int32_t, s32, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint64_t, uint64_t, u64, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int64_t, int64_t, s64, sop_shlx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S16:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint8_t, uint32_t, u8, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int8_t, int32_t, s8, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint16_t, uint32_t, u16, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int16_t, int32_t, s16, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint32_t, uint32_t, u32, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int32_t, int32_t, s32, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint64_t, uint64_t, u64, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int64_t, int64_t, s64, sop_shlx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_U32:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint8_t, uint32_t, u8, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int8_t, int32_t, s8, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint16_t, uint32_t, u16, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int16_t, int32_t, s16, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint32_t, uint32_t, u32, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int32_t, int32_t, s32, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint64_t, uint64_t, u64, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int64_t, int64_t, s64, sop_shlx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S32:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint8_t, uint32_t, u8, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int8_t, int32_t, s8, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint16_t, uint32_t, u16, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int16_t, int32_t, s16, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint32_t, uint32_t, u32, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int32_t, int32_t, s32, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint64_t, uint64_t, u64, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int64_t, int64_t, s64, sop_shlx);
-                break;
-              default:
-                return 0;
-            }
-
-            break;
-          case SAFE_IOP_TYPE_U64:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint8_t, uint32_t, u8, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int8_t, int32_t, s8, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint16_t, uint32_t, u16, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int16_t, int32_t, s16, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint32_t, uint32_t, u32, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int32_t, int32_t, s32, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint64_t, uint64_t, u64, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int64_t, int64_t, s64, sop_shlx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S64:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint8_t, uint32_t, u8, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int8_t, int32_t, s8, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint16_t, uint32_t, u16, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int16_t, int32_t, s16, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint32_t, uint32_t, u32, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int32_t, int32_t, s32, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint64_t, uint64_t, u64, sop_shlx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int64_t, int64_t, s64, sop_shlx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          default:
-            return 0;
-          }
-        } else {
-          /* unknown op */
-          return 0;
-        }
+      kerns[i] = _sopf_load_kerns[kt][insn->type];
+      sizes[i] = _sopf_type_size[insn->type];
+      cols[i] = (const unsigned char *) va_arg(ap, const void *);
+      if (cols[i] == NULL)
         break;
-      case '>': /* shr */
-        if (*c && *c == '>') {
-          c++;
-          if (!_sopf_read_type(&rhs, &c))
-            return 0;
-        switch (lhs) {
-          case SAFE_IOP_TYPE_U8:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint8_t, uint32_t, u8, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int8_t, int32_t, s8, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint16_t, uint32_t, u16, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int16_t, int32_t, s16, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint32_t, uint32_t, u32, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int32_t, int32_t, s32, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    uint64_t, uint64_t, u64, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint8_t, uint32_t, u8,
-                                    int64_t, int64_t, s64, sop_shrx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S8:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint8_t, uint32_t, u8, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int8_t, int32_t, s8, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint16_t, uint32_t, u16, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int16_t, int32_t, s16, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint32_t, uint32_t, u32, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int32_t, int32_t, s32, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    uint64_t, uint64_t, u64, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int8_t, int32_t, s8,
-                                    int64_t, int64_t, s64, sop_shrx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_U16:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint8_t, uint32_t, u8, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int8_t, int32_t, s8, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint16_t, uint32_t, u16, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int16_t, int32_t, s16, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint32_t, uint32_t, u32, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int32_t, int32_t, s32, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    uint64_t, uint64_t, u64, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint16_t, uint32_t, u16,
-                                    int64_t, int64_t, s64, sop_shrx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S16:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint8_t, uint32_t, u8, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int8_t, int32_t, s8, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint16_t, uint32_t, u16, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int16_t, int32_t, s16, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint32_t, uint32_t, u32, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int32_t, int32_t, s32, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    uint64_t, uint64_t, u64, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int16_t, int32_t, s16,
-                                    int64_t, int64_t, s64, sop_shrx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_U32:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint8_t, uint32_t, u8, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int8_t, int32_t, s8, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint16_t, uint32_t, u16, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int16_t, int32_t, s16, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint32_t, uint32_t, u32, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int32_t, int32_t, s32, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    uint64_t, uint64_t, u64, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint32_t, uint32_t, u32,
-                                    int64_t, int64_t, s64, sop_shrx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S32:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint8_t, uint32_t, u8, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int8_t, int32_t, s8, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint16_t, uint32_t, u16, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int16_t, int32_t, s16, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint32_t, uint32_t, u32, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int32_t, int32_t, s32, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    uint64_t, uint64_t, u64, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int32_t, int32_t, s32,
-                                    int64_t, int64_t, s64, sop_shrx);
-                break;
-              default:
-                return 0;
-            }
-
-            break;
-          case SAFE_IOP_TYPE_U64:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint8_t, uint32_t, u8, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int8_t, int32_t, s8, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint16_t, uint32_t, u16, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int16_t, int32_t, s16, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint32_t, uint32_t, u32, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int32_t, int32_t, s32, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    uint64_t, uint64_t, u64, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(uint64_t, uint64_t, u64,
-                                    int64_t, int64_t, s64, sop_shrx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          case SAFE_IOP_TYPE_S64:
-            switch (rhs) {
-              case SAFE_IOP_TYPE_U8:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint8_t, uint32_t, u8, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S8:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int8_t, int32_t, s8, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U16:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint16_t, uint32_t, u16, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S16:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int16_t, int32_t, s16, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U32:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint32_t, uint32_t, u32, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S32:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int32_t, int32_t, s32, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_U64:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    uint64_t, uint64_t, u64, sop_shrx);
-                break;
-              case SAFE_IOP_TYPE_S64:
-                _SAFE_IOP_TYPE_CASE(int64_t, int64_t, s64,
-                                    int64_t, int64_t, s64, sop_shrx);
-                break;
-              default:
-                return 0;
-            }
-            break;
-          default:
-            return 0;
-        }
-        } else {
-          /* unknown op */
-          return 0;
-        }
+      sp++;
+      arg++;
+    } else {
+      if (insn->op < SOPF_OP_ADD || insn->op > SOPF_OP_SHR || sp < 2)
         break;
-      default:
-       /* unknown op */
-       return 0;
+      kerns[i] = _sopf_op_kerns[kt][insn->op - SOPF_OP_ADD];
+      sp--;
     }
-    /* Once the lhs type is given, this becomes the default for
-     * all remaining operands
-     */
-   rhs = lhs;
   }
-  /* Success! Assign the holder value back to result using the stored lhs */
-  if (result) {
-    switch (lhs) {
-      case SAFE_IOP_TYPE_U8: {
-        uint8_t *r = result, *h = (uint8_t *) holder;
-        *r = *h;
-        } break;
-      case SAFE_IOP_TYPE_S8: {
-        int8_t *r = result, *h = (int8_t *)holder;
-        *r = *h;
-        } break;
-      case SAFE_IOP_TYPE_U16: {
-        uint16_t *r = result, *h = (uint16_t *) holder;
-        *r = *h;
-        } break;
-      case SAFE_IOP_TYPE_S16: {
-        int16_t *r = result, *h = (int16_t *) holder;
-        *r = *h;
-        } break;
-      case SAFE_IOP_TYPE_U32: {
-        uint32_t *r = result, *h = (uint32_t *) holder;
-        *r = *h;
-        } break;
-      case SAFE_IOP_TYPE_S32: {
-        int32_t *r = result, *h = (int32_t *) holder;
-        *r = *h;
-        } break;
-      case SAFE_IOP_TYPE_U64: {
-        uint64_t *r = result, *h = (uint64_t *) holder;
-        *r = *h;
-        } break;
-      case SAFE_IOP_TYPE_S64: {
-        int64_t *r = result, *h = (int64_t *) holder;
-        *r = *h;
-        } break;
-      default:
-        /* bad sign. maybe this should abort. */
-        return 0;
+  va_end(ap);
+  if (i != prog->ninsns || sp != 1 || arg != prog->nargs) {
+    free(b);
+    return -1;
+  }
+  store = kt ? _sopf_store_kerns[kt] : _sopf_narrow_kerns[prog->lhs];
+  lhs_size = _sopf_type_size[prog->lhs];
+
+  for (start = 0; start < n; start += rows) {
+    rows = n - start;
+    if (rows > SOPF_BATCH_ROWS)
+      rows = SOPF_BATCH_ROWS;
+    memset(fail, 0, rows);
+    sp = 0;
+    for (i = 0; i < prog->ninsns; ++i) {
+      if (prog->insns[i].op == SOPF_OP_ARG) {
+        kerns[i](stack + sp++ * block, cols[i] + start * sizes[i], fail,
+                 rows);
+      } else {
+        sp--;
+        kerns[i](stack + (sp - 1) * block, stack + sp * block, fail, rows);
+      }
+    }
+    store((unsigned char *) out + start * lhs_size, stack, fail, rows);
+    for (r = 0; r < rows; ++r) {
+      size_t row = start + r;
+      failed += fail[r];
+      if (fail_mask == NULL)
+        continue;
+      if (fail[r])
+        fail_mask[row / CHAR_BIT] |= (uint8_t) (1 << (row % CHAR_BIT));
+      else
+        fail_mask[row / CHAR_BIT] &= (uint8_t) ~(1 << (row % CHAR_BIT));
     }
   }
+  free(b);
+  return failed;
+}
+
+/* Sliding windows
+ * Every sum a window can hold, and every sum along the way in push and
+ * pop, is a sum of at most capacity values in [min, max], and so lies
+ * between capacity * min and capacity * max (or 0).  If both fit the type,
+ * init marks the window proven and push and pop skip all checks but the
+ * bounds check on the value pushed.  Otherwise each step is checked.  A
+ * signed push into a full window may need the add before the sub: with
+ * MAX, MAX and -MAX in the window, dropping -MAX first overflows even
+ * though pushing 0 in its place gives MAX.  If the result fits, at most
+ * one of the two orders can overflow, so both are tried.
+ */
+#define _SOP_WINDOW(_m, _type, _s, _sign, _tmax) \
+  int sop_window_init_##_m(sop_window_##_m##_t *w, _type *buf, \
+                           size_t capacity, _type min, _type max) { \
+    _type lo, hi; \
+    if (w == NULL || buf == NULL || capacity == 0 || min > max) \
+      return 0; \
+    w->sum = 0; \
+    w->count = 0; \
+    w->buf = buf; \
+    w->capacity = capacity; \
+    w->head = 0; \
+    w->min = min; \
+    w->max = max; \
+    w->proven = (uintmax_t) capacity <= (uintmax_t) (_tmax) && \
+      sop_##_s##mul(_sign, _type, &lo, _sign, _type, (_type) capacity, \
+                    _sign, _type, min) && \
+      sop_##_s##mul(_sign, _type, &hi, _sign, _type, (_type) capacity, \
+                    _sign, _type, max); \
+    return 1; \
+  } \
+  int sop_window_push_##_m(sop_window_##_m##_t *w, _type value) { \
+    _type sum, old; \
+    size_t tail; \
+    if (value < w->min || value > w->max) \
+      return 0; \
+    if (w->count == w->capacity) { \
+      old = w->buf[w->head]; \
+      if (w->proven) \
+        sum = w->sum - old + value; \
+      else if (!(sop_##_s##sub(_sign, _type, &sum, _sign, _type, w->sum, \
+                               _sign, _type, old) && \
+                 sop_##_s##add(_sign, _type, &sum, _sign, _type, sum, \
+                               _sign, _type, value)) && \
+               !(sop_##_s##add(_sign, _type, &sum, _sign, _type, w->sum, \
+                               _sign, _type, value) && \
+                 sop_##_s##sub(_sign, _type, &sum, _sign, _type, sum, \
+                               _sign, _type, old))) \
+        return 0; \
+      w->buf[w->head] = value; \
+      w->head = (w->head + 1 == w->capacity) ? 0 : w->head + 1; \
+    } else { \
+      if (w->proven) \
+        sum = w->sum + value; \
+      else if (!sop_##_s##add(_sign, _type, &sum, _sign, _type, w->sum, \
+                              _sign, _type, value)) \
+        return 0; \
+      tail = w->head + w->count; \
+      if (tail >= w->capacity) \
+        tail -= w->capacity; \
+      w->buf[tail] = value; \
+      w->count++; \
+    } \
+    w->sum = sum; \
+    return 1; \
+  } \
+  int sop_window_pop_##_m(sop_window_##_m##_t *w, _type *value) { \
+    _type sum, old; \
+    if (w->count == 0) \
+      return 0; \
+    old = w->buf[w->head]; \
+    if (w->proven) \
+      sum = w->sum - old; \
+    else if (!sop_##_s##sub(_sign, _type, &sum, _sign, _type, w->sum, \
+                            _sign, _type, old)) \
+      return 0; \
+    w->sum = sum; \
+    w->head = (w->head + 1 == w->capacity) ? 0 : w->head + 1; \
+    w->count--; \
+    if (value) \
+      *value = old; \
+    return 1; \
+  }
+
+_SOP_WINDOW(u32, uint32_t, u, 0, UINT32_MAX)
+_SOP_WINDOW(s32, int32_t, s, 1, INT32_MAX)
+_SOP_WINDOW(u64, uint64_t, u, 0, UINT64_MAX)
+_SOP_WINDOW(s64, int64_t, s, 1, INT64_MAX)
+
+/* Full-width products
+ * Without __int128 the 64-bit product is summed from the partial products
+ * of the 32-bit halves; mid collects the carries into the high half.
+ */
+
+/* See header file for details. */
+void sop_mul_full_u32(uint32_t *hi, uint32_t *lo, uint32_t a, uint32_t b) {
+  const uint64_t p = (uint64_t) a * b;
+  if (hi)
+    *hi = (uint32_t) (p >> 32);
+  if (lo)
+    *lo = (uint32_t) p;
+}
+
+/* See header file for details. */
+void sop_mul_full_u64(uint64_t *hi, uint64_t *lo, uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+  const unsigned __int128 p = (unsigned __int128) a * b;
+  if (hi)
+    *hi = (uint64_t) (p >> 64);
+#else
+  const uint64_t al = a & UINT32_MAX, ah = a >> 32;
+  const uint64_t bl = b & UINT32_MAX, bh = b >> 32;
+  const uint64_t mid = (al * bl >> 32) + (ah * bl & UINT32_MAX) +
+                       (al * bh & UINT32_MAX);
+  if (hi)
+    *hi = ah * bh + (ah * bl >> 32) + (al * bh >> 32) + (mid >> 32);
+#endif
+  if (lo)
+    *lo = a * b;
+}
+
+/* Rescaling
+ * _sop_rescale_mag divides the exact product of two magnitudes, rounding
+ * the quotient's magnitude as the signed callers ask: 0 truncates, 1 rounds
+ * up and 2 rounds halves up.  Without __int128 the product comes from
+ * sop_mul_full_u64 and is divided a bit at a time.  In both cases a high
+ * half of the product at least c means the quotient needs more than 64
+ * bits.
+ */
+static int _sop_rescale_mag(uint64_t *q, uint64_t a, uint64_t b, uint64_t c,
+                            int mode) {
+  uint64_t quot, rem;
+#if defined(__SIZEOF_INT128__)
+  const unsigned __int128 p = (unsigned __int128) a * b;
+  if ((uint64_t) (p >> 64) >= c)
+    return 0;
+  quot = (uint64_t) (p / c);
+  rem = (uint64_t) (p % c);
+#else
+  uint64_t hi, lo, top;
+  int i;
+  sop_mul_full_u64(&hi, &lo, a, b);
+  if (hi >= c)
+    return 0;
+  /* restoring division of hi:lo by c, with hi < c throughout */
+  for (i = 0; i < 64; ++i) {
+    top = hi >> 63;
+    hi = (hi << 1) | (lo >> 63);
+    lo <<= 1;
+    if (top || hi >= c) {
+      hi -= c;
+      lo |= 1;
+    }
+  }
+  quot = lo;
+  rem = hi;
+#endif
+  if (rem && (mode == 1 || (mode == 2 && rem >= c - rem))) {
+    if (quot == UINT64_MAX)
+      return 0;
+    ++quot;
+  }
+  *q = quot;
+  return 1;
+}
+
+/* See header file for details. */
+int sop_rescale_u64(uint64_t *out, uint64_t a, uint64_t b, uint64_t c,
+                    sop_round_t rounding) {
+  uint64_t q;
+  int mode;
+  switch (rounding) {
+    case SOP_ROUND_ZERO:
+    case SOP_ROUND_DOWN:
+      mode = 0;
+      break;
+    case SOP_ROUND_UP:
+      mode = 1;
+      break;
+    case SOP_ROUND_NEAREST:
+      mode = 2;
+      break;
+    default:
+      return 0;
+  }
+  if (c == 0 || !_sop_rescale_mag(&q, a, b, c, mode))
+    return 0;
+  if (out)
+    *out = q;
+  return 1;
+}
+
+/* The magnitudes are taken in uint64_t so that INT64_MIN needs no special
+ * case.  Rounding down a negative quotient rounds its magnitude up. */
+int sop_rescale_s64(int64_t *out, int64_t a, int64_t b, int64_t c,
+                    sop_round_t rounding) {
+  const int neg = (a < 0) ^ (b < 0) ^ (c < 0);
+  const uint64_t ma = (a < 0) ? 0 - (uint64_t) a : (uint64_t) a;
+  const uint64_t mb = (b < 0) ? 0 - (uint64_t) b : (uint64_t) b;
+  const uint64_t mc = (c < 0) ? 0 - (uint64_t) c : (uint64_t) c;
+  uint64_t q;
+  int mode;
+  switch (rounding) {
+    case SOP_ROUND_ZERO:
+      mode = 0;
+      break;
+    case SOP_ROUND_DOWN:
+      mode = neg;
+      break;
+    case SOP_ROUND_UP:
+      mode = !neg;
+      break;
+    case SOP_ROUND_NEAREST:
+      mode = 2;
+      break;
+    default:
+      return 0;
+  }
+  if (c == 0 || !_sop_rescale_mag(&q, ma, mb, mc, mode))
+    return 0;
+  if (q > (uint64_t) INT64_MAX + neg)
+    return 0;
+  if (out)
+    *out = neg ? (int64_t) (0 - q) : (int64_t) q;
   return 1;
 }
@@ -0,0 +1,1804 @@
+/* safe_iop_array
+ * Author:: Will Drewry <redpig@dataspill.org>
+ * See safe_iop.h for more info.
+ *
+ * Copyright (c) 2007,2008 Will Drewry <redpig@dataspill.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+#include <safe_iop.h>
+
+/* GCC-compatible compilers get the vector extensions and, where the target
+ * has them, x86 intrinsics.  Defining SAFE_IOP_NO_VECTOR, or building with
+ * any other compiler, leaves only portable C: add and sub then work on
+ * lanes packed into 64-bit words and the other kernels run their scalar
+ * loops.
+ */
+#if defined(__GNUC__) && !defined(SAFE_IOP_NO_VECTOR)
+#define SOP_VECTOR 1
+#if defined(__SSE2__)
+#define SOP_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(__SSE4_1__)
+#define SOP_SSE4_1 1
+#include <smmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define SOP_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* The shared library builds this file once per instruction set with
+ * SOP_ARRAY_VARIANT set to its name, so that every public kernel becomes
+ * e.g. sop_add_array_u8_avx2.  src/safe_iop_dispatch.c then binds the
+ * public names to the best variant the CPU supports when the library is
+ * loaded.  Without SOP_ARRAY_VARIANT the kernels keep their public names.
+ */
+#if defined(SOP_ARRAY_VARIANT)
+#define _SOP_FN(_name) _SOP_FN_PASTE(_name, SOP_ARRAY_VARIANT)
+#define _SOP_FN_PASTE(_name, _v) _SOP_FN_PASTE2(_name, _v)
+#define _SOP_FN_PASTE2(_name, _v) _name##_##_v
+#else
+#define _SOP_FN(_name) _name
+#endif
+
+/* Array kernels
+ * Each kernel works on SOP_VEC_BYTES worth of elements at a time using GCC
+ * vector extensions, which become SSE2 or AVX2 code depending on the
+ * target.  Overflow is detected for every lane at once and a vector is
+ * only stored if none of its lanes overflowed.  If one did, the lanes of
+ * that vector are redone with the scalar same-type macros to find the exact
+ * first failure.  The results are therefore identical to calling sop_uadd or
+ * sop_sadd on each element in turn and stopping at the first failure.
+ */
+#if defined(SOP_VECTOR)
+#define SOP_VEC_BYTES 32
+
+#define _SOP_VEC_TYPES(_m, _type, _utype) \
+  typedef _type sop_v_##_m##_t __attribute__((vector_size(SOP_VEC_BYTES))); \
+  typedef _utype sop_v_##_m##_u_t \
+    __attribute__((vector_size(SOP_VEC_BYTES)));
+
+_SOP_VEC_TYPES(u8, uint8_t, uint8_t)
+_SOP_VEC_TYPES(s8, int8_t, uint8_t)
+_SOP_VEC_TYPES(u16, uint16_t, uint16_t)
+_SOP_VEC_TYPES(s16, int16_t, uint16_t)
+_SOP_VEC_TYPES(u32, uint32_t, uint32_t)
+_SOP_VEC_TYPES(s32, int32_t, uint32_t)
+_SOP_VEC_TYPES(u64, uint64_t, uint64_t)
+_SOP_VEC_TYPES(s64, int64_t, uint64_t)
+
+typedef uint64_t sop_v_mask_t __attribute__((vector_size(SOP_VEC_BYTES)));
+
+/* _SOP_V_ANY
+ * Non-zero if any lane of a comparison result is set.  A macro rather than a
+ * function so no vector is ever passed by value.
+ */
+#define _SOP_V_ANY(_m) ((((_m)[0] | (_m)[1]) | ((_m)[2] | (_m)[3])) != 0)
+#endif
+
+/* Lane-wise overflow tests.  The arithmetic is done in the unsigned lane
+ * type so that signed wrap-around is well defined; r is the wrapped result.
+ * Each test only uses bitwise operations and leaves the top bit of a lane
+ * set if that lane overflowed.  SSE2 has neither unsigned nor 64-bit lane
+ * comparisons, so this keeps every type in vector registers.  The same
+ * tests work on lanes packed into a uint64_t.
+ *  unsigned add: carry out of the top bit
+ *  unsigned sub: borrow out of the top bit
+ *  signed add:   a and b have the same sign and r does not
+ *  signed sub:   a and b differ in sign and r differs from a
+ */
+#define _SOP_V_OV_uadd(_a, _b, _r) (((_a) & (_b)) | (((_a) | (_b)) & ~(_r)))
+#define _SOP_V_OV_usub(_a, _b, _r) ((~(_a) & (_b)) | (~((_a) ^ (_b)) & (_r)))
+#define _SOP_V_OV_sadd(_a, _b, _r) (((_a) ^ (_r)) & ((_b) ^ (_r)))
+#define _SOP_V_OV_ssub(_a, _b, _r) (((_a) ^ (_b)) & ((_a) ^ (_r)))
+
+#define _SOP_V_ARITH_add(_a, _b) ((_a) + (_b))
+#define _SOP_V_ARITH_sub(_a, _b) ((_a) - (_b))
+
+/* Shared scalar tail: exactly the same-type macro, element by element. */
+#define _SOP_ARRAY_SCALAR_TAIL(_op, _t, _s, _sign) \
+    for (j = i; j < n; ++j) { \
+      _t r = 0; \
+      if (!sop_##_s##_op(_sign, _t, &r, _sign, _t, a[j], _sign, _t, b[j])) { \
+        if (fail_index) \
+          *fail_index = j; \
+        return 0; \
+      } \
+      if (dst) \
+        dst[j] = r; \
+    } \
+    return 1;
+
+#if defined(SOP_VECTOR)
+/* _SOP_ARRAY_ADDSUB
+ * Defines sop_<op>_array_<m>.  _s is 's' or 'u' and picks both the scalar
+ * same-type macro and the vector overflow test.
+ */
+#define _SOP_ARRAY_ADDSUB(_op, _m, _t, _s, _sign) \
+  int _SOP_FN(sop_##_op##_array_##_m)(_t *dst, const _t *a, const _t *b, \
+                                      size_t n, size_t *fail_index) { \
+    const size_t lanes = SOP_VEC_BYTES / sizeof(_t); \
+    const sop_v_##_m##_u_t top = (sop_v_##_m##_u_t) {0} + \
+      (__typeof__(top[0])) (1ULL << (sizeof(_t) * CHAR_BIT - 1)); \
+    size_t i = 0, j; \
+    for (; i + lanes <= n; i += lanes) { \
+      sop_v_##_m##_u_t va, vb, vr; \
+      sop_v_mask_t ov; \
+      memcpy(&va, a + i, sizeof(va)); \
+      memcpy(&vb, b + i, sizeof(vb)); \
+      vr = _SOP_V_ARITH_##_op(va, vb); \
+      ov = (sop_v_mask_t) (_SOP_V_OV_##_s##_op(va, vb, vr) & top); \
+      if (_SOP_V_ANY(ov)) \
+        break; \
+      if (dst) \
+        memcpy(dst + i, &vr, sizeof(vr)); \
+    } \
+    /* The tail and any vector which overflowed */ \
+    _SOP_ARRAY_SCALAR_TAIL(_op, _t, _s, _sign) \
+  }
+#else
+/* SWAR: without vectors, the lanes are packed into 64-bit words.  The top
+ * bit of each lane is masked off so carries and borrows cannot cross into
+ * the next lane, then put back with an xor.
+ *  add: ((a & ~H) + (b & ~H)) ^ ((a ^ b) & H)
+ *  sub: ((a | H) - (b & ~H)) ^ ((a ^ ~b) & H)
+ * where H has the top bit of every lane set.  Two words are done per step
+ * to overlap their dependency chains.  With only one or two lanes per word
+ * this is slower than the scalar macros, so 32- and 64-bit elements go
+ * straight to those.
+ */
+#define _SOP_SWAR_add(_a, _b, _h) \
+  ((((_a) & ~(_h)) + ((_b) & ~(_h))) ^ (((_a) ^ (_b)) & (_h)))
+#define _SOP_SWAR_sub(_a, _b, _h) \
+  ((((_a) | (_h)) - ((_b) & ~(_h))) ^ (((_a) ^ ~(_b)) & (_h)))
+
+#define _SOP_ARRAY_ADDSUB(_op, _m, _t, _s, _sign) \
+  int _SOP_FN(sop_##_op##_array_##_m)(_t *dst, const _t *a, const _t *b, \
+                                      size_t n, size_t *fail_index) { \
+    const size_t lanes = 2 * sizeof(uint64_t) / sizeof(_t); \
+    const unsigned int bits = sizeof(_t) * CHAR_BIT; \
+    const uint64_t h = (UINT64_MAX / (UINT64_MAX >> (64 - bits))) << \
+                       (bits - 1); \
+    size_t i = 0, j; \
+    for (; sizeof(_t) <= 2 && i + lanes <= n; i += lanes) { \
+      uint64_t va[2], vb[2], vr[2]; \
+      memcpy(va, a + i, sizeof(va)); \
+      memcpy(vb, b + i, sizeof(vb)); \
+      vr[0] = _SOP_SWAR_##_op(va[0], vb[0], h); \
+      vr[1] = _SOP_SWAR_##_op(va[1], vb[1], h); \
+      if (((_SOP_V_OV_##_s##_op(va[0], vb[0], vr[0]) | \
+            _SOP_V_OV_##_s##_op(va[1], vb[1], vr[1])) & h) != 0) \
+        break; \
+      if (dst) \
+        memcpy(dst + i, vr, sizeof(vr)); \
+    } \
+    _SOP_ARRAY_SCALAR_TAIL(_op, _t, _s, _sign) \
+  }
+#endif
+
+#define _SOP_ARRAY_DEFINE(_m, _t, _s, _sign) \
+  _SOP_ARRAY_ADDSUB(add, _m, _t, _s, _sign) \
+  _SOP_ARRAY_ADDSUB(sub, _m, _t, _s, _sign)
+
+_SOP_ARRAY_DEFINE(u8, uint8_t, u, 0)
+_SOP_ARRAY_DEFINE(s8, int8_t, s, 1)
+_SOP_ARRAY_DEFINE(u16, uint16_t, u, 0)
+_SOP_ARRAY_DEFINE(s16, int16_t, s, 1)
+_SOP_ARRAY_DEFINE(u32, uint32_t, u, 0)
+_SOP_ARRAY_DEFINE(s32, int32_t, s, 1)
+_SOP_ARRAY_DEFINE(u64, uint64_t, u, 0)
+_SOP_ARRAY_DEFINE(s64, int64_t, s, 1)
+
+/* Multiplication
+ * Products are computed exactly in lanes of twice the width, so a lane
+ * overflowed if its product does not survive the trip back to the narrow
+ * type.  The vectors are widened and narrowed with __builtin_convertvector,
+ * which becomes punpck/pmovzx/pmovsx and pack/shuffle sequences, and the
+ * wide multiply becomes pmullw, pmulld or pmuludq/pmuldq depending on the
+ * target.  As before, only bitwise tests are used on the wide lanes:
+ *  unsigned: the high half of the product is non-zero
+ *  signed:   p + 2^(bits-1), taken as unsigned, has a non-zero high half
+ */
+#if defined(SOP_VECTOR)
+#define _SOP_VEC_WIDE_TYPES(_m, _wtype, _wutype) \
+  typedef _wtype sop_v_##_m##_w_t \
+    __attribute__((vector_size(2 * SOP_VEC_BYTES))); \
+  typedef _wutype sop_v_##_m##_wu_t \
+    __attribute__((vector_size(2 * SOP_VEC_BYTES)));
+
+_SOP_VEC_WIDE_TYPES(u8, uint16_t, uint16_t)
+_SOP_VEC_WIDE_TYPES(s8, int16_t, uint16_t)
+_SOP_VEC_WIDE_TYPES(u16, uint32_t, uint32_t)
+_SOP_VEC_WIDE_TYPES(s16, int32_t, uint32_t)
+_SOP_VEC_WIDE_TYPES(u32, uint64_t, uint64_t)
+_SOP_VEC_WIDE_TYPES(s32, int64_t, uint64_t)
+
+typedef uint64_t sop_v_wmask_t
+  __attribute__((vector_size(2 * SOP_VEC_BYTES)));
+
+#define _SOP_V_ANY_WIDE(_m) \
+  (((((_m)[0] | (_m)[1]) | ((_m)[2] | (_m)[3])) | \
+    (((_m)[4] | (_m)[5]) | ((_m)[6] | (_m)[7]))) != 0)
+
+#define _SOP_V_MUL_OV_u(_p, _bits) ((_p) >> (_bits))
+#define _SOP_V_MUL_OV_s(_p, _bits) \
+  (((_p) + (__typeof__((_p)[0])) (1ULL << ((_bits) - 1))) >> (_bits))
+
+#define _SOP_ARRAY_MUL_WIDEN(_m, _type, _s, _sign) \
+  int _SOP_FN(sop_mul_array_##_m)(_type *dst, const _type *a, const _type *b, \
+                                  size_t n, size_t *fail_index) { \
+    const size_t lanes = SOP_VEC_BYTES / sizeof(_type); \
+    const unsigned int bits = sizeof(_type) * CHAR_BIT; \
+    size_t i = 0, j; \
+    for (; i + lanes <= n; i += lanes) { \
+      sop_v_##_m##_t va, vb, vr; \
+      sop_v_##_m##_w_t p; \
+      sop_v_wmask_t ov; \
+      memcpy(&va, a + i, sizeof(va)); \
+      memcpy(&vb, b + i, sizeof(vb)); \
+      p = __builtin_convertvector(va, sop_v_##_m##_w_t) * \
+          __builtin_convertvector(vb, sop_v_##_m##_w_t); \
+      ov = (sop_v_wmask_t) \
+        _SOP_V_MUL_OV_##_s((sop_v_##_m##_wu_t) p, bits); \
+      if (_SOP_V_ANY_WIDE(ov)) \
+        break; \
+      if (dst) { \
+        vr = __builtin_convertvector(p, sop_v_##_m##_t); \
+        memcpy(dst + i, &vr, sizeof(vr)); \
+      } \
+    } \
+    _SOP_ARRAY_SCALAR_TAIL(mul, _type, _s, _sign) \
+  }
+#else
+#define _SOP_ARRAY_MUL_WIDEN(_m, _type, _s, _sign) \
+  int _SOP_FN(sop_mul_array_##_m)(_type *dst, const _type *a, const _type *b, \
+                                  size_t n, size_t *fail_index) { \
+    size_t i = 0, j; \
+    _SOP_ARRAY_SCALAR_TAIL(mul, _type, _s, _sign) \
+  }
+#endif
+
+_SOP_ARRAY_MUL_WIDEN(u8, uint8_t, u, 0)
+_SOP_ARRAY_MUL_WIDEN(s8, int8_t, s, 1)
+_SOP_ARRAY_MUL_WIDEN(u16, uint16_t, u, 0)
+_SOP_ARRAY_MUL_WIDEN(s16, int16_t, s, 1)
+
+/* 32-bit lanes
+ * Compilers do not notice that the high halves of zero or sign extended
+ * 64-bit lanes are known, and emit a full 64x64 multiply per lane.  On x86
+ * pmuludq (SSE2) and pmuldq (SSE4.1) produce exactly the 32x32->64 products
+ * needed from the even lanes, so the odd lanes are shifted down and
+ * multiplied separately.
+ */
+#define _SOP_ARRAY_MUL_32(_m, _type, _s, _sign, _mul) \
+  int _SOP_FN(sop_mul_array_##_m)(_type *dst, const _type *a, const _type *b, \
+                                  size_t n, size_t *fail_index) { \
+    const __m128i bias = _SOP_MUL_32_BIAS_##_s; \
+    const __m128i lo = _mm_set_epi32(0, -1, 0, -1); \
+    const __m128i zero = _mm_setzero_si128(); \
+    size_t i = 0, j; \
+    for (; i + 4 <= n; i += 4) { \
+      __m128i va = _mm_loadu_si128((const __m128i *) (a + i)); \
+      __m128i vb = _mm_loadu_si128((const __m128i *) (b + i)); \
+      __m128i even = _mul(va, vb); \
+      __m128i odd = _mul(_mm_srli_epi64(va, 32), _mm_srli_epi64(vb, 32)); \
+      __m128i hi = _mm_or_si128( \
+          _mm_srli_epi64(_mm_add_epi64(even, bias), 32), \
+          _mm_srli_epi64(_mm_add_epi64(odd, bias), 32)); \
+      if (_mm_movemask_epi8(_mm_cmpeq_epi32(hi, zero)) != 0xffff) \
+        break; \
+      if (dst) \
+        _mm_storeu_si128((__m128i *) (dst + i), \
+                         _mm_or_si128(_mm_and_si128(even, lo), \
+                                      _mm_slli_epi64(odd, 32))); \
+    } \
+    _SOP_ARRAY_SCALAR_TAIL(mul, _type, _s, _sign) \
+  }
+
+/* Same bias trick as _SOP_V_MUL_OV_s: a signed product fits if adding 2^31
+ * leaves the high half zero. */
+#define _SOP_MUL_32_BIAS_u _mm_setzero_si128()
+#define _SOP_MUL_32_BIAS_s _mm_set_epi32(0, INT32_MAX + 1U, 0, INT32_MAX + 1U)
+
+#if defined(SOP_SSE2)
+_SOP_ARRAY_MUL_32(u32, uint32_t, u, 0, _mm_mul_epu32)
+#else
+_SOP_ARRAY_MUL_WIDEN(u32, uint32_t, u, 0)
+#endif
+#if defined(SOP_SSE4_1)
+_SOP_ARRAY_MUL_32(s32, int32_t, s, 1, _mm_mul_epi32)
+#else
+_SOP_ARRAY_MUL_WIDEN(s32, int32_t, s, 1)
+#endif
+
+/* There are no vector multiplies producing 128-bit lanes, so 64-bit
+ * elements are multiplied one at a time.  Where the compiler has a 128-bit
+ * type the product is still computed exactly and its high half checked,
+ * which avoids the division sop_umul/sop_smul use.
+ */
+#if defined(__SIZEOF_INT128__)
+#define _SOP_MUL_64_OV_u(_p) ((_p) >> 64)
+#define _SOP_MUL_64_OV_s(_p) ((_p) < INT64_MIN || (_p) > INT64_MAX)
+
+#define _SOP_ARRAY_MUL_64(_m, _type, _wt, _s, _sign) \
+  int _SOP_FN(sop_mul_array_##_m)(_type *dst, const _type *a, const _type *b, \
+                                  size_t n, size_t *fail_index) { \
+    size_t i; \
+    for (i = 0; i < n; ++i) { \
+      _wt p = (_wt) a[i] * (_wt) b[i]; \
+      if (_SOP_MUL_64_OV_##_s(p)) { \
+        if (fail_index) \
+          *fail_index = i; \
+        return 0; \
+      } \
+      if (dst) \
+        dst[i] = (_type) p; \
+    } \
+    return 1; \
+  }
+#else
+#define _SOP_ARRAY_MUL_64(_m, _type, _wt, _s, _sign) \
+  int _SOP_FN(sop_mul_array_##_m)(_type *dst, const _type *a, const _type *b, \
+                                  size_t n, size_t *fail_index) { \
+    size_t i = 0, j; \
+    _SOP_ARRAY_SCALAR_TAIL(mul, _type, _s, _sign) \
+  }
+#endif
+
+_SOP_ARRAY_MUL_64(u64, uint64_t, unsigned __int128, u, 0)
+_SOP_ARRAY_MUL_64(s64, int64_t, __int128, s, 1)
+
+/* Summation
+ * sop_sum_<type> gives the same answer as a serial sop_add chain: it fails
+ * if any running total leaves the type.  Elements are added without checks
+ * into lanes wide enough that a SOP_SUM_BLOCK element block cannot overflow
+ * them, and the running total is only checked once per block.
+ *  unsigned: running totals only grow, so the chain fails exactly when the
+ *            total does.  A block that takes the total past the maximum
+ *            ends the sum.
+ *  signed:   positive and negative elements are accumulated separately.
+ *            If neither the running total plus all of the block's positives
+ *            nor plus all of its negatives leaves the type, no partial sum
+ *            in the block can either.  Otherwise the block is redone with
+ *            sop_sadd to find out whether the chain really fails.
+ */
+#define SOP_SUM_BLOCK 1024
+
+#if defined(SOP_VECTOR)
+#define _SOP_VEC_ACC_TYPE(_m, _type, _acc) \
+  typedef _acc sop_v_##_m##_acc_t \
+    __attribute__((vector_size(SOP_VEC_BYTES / sizeof(_type) * \
+                               sizeof(_acc))));
+
+/* With 1024 elements per block, 32-bit lanes hold any 8- or 16-bit block. */
+_SOP_VEC_ACC_TYPE(u8, uint8_t, uint32_t)
+_SOP_VEC_ACC_TYPE(s8, int8_t, int32_t)
+_SOP_VEC_ACC_TYPE(u16, uint16_t, uint32_t)
+_SOP_VEC_ACC_TYPE(s16, int16_t, int32_t)
+_SOP_VEC_ACC_TYPE(u32, uint32_t, uint64_t)
+_SOP_VEC_ACC_TYPE(s32, int32_t, int64_t)
+
+/* Splits w into the pos and neg accumulators.  acc_bits is the width of
+ * an accumulator lane; the arithmetic shift gives -1 for negative lanes. */
+#define _SOP_SUM_SPLIT_u(_w, _pos, _neg, _acc_bits) \
+  (_pos) += (_w);
+#define _SOP_SUM_SPLIT_s(_w, _pos, _neg, _acc_bits) \
+  { \
+    __typeof__(_w) _sign_mask = (_w) >> ((_acc_bits) - 1); \
+    (_pos) += (_w) & ~_sign_mask; \
+    (_neg) += (_w) & _sign_mask; \
+  }
+
+/* _sop_sum_block_<type> adds up at most SOP_SUM_BLOCK elements into their
+ * positive and negative parts, without any checks. */
+#define _SOP_SUM_BLOCK_FN(_m, _type, _s, _total_type) \
+  static void _sop_sum_block_##_m(const _type *a, size_t n, \
+                                  _total_type *bpos, _total_type *bneg) { \
+    const size_t lanes = SOP_VEC_BYTES / sizeof(_type); \
+    const unsigned int acc_bits = sizeof(((sop_v_##_m##_acc_t) {0})[0]) * \
+                                  CHAR_BIT; \
+    sop_v_##_m##_acc_t pos = {0}, neg = {0}; \
+    size_t i, k; \
+    (void) acc_bits; \
+    *bpos = *bneg = 0; \
+    for (i = 0; i + lanes <= n; i += lanes) { \
+      sop_v_##_m##_t v; \
+      sop_v_##_m##_acc_t w; \
+      memcpy(&v, a + i, sizeof(v)); \
+      w = __builtin_convertvector(v, sop_v_##_m##_acc_t); \
+      _SOP_SUM_SPLIT_##_s(w, pos, neg, acc_bits) \
+    } \
+    for (k = 0; k < lanes; ++k) { \
+      *bpos += pos[k]; \
+      *bneg += neg[k]; \
+    } \
+    for (; i < n; ++i) { \
+      if (a[i] > 0) \
+        *bpos += a[i]; \
+      else \
+        *bneg += a[i]; \
+    } \
+  }
+#else
+#define _SOP_SUM_BLOCK_FN(_m, _type, _s, _total_type) \
+  static void _sop_sum_block_##_m(const _type *a, size_t n, \
+                                  _total_type *bpos, _total_type *bneg) { \
+    size_t i; \
+    *bpos = *bneg = 0; \
+    for (i = 0; i < n; ++i) { \
+      if (a[i] > 0) \
+        *bpos += a[i]; \
+      else \
+        *bneg += a[i]; \
+    } \
+  }
+#endif
+
+#define _SOP_SUM_BLOCK_OK_u(_total, _pos, _neg, _min, _max) \
+  ((_total) + (_pos) <= (_max))
+#define _SOP_SUM_BLOCK_OK_s(_total, _pos, _neg, _min, _max) \
+  ((_total) + (_pos) <= (_max) && (_total) + (_neg) >= (_min))
+
+/* Only reached by signed blocks; an unsigned block that fails the bound
+ * check really overflows. */
+#define _SOP_SUM_REPLAY_u(_type, _sign, _total, _start, _end) \
+  return 0;
+#define _SOP_SUM_REPLAY_s(_type, _sign, _total, _start, _end) \
+  { \
+    _type _r = (_type) (_total); \
+    size_t _j; \
+    for (_j = (_start); _j < (_end); ++_j) \
+      if (!sop_sadd(_sign, _type, &_r, _sign, _type, _r, _sign, _type, a[_j])) \
+        return 0; \
+    (_total) = _r; \
+  }
+
+#define _SOP_SUM_WIDEN(_m, _type, _s, _sign, _total_type, _min, _max) \
+  _SOP_SUM_BLOCK_FN(_m, _type, _s, _total_type) \
+  int _SOP_FN(sop_sum_##_m)(_type *result, const _type *a, size_t n) { \
+    _total_type total = 0, bpos, bneg; \
+    size_t start; \
+    for (start = 0; start < n; start += SOP_SUM_BLOCK) { \
+      const size_t end = (n - start > SOP_SUM_BLOCK) ? start + SOP_SUM_BLOCK \
+                                                     : n; \
+      _sop_sum_block_##_m(a + start, end - start, &bpos, &bneg); \
+      if (_SOP_SUM_BLOCK_OK_##_s(total, bpos, bneg, _min, _max)) \
+        total += bpos + bneg; \
+      else \
+        _SOP_SUM_REPLAY_##_s(_type, _sign, total, start, end) \
+    } \
+    if (result) \
+      *result = (_type) total; \
+    return 1; \
+  }
+
+_SOP_SUM_WIDEN(u8, uint8_t, u, 0, uint64_t, 0, UINT8_MAX)
+_SOP_SUM_WIDEN(s8, int8_t, s, 1, int64_t, INT8_MIN, INT8_MAX)
+_SOP_SUM_WIDEN(u16, uint16_t, u, 0, uint64_t, 0, UINT16_MAX)
+_SOP_SUM_WIDEN(s16, int16_t, s, 1, int64_t, INT16_MIN, INT16_MAX)
+_SOP_SUM_WIDEN(u32, uint32_t, u, 0, uint64_t, 0, UINT32_MAX)
+_SOP_SUM_WIDEN(s32, int32_t, s, 1, int64_t, INT32_MIN, INT32_MAX)
+
+#if defined(SOP_VECTOR)
+/* 64-bit elements have no wider lane to go to.  Unsigned sums split each
+ * element into 32-bit halves summed in separate lanes, and signed sums bound
+ * each block by the magnitude of its largest element, replaying the block
+ * with sop_sadd when that bound is too loose.  These use the 16-byte
+ * sop_v_u64x2_t from safe_iop.h: GCC only keeps vectors no wider than the
+ * machine's in registers.
+ */
+int _SOP_FN(sop_sum_u64)(uint64_t *result, const uint64_t *a, size_t n) {
+  const sop_v_u64x2_t low = { UINT32_MAX, UINT32_MAX };
+  sop_v_u64x2_t lo0 = {0}, lo1 = {0}, hi0 = {0}, hi1 = {0};
+  uint64_t total = 0, w[4][2], lo, hi;
+  size_t start, i;
+  /* Each lane sums the low and high 32-bit halves separately, which
+   * cannot carry out for 2^32 additions.  The carries out of the low
+   * half are counted into the high half when the lanes are folded, and
+   * all addends are non-negative, so one range check at each block
+   * boundary stands in for every per-element check. */
+  for (start = 0; start < n; start = i) {
+    const size_t end = (n - start > UINT32_MAX) ? start + UINT32_MAX : n;
+    for (i = start; i + 4 <= end; i += 4) {
+      sop_v_u64x2_t v0, v1;
+      memcpy(&v0, a + i, sizeof(v0));
+      memcpy(&v1, a + i + 2, sizeof(v1));
+      lo0 += v0 & low;
+      lo1 += v1 & low;
+      hi0 += v0 >> 32;
+      hi1 += v1 >> 32;
+    }
+    memcpy(w[0], &lo0, sizeof(w[0]));
+    memcpy(w[1], &lo1, sizeof(w[1]));
+    memcpy(w[2], &hi0, sizeof(w[2]));
+    memcpy(w[3], &hi1, sizeof(w[3]));
+    lo = (w[0][0] & UINT32_MAX) + (w[0][1] & UINT32_MAX) +
+         (w[1][0] & UINT32_MAX) + (w[1][1] & UINT32_MAX);
+    hi = (w[0][0] >> 32) + (w[0][1] >> 32) + (w[1][0] >> 32) +
+         (w[1][1] >> 32) + (lo >> 32);
+    /* a high lane past 2^62 means the block alone passed 2^94 */
+    if ((w[2][0] | w[2][1] | w[3][0] | w[3][1]) >> 62)
+      return 0;
+    hi += w[2][0] + w[2][1] + w[3][0] + w[3][1];
+    if (hi > UINT32_MAX)
+      return 0;
+    if (!sop_uadd(0, uint64_t, &total, 0, uint64_t, total, 0, uint64_t,
+                  (hi << 32) | (lo & UINT32_MAX)))
+      return 0;
+    for (; i < end; ++i)
+      if (!sop_uadd(0, uint64_t, &total, 0, uint64_t, total, 0, uint64_t, a[i]))
+        return 0;
+    lo0 = lo1 = hi0 = hi1 = (sop_v_u64x2_t) {0};
+  }
+  if (result)
+    *result = total;
+  return 1;
+}
+#else
+int _SOP_FN(sop_sum_u64)(uint64_t *result, const uint64_t *a, size_t n) {
+  uint64_t total = 0;
+  size_t i;
+  for (i = 0; i < n; ++i)
+    if (!sop_uadd(0, uint64_t, &total, 0, uint64_t, total, 0, uint64_t, a[i]))
+      return 0;
+  if (result)
+    *result = total;
+  return 1;
+}
+#endif
+
+/* Sums a block of at most SOP_SUM_BLOCK elements.  Every element satisfies
+ * |a[i]| <= 2^bits where bits covers the OR of their one's complement
+ * magnitudes, so no running total in the block strays further than
+ * n << bits from where it started.  When that bound fits, the wrapped lane
+ * sum is exact and it is returned with the bound; otherwise returns 0. */
+static int _sop_sum_s64_block(const int64_t *a, size_t n, int64_t *sum,
+                              uint64_t *bound) {
+  uint64_t total = 0, bits = 0;
+  size_t i = 0;
+#if defined(SOP_VECTOR)
+  sop_v_u64x2_t acc0 = {0}, acc1 = {0}, or0 = {0}, or1 = {0};
+  uint64_t w[4][2];
+  for (; i + 4 <= n; i += 4) {
+    sop_v_u64x2_t v0, v1;
+    memcpy(&v0, a + i, sizeof(v0));
+    memcpy(&v1, a + i + 2, sizeof(v1));
+    acc0 += v0;
+    acc1 += v1;
+    or0 |= v0 ^ (0 - (v0 >> 63));
+    or1 |= v1 ^ (0 - (v1 >> 63));
+  }
+  memcpy(w[0], &acc0, sizeof(w[0]));
+  memcpy(w[1], &acc1, sizeof(w[1]));
+  memcpy(w[2], &or0, sizeof(w[2]));
+  memcpy(w[3], &or1, sizeof(w[3]));
+  total = w[0][0] + w[0][1] + w[1][0] + w[1][1];
+  bits = w[2][0] | w[2][1] | w[3][0] | w[3][1];
+#endif
+  for (; i < n; ++i) {
+    const uint64_t v = (uint64_t) a[i];
+    total += v;
+    bits |= v ^ (0 - (v >> 63));
+  }
+  for (i = 0; bits; ++i)
+    bits >>= 1;
+  if (i > 52)
+    return 0;
+  *sum = (int64_t) total;
+  *bound = (uint64_t) n << i;
+  return 1;
+}
+
+int _SOP_FN(sop_sum_s64)(int64_t *result, const int64_t *a, size_t n) {
+  int64_t total = 0, sum;
+  uint64_t bound;
+  size_t start;
+  for (start = 0; start < n; start += SOP_SUM_BLOCK) {
+    const size_t end = (n - start > SOP_SUM_BLOCK) ? start + SOP_SUM_BLOCK : n;
+    if (_sop_sum_s64_block(a + start, end - start, &sum, &bound) &&
+        total <= INT64_MAX - (int64_t) bound &&
+        total >= INT64_MIN + (int64_t) bound) {
+      total += sum;
+      continue;
+    }
+    _SOP_SUM_REPLAY_s(int64_t, 1, total, start, end)
+  }
+  if (result)
+    *result = total;
+  return 1;
+}
+
+/* Dot products
+ * sop_dot_<type> returns the exact sum of the products, so it only fails if
+ * that sum does not fit the (wider) result type; a partial sum may leave the
+ * type on the way as long as the total comes back.  Products are split into
+ * halves which are accumulated in lanes twice their width, where a
+ * SOP_SUM_BLOCK element block cannot overflow them, and each block is folded
+ * into a 128-bit total.  Without a 128-bit type the kernels fall back to a
+ * serial chain of checked multiplies and adds, which also fails when a
+ * partial sum leaves the result type.
+ */
+#if defined(__SIZEOF_INT128__)
+
+#define _SOP_DOT_SCALAR_TAIL(_total, _wt) \
+  for (; i < n; ++i) \
+    _total += (_wt) a[i] * b[i];
+
+#define _SOP_DOT_RESULT(_total, _rt, _min, _max) \
+  if (_total < (_min) || _total > (_max)) \
+    return 0; \
+  if (result) \
+    *result = (_rt) _total; \
+  return 1;
+
+int _SOP_FN(sop_dot_s16)(int32_t *result, const int16_t *a, const int16_t *b,
+                         size_t n) {
+  __int128 total = 0;
+  size_t i = 0;
+#if defined(SOP_SSE2)
+  const __m128i low = _mm_set1_epi32(0xffff);
+  const __m128i wrapped = _mm_set1_epi32(INT32_MIN);
+  size_t start;
+  /* pmaddwd adds pairs of products into 32-bit lanes.  Only a pair of
+   * -32768 * -32768 products reaches 2^31, which wraps to INT32_MIN and
+   * is counted separately.  The lanes are split into a 16-bit low half
+   * and a signed high half so a block can be summed without overflow. */
+  for (start = 0; n - start >= 8; start = i) {
+    const size_t end = (n - start > SOP_SUM_BLOCK) ? start + SOP_SUM_BLOCK : n;
+    __m128i lo = _mm_setzero_si128(), hi = lo, wraps = lo;
+    int32_t w[3][4];
+    int k;
+    for (i = start; i + 8 <= end; i += 8) {
+      __m128i p = _mm_madd_epi16(_mm_loadu_si128((const __m128i *) (a + i)),
+                                 _mm_loadu_si128((const __m128i *) (b + i)));
+      wraps = _mm_sub_epi32(wraps, _mm_cmpeq_epi32(p, wrapped));
+      lo = _mm_add_epi32(lo, _mm_and_si128(p, low));
+      hi = _mm_add_epi32(hi, _mm_srai_epi32(p, 16));
+    }
+    _mm_storeu_si128((__m128i *) w[0], lo);
+    _mm_storeu_si128((__m128i *) w[1], hi);
+    _mm_storeu_si128((__m128i *) w[2], wraps);
+    for (k = 0; k < 4; ++k)
+      total += (__int128) w[0][k] + ((__int128) w[1][k] << 16) +
+               ((__int128) w[2][k] << 32);
+  }
+#endif
+  _SOP_DOT_SCALAR_TAIL(total, int32_t)
+  _SOP_DOT_RESULT(total, int32_t, INT32_MIN, INT32_MAX)
+}
+
+#if defined(SOP_SSE2)
+/* pmuludq multiplies the even 32-bit lanes into 64-bit products.  For
+ * signed lanes the product is corrected modulo 2^64 by subtracting
+ * 2^32 * b for a negative a and 2^32 * a for a negative b, and products
+ * with the sign bit set are counted so the total can take 2^64 back off.
+ * An unsigned total only grows, so a block past the maximum ends it. */
+#define _SOP_DOT_32_SIGN_u(_a, _b, _even, _odd, _neg, _low)
+#define _SOP_DOT_32_SIGN_s(_a, _b, _even, _odd, _neg, _low) { \
+    __m128i c = _mm_add_epi32( \
+        _mm_and_si128(_mm_srai_epi32(_a, 31), _b), \
+        _mm_and_si128(_mm_srai_epi32(_b, 31), _a)); \
+    _even = _mm_sub_epi64(_even, _mm_slli_epi64(c, 32)); \
+    _odd = _mm_sub_epi64(_odd, _mm_andnot_si128(_low, c)); \
+    _neg = _mm_add_epi64(_neg, _mm_add_epi64(_mm_srli_epi64(_even, 63), \
+                                             _mm_srli_epi64(_odd, 63))); \
+  }
+#define _SOP_DOT_32_EARLY_u(_total, _max) \
+  if (_total > (_max)) \
+    return 0;
+#define _SOP_DOT_32_EARLY_s(_total, _max)
+
+#define _SOP_DOT_32_BLOCKS(_s, _total, _max) \
+  const __m128i low = _mm_set_epi32(0, -1, 0, -1); \
+  size_t start; \
+  for (start = 0; n - start >= 4; start = i) { \
+    const size_t end = (n - start > SOP_SUM_BLOCK) ? start + SOP_SUM_BLOCK : n; \
+    __m128i lo = _mm_setzero_si128(), hi = lo, neg = lo; \
+    uint64_t w[3][2]; \
+    int k; \
+    for (i = start; i + 4 <= end; i += 4) { \
+      __m128i va = _mm_loadu_si128((const __m128i *) (a + i)); \
+      __m128i vb = _mm_loadu_si128((const __m128i *) (b + i)); \
+      __m128i even = _mm_mul_epu32(va, vb); \
+      __m128i odd = _mm_mul_epu32(_mm_srli_epi64(va, 32), \
+                                  _mm_srli_epi64(vb, 32)); \
+      _SOP_DOT_32_SIGN_##_s(va, vb, even, odd, neg, low) \
+      lo = _mm_add_epi64(lo, _mm_add_epi64(_mm_and_si128(even, low), \
+                                           _mm_and_si128(odd, low))); \
+      hi = _mm_add_epi64(hi, _mm_add_epi64(_mm_srli_epi64(even, 32), \
+                                           _mm_srli_epi64(odd, 32))); \
+    } \
+    _mm_storeu_si128((__m128i *) w[0], lo); \
+    _mm_storeu_si128((__m128i *) w[1], hi); \
+    _mm_storeu_si128((__m128i *) w[2], neg); \
+    for (k = 0; k < 2; ++k) \
+      _total += (__int128) w[0][k] + ((__int128) w[1][k] << 32) - \
+                ((__int128) w[2][k] << 64); \
+    _SOP_DOT_32_EARLY_##_s(_total, _max) \
+  }
+#else
+#define _SOP_DOT_32_BLOCKS(_s, _total, _max)
+#endif
+
+#define _SOP_DOT_32(_m, _type, _rt, _s, _min, _max) \
+  int _SOP_FN(sop_dot_##_m)(_rt *result, const _type *a, const _type *b, \
+                            size_t n) { \
+    __int128 total = 0; \
+    size_t i = 0; \
+    _SOP_DOT_32_BLOCKS(_s, total, _max) \
+    _SOP_DOT_SCALAR_TAIL(total, _rt) \
+    _SOP_DOT_RESULT(total, _rt, _min, _max) \
+  }
+
+_SOP_DOT_32(s32, int32_t, int64_t, s, INT64_MIN, INT64_MAX)
+_SOP_DOT_32(u32, uint32_t, uint64_t, u, 0, UINT64_MAX)
+
+#else
+
+#define _SOP_DOT_SERIAL(_m, _type, _rt, _s, _sign) \
+  int _SOP_FN(sop_dot_##_m)(_rt *result, const _type *a, const _type *b, \
+                            size_t n) { \
+    _rt total = 0, p; \
+    size_t i; \
+    for (i = 0; i < n; ++i) { \
+      if (!sop_##_s##mul(_sign, _rt, &p, _sign, _rt, a[i], _sign, _rt, b[i])) \
+        return 0; \
+      if (!sop_##_s##add(_sign, _rt, &total, _sign, _rt, total, \
+                         _sign, _rt, p)) \
+        return 0; \
+    } \
+    if (result) \
+      *result = total; \
+    return 1; \
+  }
+
+_SOP_DOT_SERIAL(s16, int16_t, int32_t, s, 1)
+_SOP_DOT_SERIAL(s32, int32_t, int64_t, s, 1)
+_SOP_DOT_SERIAL(u32, uint32_t, uint64_t, u, 0)
+
+#endif
+
+/* Matrix multiply
+ * sop_gemm_<type> gives each element of C the exact sum of its products, as
+ * sop_dot_<type> does, and fails only if one does not fit.  C is computed in
+ * tiles of a few rows by SOP_GEMM_NR columns, walking down each column panel
+ * of B so that the panel stays in cache while every row of A passes over
+ * it.  Inside a tile the products are split into halves which are summed
+ * unchecked in vector lanes, where a block of SOP_SUM_BLOCK steps cannot
+ * overflow them, and each block is folded into exact per-element totals.
+ * The totals are range checked once per tile, as the tile is stored.
+ *
+ * 16-bit tiles multiply two rows of B at once with pmaddwd.  As in
+ * sop_dot_s16, only a pair of -32768 * -32768 products wraps, to INT32_MIN,
+ * and that is put right in the high half.  32-bit tiles bias both operands
+ * to unsigned so that pmuludq gives exact products, and take the bias back
+ * off with the row and column sums when folding:
+ *   a * b = (a + 2^31)(b + 2^31) - 2^31 ((a + 2^31) + (b + 2^31)) + 2^62
+ * Edge tiles, and every tile without SSE2, are summed by plain loops into
+ * the same totals.  Without a 128-bit type sop_gemm_s32 falls back to a
+ * serial chain of checked multiplies and adds per element.
+ */
+#define SOP_GEMM_MR 4
+#if defined(SOP_AVX2)
+#define SOP_GEMM_NR 8
+#elif defined(SOP_SSE2)
+#define SOP_GEMM_NR 4
+#else
+#define SOP_GEMM_NR 8
+#endif
+
+/* Checks a tile of exact totals and stores it if every element fits. */
+#define _SOP_GEMM_STORE(_rt, _min, _max) \
+  for (r = 0; r < mr; ++r) \
+    for (q = 0; q < nr; ++q) \
+      if (t[r][q] < (_min) || t[r][q] > (_max)) \
+        return 0; \
+  if (c) \
+    for (r = 0; r < mr; ++r) \
+      for (q = 0; q < nr; ++q) \
+        c[r * n + q] = (_rt) t[r][q]; \
+  return 1;
+
+#define _SOP_GEMM_EDGE(_m, _type, _rt, _pt, _wt, _min, _max) \
+  static int _sop_gemm_##_m##_edge(_rt *c, const _type *a, const _type *b, \
+                                   size_t n, size_t k, size_t mr, \
+                                   size_t nr) { \
+    _wt t[SOP_GEMM_MR][SOP_GEMM_NR]; \
+    size_t r, q, p; \
+    memset(t, 0, sizeof(t)); \
+    for (p = 0; p < k; ++p) \
+      for (r = 0; r < mr; ++r) \
+        for (q = 0; q < nr; ++q) \
+          t[r][q] += (_pt) a[r * k + p] * b[p * n + q]; \
+    _SOP_GEMM_STORE(_rt, _min, _max) \
+  }
+
+#if defined(SOP_SSE2)
+#if defined(SOP_AVX2)
+typedef __m256i sop_v_gemm_t;
+#define _SOP_GEMM_MM(_f) _mm256_##_f
+#define _SOP_GEMM_SI(_f) _mm256_##_f##_si256
+
+/* Interleaves SOP_GEMM_NR 16-bit elements of two rows into pairs. */
+static inline sop_v_gemm_t _sop_gemm_pair16(const int16_t *b0,
+                                            const int16_t *b1) {
+  const __m128i r0 = _mm_loadu_si128((const __m128i *) b0);
+  const __m128i r1 = _mm_loadu_si128((const __m128i *) b1);
+  return _mm256_inserti128_si256(
+      _mm256_castsi128_si256(_mm_unpacklo_epi16(r0, r1)),
+      _mm_unpackhi_epi16(r0, r1), 1);
+}
+#else
+typedef __m128i sop_v_gemm_t;
+#define _SOP_GEMM_MM(_f) _mm_##_f
+#define _SOP_GEMM_SI(_f) _mm_##_f##_si128
+
+static inline sop_v_gemm_t _sop_gemm_pair16(const int16_t *b0,
+                                            const int16_t *b1) {
+  return _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *) b0),
+                            _mm_loadl_epi64((const __m128i *) b1));
+}
+#endif
+
+/* One pmaddwd step of a 16-bit tile: _pair holds a[p] in its low and
+ * a[p + 1] in its high 16 bits. */
+#define _SOP_GEMM16_STEP(_vb, _pair, _lo, _hi) { \
+    const sop_v_gemm_t vp = \
+      _SOP_GEMM_MM(madd_epi16)(_vb, _SOP_GEMM_MM(set1_epi32)(_pair)); \
+    const sop_v_gemm_t wrap = _SOP_GEMM_MM(cmpeq_epi32)(vp, wrapped); \
+    _lo = _SOP_GEMM_MM(add_epi32)(_lo, _SOP_GEMM_SI(and)(vp, low)); \
+    _hi = _SOP_GEMM_MM(add_epi32)(_hi, _SOP_GEMM_MM(sub_epi32)( \
+              _SOP_GEMM_MM(srai_epi32)(vp, 16), \
+              _SOP_GEMM_MM(slli_epi32)(wrap, 16))); \
+  }
+
+static int _sop_gemm_s16_full(int32_t *c, const int16_t *a,
+                              const int16_t *b, size_t n, size_t k) {
+  const sop_v_gemm_t wrapped = _SOP_GEMM_MM(set1_epi32)(INT32_MIN);
+  const sop_v_gemm_t low = _SOP_GEMM_MM(set1_epi32)(0xffff);
+  const size_t mr = SOP_GEMM_MR, nr = SOP_GEMM_NR;
+  int64_t t[SOP_GEMM_MR][SOP_GEMM_NR];
+  size_t start, p, r, q;
+  memset(t, 0, sizeof(t));
+  for (start = 0; start < k; start += 2 * SOP_SUM_BLOCK) {
+    const size_t end = (k - start > 2 * SOP_SUM_BLOCK) ?
+                       start + 2 * SOP_SUM_BLOCK : k;
+    sop_v_gemm_t lo[SOP_GEMM_MR], hi[SOP_GEMM_MR];
+    int32_t w[2][SOP_GEMM_NR];
+    for (r = 0; r < mr; ++r)
+      lo[r] = hi[r] = _SOP_GEMM_SI(setzero)();
+    for (p = start; p + 1 < end; p += 2) {
+      const sop_v_gemm_t vb = _sop_gemm_pair16(b + p * n, b + p * n + n);
+      for (r = 0; r < mr; ++r) {
+        int32_t pair;
+        memcpy(&pair, a + r * k + p, sizeof(pair));
+        _SOP_GEMM16_STEP(vb, pair, lo[r], hi[r])
+      }
+    }
+    if (p < end) {
+      /* an odd last row of B is paired with itself times 0 */
+      const sop_v_gemm_t vb = _sop_gemm_pair16(b + p * n, b + p * n);
+      for (r = 0; r < mr; ++r)
+        _SOP_GEMM16_STEP(vb, (int32_t) (uint16_t) a[r * k + p], lo[r], hi[r])
+    }
+    for (r = 0; r < mr; ++r) {
+      _SOP_GEMM_SI(storeu)((sop_v_gemm_t *) w[0], lo[r]);
+      _SOP_GEMM_SI(storeu)((sop_v_gemm_t *) w[1], hi[r]);
+      for (q = 0; q < nr; ++q)
+        t[r][q] += w[0][q] + (int64_t) w[1][q] * 65536;
+    }
+  }
+  _SOP_GEMM_STORE(int32_t, INT32_MIN, INT32_MAX)
+}
+#define SOP_GEMM_MR_s16 SOP_GEMM_MR
+
+#if defined(__SIZEOF_INT128__)
+static int _sop_gemm_s32_full(int64_t *c, const int32_t *a,
+                              const int32_t *b, size_t n, size_t k) {
+  const sop_v_gemm_t bias = _SOP_GEMM_MM(set1_epi32)(INT32_MIN);
+  const sop_v_gemm_t low = _SOP_GEMM_MM(set1_epi64x)(UINT32_MAX);
+  const size_t mr = 2, nr = SOP_GEMM_NR;
+  __int128 t[2][SOP_GEMM_NR];
+  size_t start, p, r, q;
+  memset(t, 0, sizeof(t));
+  for (start = 0; start < k; start += SOP_SUM_BLOCK) {
+    const size_t end = (k - start > SOP_SUM_BLOCK) ? start + SOP_SUM_BLOCK : k;
+    /* [row][even/odd columns] */
+    sop_v_gemm_t lo[2][2], hi[2][2], sb[2];
+    uint64_t sa[2] = { 0, 0 }, w[3][SOP_GEMM_NR / 2];
+    for (r = 0; r < 2; ++r)
+      sb[r] = lo[r][0] = lo[r][1] = hi[r][0] = hi[r][1] =
+        _SOP_GEMM_SI(setzero)();
+    for (p = start; p < end; ++p) {
+      const sop_v_gemm_t v = _SOP_GEMM_SI(xor)(
+          _SOP_GEMM_SI(loadu)((const sop_v_gemm_t *) (b + p * n)), bias);
+      const sop_v_gemm_t even = _SOP_GEMM_SI(and)(v, low);
+      const sop_v_gemm_t odd = _SOP_GEMM_MM(srli_epi64)(v, 32);
+      sb[0] = _SOP_GEMM_MM(add_epi64)(sb[0], even);
+      sb[1] = _SOP_GEMM_MM(add_epi64)(sb[1], odd);
+      for (r = 0; r < mr; ++r) {
+        const uint32_t ua = (uint32_t) a[r * k + p] ^ 0x80000000U;
+        const sop_v_gemm_t va = _SOP_GEMM_MM(set1_epi32)((int32_t) ua);
+        const sop_v_gemm_t pe = _SOP_GEMM_MM(mul_epu32)(even, va);
+        const sop_v_gemm_t po = _SOP_GEMM_MM(mul_epu32)(odd, va);
+        sa[r] += ua;
+        lo[r][0] = _SOP_GEMM_MM(add_epi64)(lo[r][0],
+                                           _SOP_GEMM_SI(and)(pe, low));
+        hi[r][0] = _SOP_GEMM_MM(add_epi64)(hi[r][0],
+                                           _SOP_GEMM_MM(srli_epi64)(pe, 32));
+        lo[r][1] = _SOP_GEMM_MM(add_epi64)(lo[r][1],
+                                           _SOP_GEMM_SI(and)(po, low));
+        hi[r][1] = _SOP_GEMM_MM(add_epi64)(hi[r][1],
+                                           _SOP_GEMM_MM(srli_epi64)(po, 32));
+      }
+    }
+    for (r = 0; r < mr; ++r) {
+      int s;
+      for (s = 0; s < 2; ++s) {
+        _SOP_GEMM_SI(storeu)((sop_v_gemm_t *) w[0], lo[r][s]);
+        _SOP_GEMM_SI(storeu)((sop_v_gemm_t *) w[1], hi[r][s]);
+        _SOP_GEMM_SI(storeu)((sop_v_gemm_t *) w[2], sb[s]);
+        for (q = 0; q < nr / 2; ++q)
+          t[r][2 * q + s] += (__int128) w[0][q] + ((__int128) w[1][q] << 32) -
+                             ((__int128) (sa[r] + w[2][q]) << 31) +
+                             ((__int128) (end - start) << 62);
+      }
+    }
+  }
+  _SOP_GEMM_STORE(int64_t, INT64_MIN, INT64_MAX)
+}
+#define SOP_GEMM_MR_s32 2
+#endif
+
+#define _SOP_GEMM_TILE(_m, _c, _a, _b, _mr, _nr) \
+  ((_mr) == SOP_GEMM_MR_##_m && (_nr) == SOP_GEMM_NR ? \
+     _sop_gemm_##_m##_full(_c, _a, _b, n, k) : \
+     _sop_gemm_##_m##_edge(_c, _a, _b, n, k, _mr, _nr))
+#else
+#define SOP_GEMM_MR_s16 SOP_GEMM_MR
+#define SOP_GEMM_MR_s32 SOP_GEMM_MR
+#define _SOP_GEMM_TILE(_m, _c, _a, _b, _mr, _nr) \
+  _sop_gemm_##_m##_edge(_c, _a, _b, n, k, _mr, _nr)
+#endif
+
+#define _SOP_GEMM(_m, _type, _rt) \
+  int _SOP_FN(sop_gemm_##_m)(_rt *c, const _type *a, const _type *b, \
+                             size_t m, size_t n, size_t k) { \
+    size_t i, j; \
+    for (j = 0; j < n; j += SOP_GEMM_NR) { \
+      const size_t nr = (n - j < SOP_GEMM_NR) ? n - j : SOP_GEMM_NR; \
+      for (i = 0; i < m; i += SOP_GEMM_MR_##_m) { \
+        const size_t mr = (m - i < SOP_GEMM_MR_##_m) ? \
+                          m - i : SOP_GEMM_MR_##_m; \
+        if (!_SOP_GEMM_TILE(_m, c ? c + i * n + j : NULL, a + i * k, b + j, \
+                            mr, nr)) \
+          return 0; \
+      } \
+    } \
+    return 1; \
+  }
+
+_SOP_GEMM_EDGE(s16, int16_t, int32_t, int32_t, int64_t, INT32_MIN, INT32_MAX)
+_SOP_GEMM(s16, int16_t, int32_t)
+
+#if defined(__SIZEOF_INT128__)
+_SOP_GEMM_EDGE(s32, int32_t, int64_t, int64_t, __int128, INT64_MIN, INT64_MAX)
+_SOP_GEMM(s32, int32_t, int64_t)
+#else
+int _SOP_FN(sop_gemm_s32)(int64_t *c, const int32_t *a, const int32_t *b,
+                          size_t m, size_t n, size_t k) {
+  size_t i, j, p;
+  for (i = 0; i < m; ++i)
+    for (j = 0; j < n; ++j) {
+      int64_t total = 0, prod;
+      for (p = 0; p < k; ++p)
+        if (!sop_smul(1, int64_t, &prod, 1, int64_t, a[i * k + p],
+                      1, int64_t, b[p * n + j]) ||
+            !sop_sadd(1, int64_t, &total, 1, int64_t, total,
+                      1, int64_t, prod))
+          return 0;
+      if (c)
+        c[i * n + j] = total;
+    }
+  return 1;
+}
+#endif
+
+/* Exclusive scans
+ * sop_exclusive_scan_<type> turns lengths into offsets.  Lengths are never
+ * negative, so offsets only grow and each step can wrap at most once: the
+ * first overflow is exactly the first offset where e + v carries, where e is
+ * the (wrapped) exclusive and v the element.  With AVX2 two vectors of
+ * 32-bit lengths are scanned in registers, the running total is added in
+ * and the vectors are only stored if no lane carried, so out may be the
+ * lengths array itself.  A vector that carried is redone with sop_uadd to
+ * stop at the failing element.  Narrower vectors or 64-bit lanes have too
+ * few lanes to beat the scalar chain, a single add and branch per element,
+ * so it is used as is for them.
+ */
+#if defined(SOP_AVX2)
+/* Scans each 128-bit half, then carries the low half's total into the
+ * high half. */
+#define _SOP_SCAN_PREFIX(_x) \
+  _x = _mm256_add_epi32(_x, _mm256_slli_si256(_x, 4)); \
+  _x = _mm256_add_epi32(_x, _mm256_slli_si256(_x, 8)); \
+  _x = _mm256_add_epi32(_x, _mm256_permute2x128_si256( \
+           _mm256_shuffle_epi32(_x, 0xff), _x, 0x08));
+#define _SOP_SCAN_LAST(_x) \
+  _mm256_permutevar8x32_epi32(_x, _mm256_set1_epi32(7))
+#define _SOP_SCAN_CARRY(_e, _v, _y) \
+  _mm256_or_si256(_mm256_and_si256(_e, _v), \
+                  _mm256_andnot_si256(_y, _mm256_or_si256(_e, _v)))
+
+#define _SOP_SCAN_VECTOR_32(_type) \
+  { \
+    const size_t lanes = sizeof(__m256i) / sizeof(_type); \
+    _type w[sizeof(__m256i) / sizeof(_type)]; \
+    __m256i carry = _mm256_set1_epi32((int) total); \
+    for (; i + 2 * lanes <= n; i += 2 * lanes) { \
+      __m256i v0 = _mm256_loadu_si256((const __m256i *) (lengths + i)); \
+      __m256i v1 = _mm256_loadu_si256( \
+          (const __m256i *) (lengths + i + lanes)); \
+      __m256i y0 = v0, y1 = v1, e0, e1; \
+      _SOP_SCAN_PREFIX(y0) \
+      _SOP_SCAN_PREFIX(y1) \
+      y0 = _mm256_add_epi32(y0, carry); \
+      y1 = _mm256_add_epi32(y1, _SOP_SCAN_LAST(y0)); \
+      e0 = _mm256_sub_epi32(y0, v0); \
+      e1 = _mm256_sub_epi32(y1, v1); \
+      if (_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_or_si256( \
+              _SOP_SCAN_CARRY(e0, v0, y0), _SOP_SCAN_CARRY(e1, v1, y1))))) \
+        break; \
+      _mm256_storeu_si256((__m256i *) (out + i), e0); \
+      _mm256_storeu_si256((__m256i *) (out + i + lanes), e1); \
+      carry = _SOP_SCAN_LAST(y1); \
+    } \
+    _mm256_storeu_si256((__m256i *) w, carry); \
+    total = w[0]; \
+  }
+#else
+#define _SOP_SCAN_VECTOR_32(_type)
+#endif
+#define _SOP_SCAN_VECTOR_64(_type)
+
+/* _sop_exclusive_scan_<type>_from starts the offsets at total. */
+#define _SOP_SCAN(_m, _type, _bits) \
+  static int _sop_exclusive_scan_##_m##_from(_type *out, \
+                                             const _type *lengths, size_t n, \
+                                             _type total) { \
+    _type len; \
+    size_t i = 0; \
+    _SOP_SCAN_VECTOR_##_bits(_type) \
+    for (; i < n; ++i) { \
+      len = lengths[i]; \
+      out[i] = total; \
+      if (!sop_uadd(0, _type, &total, 0, _type, total, 0, _type, len)) \
+        return 0; \
+    } \
+    return 1; \
+  } \
+  int _SOP_FN(sop_exclusive_scan_##_m)(_type *out, const _type *lengths, \
+                                       size_t n) { \
+    return _sop_exclusive_scan_##_m##_from(out, lengths, n, 0); \
+  }
+
+_SOP_SCAN(u32, uint32_t, 32)
+_SOP_SCAN(u64, uint64_t, 64)
+#if SIZE_MAX == UINT64_MAX
+_SOP_SCAN(size_t, size_t, 64)
+#else
+_SOP_SCAN(size_t, size_t, 32)
+#endif
+
+/* Grouped sums
+ * sop_group_sum_u64 adds each value into its group's slot of out.  Values
+ * are never negative, so a slot's serial sop_uadd chain first fails exactly
+ * where an add carries out of 64 bits.  Rows are taken a block at a time
+ * and every value is added unchecked, with the carries counted as a high
+ * word shared by the whole block (a single adc on x86).  Only the key is
+ * tested per row, as it indexes out.  A block that carried is confirmed
+ * afterwards: its adds are undone in reverse (wrapping adds invert exactly
+ * whatever the order of repeated keys) and it is replayed with sop_uadd to
+ * stop at the failing row.
+ */
+#define SOP_GROUP_BLOCK 256
+
+int _SOP_FN(sop_group_sum_u64)(const uint32_t *keys, const uint64_t *values,
+                               size_t n, uint64_t *out, size_t ngroups,
+                               size_t *fail_index) {
+  size_t start, end = 0, i;
+  uint64_t sum, carry;
+  int bad = 0;
+  for (start = 0; start < n && !bad; start = end) {
+    end = (n - start > SOP_GROUP_BLOCK) ? start + SOP_GROUP_BLOCK : n;
+    for (i = start, carry = 0; i < end; ++i) {
+      /* the rows before a bad key are still added */
+      if (keys[i] >= ngroups) {
+        end = i;
+        bad = 1;
+        break;
+      }
+      sum = out[keys[i]] + values[i];
+      carry += (sum < values[i]);
+      out[keys[i]] = sum;
+    }
+    if (carry) {
+      for (i = end; i > start; --i)
+        out[keys[i - 1]] -= values[i - 1];
+      for (i = start; sop_uadd(0, uint64_t, &out[keys[i]], 0, uint64_t,
+                               out[keys[i]], 0, uint64_t, values[i]); ++i)
+        ;
+      if (fail_index)
+        *fail_index = i;
+      return 0;
+    }
+  }
+  if (bad && fail_index)
+    *fail_index = end;
+  return !bad;
+}
+
+/* Parallel reductions
+ * sop_parallel_sum_<type> and sop_parallel_exclusive_scan_<type> split large
+ * arrays into chunks shared out among threads.  Each thread summarizes its
+ * chunks in 128 bits: the exact sum and, for signed sums, bounds on every
+ * running total inside the chunk relative to its start (taken per
+ * SOP_SUM_BLOCK block as sop_sum does).  The calling thread then combines
+ * the chunks in order, so every chunk's starting total is exact and the
+ * result is the one the serial sop_add chain gives however the array was
+ * split.  A signed chunk whose bounds leave the type from its starting
+ * total is replayed from there with sop_sadd.  Scans sum their chunks
+ * first and then scan each chunk from its starting offset.
+ */
+#define SOP_PARALLEL_GRAIN ((size_t) 1 << 20)
+#define SOP_PARALLEL_MAX_THREADS 64
+#define SOP_PARALLEL_MAX_CHUNK ((size_t) 1 << 30)
+
+static unsigned int _sop_par_threads = 0;
+static size_t _sop_par_grain = SOP_PARALLEL_GRAIN;
+
+void _SOP_FN(sop_parallel_set)(unsigned int threads, size_t grain) {
+  _sop_par_threads = threads;
+  _sop_par_grain = grain ? grain : SOP_PARALLEL_GRAIN;
+}
+
+#if defined(__SIZEOF_INT128__)
+typedef struct {
+  int ok;
+  int replay;
+  __int128 sum, lo, hi, start;
+} _sop_par_part_t;
+
+typedef struct _sop_par_job {
+  void (*chunk)(struct _sop_par_job *job, size_t k, size_t start, size_t end);
+  const void *in;
+  void *out;
+  size_t n, chunk_len, nchunks;
+  unsigned int workers;
+  _sop_par_part_t *parts;
+} _sop_par_job_t;
+
+typedef struct {
+  _sop_par_job_t *job;
+  unsigned int index;
+} _sop_par_worker_t;
+
+static void *_sop_par_worker(void *arg) {
+  _sop_par_worker_t *worker = (_sop_par_worker_t *) arg;
+  _sop_par_job_t *job = worker->job;
+  size_t k, start;
+  for (k = worker->index; k < job->nchunks; k += job->workers) {
+    start = k * job->chunk_len;
+    job->chunk(job, k, start, (job->n - start > job->chunk_len) ?
+                              start + job->chunk_len : job->n);
+  }
+  return NULL;
+}
+
+/* Runs job->chunk over every chunk, worker i taking chunks i, i + workers,
+ * ...  The calling thread is worker 0, and the chunks of any thread that
+ * cannot be started are run on the calling thread too. */
+static void _sop_par_run(_sop_par_job_t *job) {
+  pthread_t threads[SOP_PARALLEL_MAX_THREADS];
+  _sop_par_worker_t workers[SOP_PARALLEL_MAX_THREADS];
+  int started[SOP_PARALLEL_MAX_THREADS];
+  unsigned int i;
+  for (i = 0; i < job->workers; ++i) {
+    workers[i].job = job;
+    workers[i].index = i;
+    started[i] = i > 0 && pthread_create(&threads[i], NULL, _sop_par_worker,
+                                         &workers[i]) == 0;
+  }
+  _sop_par_worker(&workers[0]);
+  for (i = 1; i < job->workers; ++i) {
+    if (started[i])
+      pthread_join(threads[i], NULL);
+    else
+      _sop_par_worker(&workers[i]);
+  }
+}
+
+/* Splits n elements into chunks of at least the grain per thread.  Returns
+ * 0 if that leaves a single chunk, or the chunk table cannot be allocated,
+ * in which case the caller does the work serially. */
+static int _sop_par_plan(_sop_par_job_t *job, size_t n) {
+  unsigned int threads = _sop_par_threads;
+  size_t chunk_len;
+  if (threads == 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? (unsigned int) cpus : 1;
+  }
+  if (threads > SOP_PARALLEL_MAX_THREADS)
+    threads = SOP_PARALLEL_MAX_THREADS;
+  if (threads < 2 || n / 2 < _sop_par_grain)
+    return 0;
+  chunk_len = n / threads + (n % threads != 0);
+  if (chunk_len < _sop_par_grain)
+    chunk_len = _sop_par_grain;
+  if (chunk_len > SOP_PARALLEL_MAX_CHUNK)
+    chunk_len = SOP_PARALLEL_MAX_CHUNK;
+  job->n = n;
+  job->chunk_len = chunk_len;
+  job->nchunks = n / chunk_len + (n % chunk_len != 0);
+  job->workers = job->nchunks < threads ? (unsigned int) job->nchunks
+                                        : threads;
+  job->parts = (_sop_par_part_t *) calloc(job->nchunks,
+                                          sizeof(_sop_par_part_t));
+  return job->parts != NULL;
+}
+
+/* Chunk summaries.  An unsigned chunk's running totals only grow, so its
+ * sum bounds them; one that overflows the type on its own fails the whole
+ * sum.  Signed chunks are bounded block by block. */
+#define _SOP_PAR_SUM_CHUNK_u(_m, _type) \
+  static void _sop_par_sum_chunk_##_m(_sop_par_job_t *job, size_t k, \
+                                      size_t start, size_t end) { \
+    _sop_par_part_t *part = &job->parts[k]; \
+    _type sum = 0; \
+    part->ok = _SOP_FN(sop_sum_##_m)(&sum, (const _type *) job->in + start, \
+                                     end - start); \
+    part->sum = part->hi = sum; \
+  }
+
+#define _SOP_PAR_SUM_CHUNK_s(_m, _type) \
+  static void _sop_par_sum_chunk_##_m(_sop_par_job_t *job, size_t k, \
+                                      size_t start, size_t end) { \
+    const _type *a = (const _type *) job->in; \
+    _sop_par_part_t *part = &job->parts[k]; \
+    int64_t bpos, bneg; \
+    size_t i; \
+    for (i = start; i < end; i += SOP_SUM_BLOCK) { \
+      const size_t len = (end - i > SOP_SUM_BLOCK) ? SOP_SUM_BLOCK : end - i; \
+      _sop_sum_block_##_m(a + i, len, &bpos, &bneg); \
+      if (part->sum + bpos > part->hi) \
+        part->hi = part->sum + bpos; \
+      if (part->sum + bneg < part->lo) \
+        part->lo = part->sum + bneg; \
+      part->sum += bpos + bneg; \
+    } \
+    part->ok = 1; \
+  }
+
+_SOP_PAR_SUM_CHUNK_u(u8, uint8_t)
+_SOP_PAR_SUM_CHUNK_s(s8, int8_t)
+_SOP_PAR_SUM_CHUNK_u(u16, uint16_t)
+_SOP_PAR_SUM_CHUNK_s(s16, int16_t)
+_SOP_PAR_SUM_CHUNK_u(u32, uint32_t)
+_SOP_PAR_SUM_CHUNK_s(s32, int32_t)
+_SOP_PAR_SUM_CHUNK_u(u64, uint64_t)
+
+/* Blocks with too loose a bound are walked element by element. */
+static void _sop_par_sum_chunk_s64(_sop_par_job_t *job, size_t k,
+                                   size_t start, size_t end) {
+  const int64_t *a = (const int64_t *) job->in;
+  _sop_par_part_t *part = &job->parts[k];
+  int64_t sum;
+  uint64_t bound;
+  size_t i, j;
+  for (i = start; i < end; i += SOP_SUM_BLOCK) {
+    const size_t len = (end - i > SOP_SUM_BLOCK) ? SOP_SUM_BLOCK : end - i;
+    if (_sop_sum_s64_block(a + i, len, &sum, &bound)) {
+      if (part->sum + bound > part->hi)
+        part->hi = part->sum + bound;
+      if (part->sum - bound < part->lo)
+        part->lo = part->sum - bound;
+      part->sum += sum;
+      continue;
+    }
+    for (j = i; j < i + len; ++j) {
+      part->sum += a[j];
+      if (part->sum > part->hi)
+        part->hi = part->sum;
+      if (part->sum < part->lo)
+        part->lo = part->sum;
+    }
+  }
+  part->ok = 1;
+}
+
+#define _SOP_PAR_SUM(_m, _type, _s, _sign, _min, _max) \
+  static void _sop_par_replay_##_m(_sop_par_job_t *job, size_t k, \
+                                   size_t start, size_t end) { \
+    const _type *a = (const _type *) job->in; \
+    _sop_par_part_t *part = &job->parts[k]; \
+    _type total = (_type) part->start; \
+    size_t i; \
+    if (!part->replay) \
+      return; \
+    for (i = start; i < end && part->ok; ++i) \
+      part->ok = sop_##_s##add(_sign, _type, &total, _sign, _type, total, \
+                               _sign, _type, a[i]); \
+  } \
+  int _SOP_FN(sop_parallel_sum_##_m)(_type *result, const _type *a, \
+                                     size_t n) { \
+    _sop_par_job_t job; \
+    __int128 total = 0; \
+    size_t k, replays = 0; \
+    int ok = 1; \
+    if (!_sop_par_plan(&job, n)) \
+      return _SOP_FN(sop_sum_##_m)(result, a, n); \
+    job.chunk = _sop_par_sum_chunk_##_m; \
+    job.in = a; \
+    _sop_par_run(&job); \
+    for (k = 0; k < job.nchunks && ok; ++k) { \
+      _sop_par_part_t *part = &job.parts[k]; \
+      if (total + part->lo < (_min) || total + part->hi > (_max)) { \
+        part->replay = 1; \
+        part->start = total; \
+        ++replays; \
+      } \
+      total += part->sum; \
+      ok = part->ok && total >= (_min) && total <= (_max); \
+    } \
+    if (ok && replays) { \
+      job.chunk = _sop_par_replay_##_m; \
+      _sop_par_run(&job); \
+      for (k = 0; k < job.nchunks; ++k) \
+        ok &= job.parts[k].ok; \
+    } \
+    free(job.parts); \
+    if (ok && result) \
+      *result = (_type) total; \
+    return ok; \
+  }
+
+_SOP_PAR_SUM(u8, uint8_t, u, 0, 0, UINT8_MAX)
+_SOP_PAR_SUM(s8, int8_t, s, 1, INT8_MIN, INT8_MAX)
+_SOP_PAR_SUM(u16, uint16_t, u, 0, 0, UINT16_MAX)
+_SOP_PAR_SUM(s16, int16_t, s, 1, INT16_MIN, INT16_MAX)
+_SOP_PAR_SUM(u32, uint32_t, u, 0, 0, UINT32_MAX)
+_SOP_PAR_SUM(s32, int32_t, s, 1, INT32_MIN, INT32_MAX)
+_SOP_PAR_SUM(u64, uint64_t, u, 0, 0, UINT64_MAX)
+_SOP_PAR_SUM(s64, int64_t, s, 1, INT64_MIN, INT64_MAX)
+
+/* A scan whose total overflows is redone serially so that exactly the
+ * offsets that fit are written. */
+#define _SOP_PAR_SCAN(_m, _type, _max) \
+  static void _sop_par_scan_sum_##_m(_sop_par_job_t *job, size_t k, \
+                                     size_t start, size_t end) { \
+    const _type *lengths = (const _type *) job->in; \
+    unsigned __int128 sum0 = 0, sum1 = 0; \
+    size_t i; \
+    for (i = start; i + 2 <= end; i += 2) { \
+      sum0 += lengths[i]; \
+      sum1 += lengths[i + 1]; \
+    } \
+    if (i < end) \
+      sum0 += lengths[i]; \
+    job->parts[k].sum = (__int128) (sum0 + sum1); \
+  } \
+  static void _sop_par_scan_chunk_##_m(_sop_par_job_t *job, size_t k, \
+                                       size_t start, size_t end) { \
+    _sop_exclusive_scan_##_m##_from((_type *) job->out + start, \
+                                    (const _type *) job->in + start, \
+                                    end - start, (_type) job->parts[k].start); \
+  } \
+  int _SOP_FN(sop_parallel_exclusive_scan_##_m)(_type *out, \
+                                                const _type *lengths, \
+                                                size_t n) { \
+    _sop_par_job_t job; \
+    __int128 total = 0; \
+    size_t k; \
+    if (!_sop_par_plan(&job, n)) \
+      return _SOP_FN(sop_exclusive_scan_##_m)(out, lengths, n); \
+    job.chunk = _sop_par_scan_sum_##_m; \
+    job.in = lengths; \
+    job.out = out; \
+    _sop_par_run(&job); \
+    for (k = 0; k < job.nchunks && total <= (_max); ++k) { \
+      job.parts[k].start = total; \
+      total += job.parts[k].sum; \
+    } \
+    if (total > (_max)) { \
+      free(job.parts); \
+      return _SOP_FN(sop_exclusive_scan_##_m)(out, lengths, n); \
+    } \
+    job.chunk = _sop_par_scan_chunk_##_m; \
+    _sop_par_run(&job); \
+    free(job.parts); \
+    return 1; \
+  }
+
+_SOP_PAR_SCAN(u32, uint32_t, UINT32_MAX)
+_SOP_PAR_SCAN(u64, uint64_t, UINT64_MAX)
+_SOP_PAR_SCAN(size_t, size_t, SIZE_MAX)
+
+#else
+
+/* Without a 128-bit type the chunks cannot be summarized exactly, so
+ * everything runs on the calling thread. */
+#define _SOP_PAR_SUM(_m, _type) \
+  int _SOP_FN(sop_parallel_sum_##_m)(_type *result, const _type *a, \
+                                     size_t n) { \
+    return _SOP_FN(sop_sum_##_m)(result, a, n); \
+  }
+#define _SOP_PAR_SCAN(_m, _type) \
+  int _SOP_FN(sop_parallel_exclusive_scan_##_m)(_type *out, \
+                                                const _type *lengths, \
+                                                size_t n) { \
+    return _SOP_FN(sop_exclusive_scan_##_m)(out, lengths, n); \
+  }
+
+_SOP_PAR_SUM(u8, uint8_t)
+_SOP_PAR_SUM(s8, int8_t)
+_SOP_PAR_SUM(u16, uint16_t)
+_SOP_PAR_SUM(s16, int16_t)
+_SOP_PAR_SUM(u32, uint32_t)
+_SOP_PAR_SUM(s32, int32_t)
+_SOP_PAR_SUM(u64, uint64_t)
+_SOP_PAR_SUM(s64, int64_t)
+_SOP_PAR_SCAN(u32, uint32_t)
+_SOP_PAR_SCAN(u64, uint64_t)
+_SOP_PAR_SCAN(size_t, size_t)
+
+#endif
+
+/* Narrowing
+ * Every range sop_safe_cast accepts is [min, max] where max + 1 is a power
+ * of two and min is 0 or -(max + 1).  So, in the unsigned source lane type,
+ * a value fits exactly when (v + bias) >> k is zero:
+ *  signed to signed:     bias = 2^(dst bits - 1), k = dst bits
+ *  unsigned to signed:   bias = 0, k = dst bits - 1
+ *  unsigned to unsigned: bias = 0, k = dst bits
+ *  signed to unsigned:   bias = 0, k = the smaller of dst bits and
+ *                        src bits - 1, which rejects negatives either way
+ * Since the test is just for high bits, the biased values of a whole block
+ * are OR-ed together and checked once.  A block which passes is then
+ * converted while it is still in cache; one which fails is redone with
+ * sop_safe_cast.  SSE2 spills 32-byte vectors that are carried around a
+ * loop, so the vectors here are only as wide as the registers.
+ */
+/* Element by element, for the tail and any block out of range */
+#define _SOP_NARROW_TAIL(_stype, _ssign, _dtype, _dsign) \
+    for (j = i; j < n; ++j) { \
+      if (!sop_safe_cast(_dsign, _dtype, 0, _ssign, _stype, src[j])) { \
+        if (fail_index) \
+          *fail_index = j; \
+        return 0; \
+      } \
+      if (dst) \
+        dst[j] = (_dtype) src[j]; \
+    } \
+    return 1;
+
+#if defined(SOP_VECTOR)
+#define SOP_NARROW_BLOCK 256
+#if defined(SOP_AVX2)
+#define SOP_NARROW_BYTES 32
+#else
+#define SOP_NARROW_BYTES 16
+#endif
+#define SOP_NARROW_LANES 16
+
+typedef uint8_t sop_v_n8_t __attribute__((vector_size(SOP_NARROW_LANES)));
+typedef uint16_t sop_v_n16_t
+  __attribute__((vector_size(SOP_NARROW_LANES * 2)));
+typedef uint32_t sop_v_n32_t
+  __attribute__((vector_size(SOP_NARROW_LANES * 4)));
+typedef uint64_t sop_v_n64_t
+  __attribute__((vector_size(SOP_NARROW_LANES * 8)));
+
+/* Converts SOP_NARROW_LANES elements which are known to fit.  Truncating
+ * is then exact, as is zero extension since only non-negative values are
+ * ever widened.  Going one width at a time keeps every step a single pack
+ * or unpack; converting 64 to 8 bits directly is done lane by lane.  The
+ * packs do not cross 128-bit halves, so this stays at 16 elements even when
+ * wider registers are available.  The sizes are constants, so all but one
+ * path folds away.
+ */
+static inline void _sop_narrow_convert(void *dst, size_t dsize,
+                                       const void *src, size_t ssize) {
+  sop_v_n8_t v8 = {0};
+  sop_v_n16_t v16 = {0};
+  sop_v_n32_t v32 = {0};
+  sop_v_n64_t v64 = {0};
+  switch (ssize) {
+    case 1: memcpy(&v8, src, sizeof(v8)); break;
+    case 2: memcpy(&v16, src, sizeof(v16)); break;
+    case 4: memcpy(&v32, src, sizeof(v32)); break;
+    default: memcpy(&v64, src, sizeof(v64)); break;
+  }
+  if (ssize > dsize) {
+    if (ssize == 8)
+      v32 = __builtin_convertvector(v64, sop_v_n32_t);
+    if (ssize >= 4 && dsize <= 2)
+      v16 = __builtin_convertvector(v32, sop_v_n16_t);
+    if (dsize == 1)
+      v8 = __builtin_convertvector(v16, sop_v_n8_t);
+  } else if (ssize < dsize) {
+    if (ssize == 1)
+      v16 = __builtin_convertvector(v8, sop_v_n16_t);
+    if (ssize <= 2 && dsize >= 4)
+      v32 = __builtin_convertvector(v16, sop_v_n32_t);
+    if (dsize == 8)
+      v64 = __builtin_convertvector(v32, sop_v_n64_t);
+  }
+  switch (dsize) {
+    case 1: memcpy(dst, &v8, sizeof(v8)); break;
+    case 2: memcpy(dst, &v16, sizeof(v16)); break;
+    case 4: memcpy(dst, &v32, sizeof(v32)); break;
+    default: memcpy(dst, &v64, sizeof(v64)); break;
+  }
+}
+
+#define _SOP_NARROW(_sm, _stype, _ssign, _dm, _dtype, _dsign) \
+  int _SOP_FN(sop_narrow_array_##_sm##_to_##_dm)(_dtype *dst, \
+                                                 const _stype *src, size_t n, \
+                                                 size_t *fail_index) { \
+    typedef __typeof__((sop_v_##_sm##_u_t) {0}[0]) _sop_su_t; \
+    typedef _sop_su_t _sop_sv_t \
+      __attribute__((vector_size(SOP_NARROW_BYTES))); \
+    const unsigned int sbits = sizeof(_stype) * CHAR_BIT; \
+    const unsigned int dbits = sizeof(_dtype) * CHAR_BIT; \
+    const unsigned int k = _dsign ? (_ssign ? dbits : dbits - 1) : \
+                           (_ssign && dbits >= sbits ? sbits - 1 : dbits); \
+    const size_t lanes = SOP_NARROW_LANES; \
+    /* blocks cover whole OR steps and whole conversions */ \
+    const size_t step = SOP_NARROW_BYTES / sizeof(_stype) > lanes ? \
+                        SOP_NARROW_BYTES / sizeof(_stype) : lanes; \
+    const _sop_su_t bias = \
+      (_sop_su_t) (_ssign && _dsign ? 1ULL << (dbits - 1) : 0); \
+    size_t i = 0, j; \
+    while (i + step <= n) { \
+      size_t end = n - (n - i) % step; \
+      _sop_sv_t acc = {0}, v; \
+      _sop_su_t bad[SOP_NARROW_BYTES / sizeof(_stype)]; \
+      _sop_su_t any = 0; \
+      if (end - i > SOP_NARROW_BLOCK) \
+        end = i + SOP_NARROW_BLOCK; \
+      for (j = i; j < end; j += SOP_NARROW_BYTES / sizeof(_stype)) { \
+        memcpy(&v, src + j, sizeof(v)); \
+        acc |= v + bias; \
+      } \
+      acc >>= k; \
+      memcpy(bad, &acc, sizeof(bad)); \
+      for (j = 0; j < sizeof(bad) / sizeof(bad[0]); ++j) \
+        any |= bad[j]; \
+      if (any) \
+        break; \
+      if (dst) { \
+        for (j = i; j < end; j += lanes) \
+          _sop_narrow_convert(dst + j, sizeof(_dtype), \
+                              src + j, sizeof(_stype)); \
+      } \
+      i = end; \
+    } \
+    _SOP_NARROW_TAIL(_stype, _ssign, _dtype, _dsign) \
+  }
+#else
+#define _SOP_NARROW(_sm, _stype, _ssign, _dm, _dtype, _dsign) \
+  int _SOP_FN(sop_narrow_array_##_sm##_to_##_dm)(_dtype *dst, \
+                                                 const _stype *src, size_t n, \
+                                                 size_t *fail_index) { \
+    size_t i = 0, j; \
+    _SOP_NARROW_TAIL(_stype, _ssign, _dtype, _dsign) \
+  }
+#endif
+
+_SOP_NARROW(u8, uint8_t, 0, s8, int8_t, 1)
+_SOP_NARROW(s8, int8_t, 1, u8, uint8_t, 0)
+_SOP_NARROW(s8, int8_t, 1, u16, uint16_t, 0)
+_SOP_NARROW(s8, int8_t, 1, u32, uint32_t, 0)
+_SOP_NARROW(s8, int8_t, 1, u64, uint64_t, 0)
+_SOP_NARROW(u16, uint16_t, 0, u8, uint8_t, 0)
+_SOP_NARROW(u16, uint16_t, 0, s8, int8_t, 1)
+_SOP_NARROW(u16, uint16_t, 0, s16, int16_t, 1)
+_SOP_NARROW(s16, int16_t, 1, u8, uint8_t, 0)
+_SOP_NARROW(s16, int16_t, 1, s8, int8_t, 1)
+_SOP_NARROW(s16, int16_t, 1, u16, uint16_t, 0)
+_SOP_NARROW(s16, int16_t, 1, u32, uint32_t, 0)
+_SOP_NARROW(s16, int16_t, 1, u64, uint64_t, 0)
+_SOP_NARROW(u32, uint32_t, 0, u8, uint8_t, 0)
+_SOP_NARROW(u32, uint32_t, 0, s8, int8_t, 1)
+_SOP_NARROW(u32, uint32_t, 0, u16, uint16_t, 0)
+_SOP_NARROW(u32, uint32_t, 0, s16, int16_t, 1)
+_SOP_NARROW(u32, uint32_t, 0, s32, int32_t, 1)
+_SOP_NARROW(s32, int32_t, 1, u8, uint8_t, 0)
+_SOP_NARROW(s32, int32_t, 1, s8, int8_t, 1)
+_SOP_NARROW(s32, int32_t, 1, u16, uint16_t, 0)
+_SOP_NARROW(s32, int32_t, 1, s16, int16_t, 1)
+_SOP_NARROW(s32, int32_t, 1, u32, uint32_t, 0)
+_SOP_NARROW(s32, int32_t, 1, u64, uint64_t, 0)
+_SOP_NARROW(u64, uint64_t, 0, u8, uint8_t, 0)
+_SOP_NARROW(u64, uint64_t, 0, s8, int8_t, 1)
+_SOP_NARROW(u64, uint64_t, 0, u16, uint16_t, 0)
+_SOP_NARROW(u64, uint64_t, 0, s16, int16_t, 1)
+_SOP_NARROW(u64, uint64_t, 0, u32, uint32_t, 0)
+_SOP_NARROW(u64, uint64_t, 0, s32, int32_t, 1)
+_SOP_NARROW(u64, uint64_t, 0, s64, int64_t, 1)
+_SOP_NARROW(s64, int64_t, 1, u8, uint8_t, 0)
+_SOP_NARROW(s64, int64_t, 1, s8, int8_t, 1)
+_SOP_NARROW(s64, int64_t, 1, u16, uint16_t, 0)
+_SOP_NARROW(s64, int64_t, 1, s16, int16_t, 1)
+_SOP_NARROW(s64, int64_t, 1, u32, uint32_t, 0)
+_SOP_NARROW(s64, int64_t, 1, s32, int32_t, 1)
+_SOP_NARROW(s64, int64_t, 1, u64, uint64_t, 0)
+
+/* Saturation
+ * sop_<op>_sat_array_<type> clamps each result to the type's range instead
+ * of failing and returns how many elements were clamped.  x86 has native
+ * saturating adds and subtracts for 8- and 16-bit lanes.  An element was
+ * clamped exactly when the saturated result differs from the wrapped one,
+ * since a wrapped sum or difference never lands on the limit it passed.
+ * There is no saturating multiply, so products are formed exactly (pmulhw
+ * gives the high halves of 16-bit products, 8-bit lanes are widened to 16)
+ * and clamped with compares or the saturating packs.
+ *
+ * Each vector step leaves a lane mask of the elements that were not
+ * clamped.  Those are counted in per-lane counters, which are added up
+ * before they can wrap.
+ */
+#define _SOP_SAT_ARITH_add(_a, _b) ((_a) + (_b))
+#define _SOP_SAT_ARITH_sub(_a, _b) ((_a) - (_b))
+#define _SOP_SAT_ARITH_mul(_a, _b) ((_a) * (_b))
+
+#if defined(SOP_AVX2) || defined(SOP_SSE2)
+#if defined(SOP_AVX2)
+typedef __m256i sop_v_sat_t;
+#define _SOP_SAT_MM(_f) _mm256_##_f
+#define _SOP_SAT_SI(_f) _mm256_##_f##_si256
+#else
+typedef __m128i sop_v_sat_t;
+#define _SOP_SAT_MM(_f) _mm_##_f
+#define _SOP_SAT_SI(_f) _mm_##_f##_si128
+#endif
+
+/* Adds and subtracts: _e is the saturating lane type, _w the lane width */
+#define _SOP_SAT_STEP_add(_e, _w, _va, _vb, _r, _ok) \
+  _r = _SOP_SAT_MM(adds_##_e)(_va, _vb); \
+  _ok = _SOP_SAT_MM(cmpeq_##_w)(_r, _SOP_SAT_MM(add_##_w)(_va, _vb));
+#define _SOP_SAT_STEP_sub(_e, _w, _va, _vb, _r, _ok) \
+  _r = _SOP_SAT_MM(subs_##_e)(_va, _vb); \
+  _ok = _SOP_SAT_MM(cmpeq_##_w)(_r, _SOP_SAT_MM(sub_##_w)(_va, _vb));
+
+/* 16-bit products fit if the high half is zero (unsigned) or the sign
+ * extension of the low half (signed).  A signed product is clamped towards
+ * the sign of a ^ b. */
+#define _SOP_SAT_STEP_mul_epu16(_va, _vb, _r, _ok) { \
+    sop_v_sat_t _lo = _SOP_SAT_MM(mullo_epi16)(_va, _vb); \
+    sop_v_sat_t _hi = _SOP_SAT_MM(mulhi_epu16)(_va, _vb); \
+    _ok = _SOP_SAT_MM(cmpeq_epi16)(_hi, _SOP_SAT_SI(setzero)()); \
+    _r = _SOP_SAT_SI(or)(_lo, _SOP_SAT_SI(andnot)(_ok, \
+           _SOP_SAT_MM(set1_epi16)(-1))); \
+  }
+#define _SOP_SAT_STEP_mul_epi16(_va, _vb, _r, _ok) { \
+    sop_v_sat_t _lo = _SOP_SAT_MM(mullo_epi16)(_va, _vb); \
+    sop_v_sat_t _hi = _SOP_SAT_MM(mulhi_epi16)(_va, _vb); \
+    sop_v_sat_t _sat = _SOP_SAT_SI(xor)(_SOP_SAT_MM(set1_epi16)(INT16_MAX), \
+      _SOP_SAT_MM(srai_epi16)(_SOP_SAT_SI(xor)(_va, _vb), 15)); \
+    _ok = _SOP_SAT_MM(cmpeq_epi16)(_hi, _SOP_SAT_MM(srai_epi16)(_lo, 15)); \
+    _r = _SOP_SAT_SI(or)(_SOP_SAT_SI(and)(_ok, _lo), \
+                         _SOP_SAT_SI(andnot)(_ok, _sat)); \
+  }
+
+/* 8-bit lanes are unpacked to 16 bits and packed back, which keeps their
+ * order even though AVX2 unpacks and packs within 128-bit halves.  Unsigned
+ * products are clamped to 255 first since packuswb reads signed words;
+ * signed products are clamped by packsswb itself. */
+#define _SOP_SAT_STEP_mul_epu8(_va, _vb, _r, _ok) { \
+    const sop_v_sat_t _z = _SOP_SAT_SI(setzero)(); \
+    const sop_v_sat_t _max = _SOP_SAT_MM(set1_epi16)(UINT8_MAX); \
+    sop_v_sat_t _pl = _SOP_SAT_MM(mullo_epi16)( \
+      _SOP_SAT_MM(unpacklo_epi8)(_va, _z), \
+      _SOP_SAT_MM(unpacklo_epi8)(_vb, _z)); \
+    sop_v_sat_t _ph = _SOP_SAT_MM(mullo_epi16)( \
+      _SOP_SAT_MM(unpackhi_epi8)(_va, _z), \
+      _SOP_SAT_MM(unpackhi_epi8)(_vb, _z)); \
+    sop_v_sat_t _xl = _SOP_SAT_MM(subs_epu16)(_pl, _max); \
+    sop_v_sat_t _xh = _SOP_SAT_MM(subs_epu16)(_ph, _max); \
+    _r = _SOP_SAT_MM(packus_epi16)(_SOP_SAT_MM(sub_epi16)(_pl, _xl), \
+                                   _SOP_SAT_MM(sub_epi16)(_ph, _xh)); \
+    _ok = _SOP_SAT_MM(packs_epi16)(_SOP_SAT_MM(cmpeq_epi16)(_xl, _z), \
+                                   _SOP_SAT_MM(cmpeq_epi16)(_xh, _z)); \
+  }
+#define _SOP_SAT_STEP_mul_epi8(_va, _vb, _r, _ok) { \
+    sop_v_sat_t _pl = _SOP_SAT_MM(mullo_epi16)( \
+      _SOP_SAT_MM(srai_epi16)(_SOP_SAT_MM(unpacklo_epi8)(_va, _va), 8), \
+      _SOP_SAT_MM(srai_epi16)(_SOP_SAT_MM(unpacklo_epi8)(_vb, _vb), 8)); \
+    sop_v_sat_t _ph = _SOP_SAT_MM(mullo_epi16)( \
+      _SOP_SAT_MM(srai_epi16)(_SOP_SAT_MM(unpackhi_epi8)(_va, _va), 8), \
+      _SOP_SAT_MM(srai_epi16)(_SOP_SAT_MM(unpackhi_epi8)(_vb, _vb), 8)); \
+    _r = _SOP_SAT_MM(packs_epi16)(_pl, _ph); \
+    _ok = _SOP_SAT_MM(packs_epi16)( \
+      _SOP_SAT_MM(cmpeq_epi16)(_pl, _SOP_SAT_MM(srai_epi16)( \
+        _SOP_SAT_MM(slli_epi16)(_pl, 8), 8)), \
+      _SOP_SAT_MM(cmpeq_epi16)(_ph, _SOP_SAT_MM(srai_epi16)( \
+        _SOP_SAT_MM(slli_epi16)(_ph, 8), 8))); \
+  }
+#define _SOP_SAT_STEP_mul(_e, _w, _va, _vb, _r, _ok) \
+  _SOP_SAT_STEP_mul_##_e(_va, _vb, _r, _ok)
+
+/* Counters gain at most one per vector, so after UINT8_MAX vectors every
+ * counter still fits its low byte and the bytes can simply be added up. */
+#define _SOP_SAT_VECTOR(_op, _type, _e, _w) \
+    while (i + sizeof(sop_v_sat_t) / sizeof(_type) <= n) { \
+      const size_t lanes = sizeof(sop_v_sat_t) / sizeof(_type); \
+      sop_v_sat_t cnt = _SOP_SAT_SI(setzero)(); \
+      unsigned char part[sizeof(sop_v_sat_t)]; \
+      size_t start = i, end = i + lanes * UINT8_MAX, k, ok = 0; \
+      if (end > n - (n - i) % lanes) \
+        end = n - (n - i) % lanes; \
+      for (; i < end; i += lanes) { \
+        sop_v_sat_t va = _SOP_SAT_SI(loadu)((const sop_v_sat_t *) (a + i)); \
+        sop_v_sat_t vb = _SOP_SAT_SI(loadu)((const sop_v_sat_t *) (b + i)); \
+        sop_v_sat_t vr, vok; \
+        _SOP_SAT_STEP_##_op(_e, _w, va, vb, vr, vok) \
+        cnt = _SOP_SAT_MM(sub_##_w)(cnt, vok); \
+        if (dst) \
+          _SOP_SAT_SI(storeu)((sop_v_sat_t *) (dst + i), vr); \
+      } \
+      memcpy(part, &cnt, sizeof(part)); \
+      for (k = 0; k < sizeof(part); ++k) \
+        ok += part[k]; \
+      clamped += (end - start) - ok; \
+    }
+#else
+#define _SOP_SAT_VECTOR(_op, _type, _e, _w)
+#endif
+
+#define _SOP_SAT(_op, _m, _type, _e, _w, _min, _max) \
+  size_t _SOP_FN(sop_##_op##_sat_array_##_m)(_type *dst, const _type *a, \
+                                             const _type *b, size_t n) { \
+    size_t i = 0, clamped = 0; \
+    _SOP_SAT_VECTOR(_op, _type, _e, _w) \
+    for (; i < n; ++i) { \
+      int64_t v = _SOP_SAT_ARITH_##_op((int64_t) a[i], (int64_t) b[i]); \
+      if (v < (_min) || v > (_max)) { \
+        v = (v < (_min)) ? (_min) : (_max); \
+        ++clamped; \
+      } \
+      if (dst) \
+        dst[i] = (_type) v; \
+    } \
+    return clamped; \
+  }
+
+#define _SOP_SAT_DEFINE(_m, _type, _e, _w, _min, _max) \
+  _SOP_SAT(add, _m, _type, _e, _w, _min, _max) \
+  _SOP_SAT(sub, _m, _type, _e, _w, _min, _max) \
+  _SOP_SAT(mul, _m, _type, _e, _w, _min, _max)
+
+_SOP_SAT_DEFINE(u8, uint8_t, epu8, epi8, 0, UINT8_MAX)
+_SOP_SAT_DEFINE(s8, int8_t, epi8, epi8, INT8_MIN, INT8_MAX)
+_SOP_SAT_DEFINE(u16, uint16_t, epu16, epi16, 0, UINT16_MAX)
+_SOP_SAT_DEFINE(s16, int16_t, epi16, epi16, INT16_MIN, INT16_MAX)
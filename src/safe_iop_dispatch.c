@@ -0,0 +1,145 @@
+/* safe_iop_dispatch
+ * Author:: Will Drewry <redpig@dataspill.org>
+ * See safe_iop.h for more info.
+ *
+ * Copyright (c) 2007,2008 Will Drewry <redpig@dataspill.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <stdint.h>
+#include <sys/types.h>
+#include <safe_iop.h>
+
+/* Load time dispatch of the array kernels
+ * On x86-64 ELF systems the shared library carries src/safe_iop_array.c
+ * twice, built for SSE2 and AVX2 with SOP_ARRAY_VARIANT set to sse2 and
+ * avx2.  Each public kernel here is a GNU indirect function whose resolver
+ * runs once, when the dynamic linker binds the symbol, and returns the
+ * widest variant the CPU supports.  Calls then go straight to that variant
+ * with no further checks.  All variants give identical results; "make
+ * tests" runs the suite against each of them.
+ */
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__ELF__)
+
+/* Resolvers run before constructors, so the CPU model is set up here. */
+static int _sop_dispatch_isa(void) {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return 1;
+  return 0;
+}
+
+#define SOP_DISPATCH(_name) \
+  extern __typeof__(_name) _name##_sse2, _name##_avx2; \
+  static __typeof__(_name) *_sop_resolve_##_name(void) { \
+    switch (_sop_dispatch_isa()) { \
+    case 1: \
+      return _name##_avx2; \
+    default: \
+      return _name##_sse2; \
+    } \
+  } \
+  __typeof__(_name) _name __attribute__((ifunc("_sop_resolve_" #_name)));
+
+#define SOP_DISPATCH_INT(_name) \
+  SOP_DISPATCH(_name##_u8) \
+  SOP_DISPATCH(_name##_s8) \
+  SOP_DISPATCH(_name##_u16) \
+  SOP_DISPATCH(_name##_s16) \
+  SOP_DISPATCH(_name##_u32) \
+  SOP_DISPATCH(_name##_s32) \
+  SOP_DISPATCH(_name##_u64) \
+  SOP_DISPATCH(_name##_s64)
+
+#define SOP_DISPATCH_SAT(_name) \
+  SOP_DISPATCH(_name##_u8) \
+  SOP_DISPATCH(_name##_s8) \
+  SOP_DISPATCH(_name##_u16) \
+  SOP_DISPATCH(_name##_s16)
+
+#define SOP_DISPATCH_SCAN(_name) \
+  SOP_DISPATCH(_name##_u32) \
+  SOP_DISPATCH(_name##_u64) \
+  SOP_DISPATCH(_name##_size_t)
+
+SOP_DISPATCH_INT(sop_add_array)
+SOP_DISPATCH_INT(sop_sub_array)
+SOP_DISPATCH_INT(sop_mul_array)
+SOP_DISPATCH_INT(sop_sum)
+SOP_DISPATCH_INT(sop_parallel_sum)
+
+SOP_DISPATCH(sop_dot_s16)
+SOP_DISPATCH(sop_dot_s32)
+SOP_DISPATCH(sop_dot_u32)
+
+SOP_DISPATCH(sop_gemm_s16)
+SOP_DISPATCH(sop_gemm_s32)
+
+SOP_DISPATCH_SCAN(sop_exclusive_scan)
+SOP_DISPATCH_SCAN(sop_parallel_exclusive_scan)
+
+SOP_DISPATCH(sop_group_sum_u64)
+
+SOP_DISPATCH(sop_narrow_array_u8_to_s8)
+SOP_DISPATCH(sop_narrow_array_s8_to_u8)
+SOP_DISPATCH(sop_narrow_array_s8_to_u16)
+SOP_DISPATCH(sop_narrow_array_s8_to_u32)
+SOP_DISPATCH(sop_narrow_array_s8_to_u64)
+SOP_DISPATCH(sop_narrow_array_u16_to_u8)
+SOP_DISPATCH(sop_narrow_array_u16_to_s8)
+SOP_DISPATCH(sop_narrow_array_u16_to_s16)
+SOP_DISPATCH(sop_narrow_array_s16_to_u8)
+SOP_DISPATCH(sop_narrow_array_s16_to_s8)
+SOP_DISPATCH(sop_narrow_array_s16_to_u16)
+SOP_DISPATCH(sop_narrow_array_s16_to_u32)
+SOP_DISPATCH(sop_narrow_array_s16_to_u64)
+SOP_DISPATCH(sop_narrow_array_u32_to_u8)
+SOP_DISPATCH(sop_narrow_array_u32_to_s8)
+SOP_DISPATCH(sop_narrow_array_u32_to_u16)
+SOP_DISPATCH(sop_narrow_array_u32_to_s16)
+SOP_DISPATCH(sop_narrow_array_u32_to_s32)
+SOP_DISPATCH(sop_narrow_array_s32_to_u8)
+SOP_DISPATCH(sop_narrow_array_s32_to_s8)
+SOP_DISPATCH(sop_narrow_array_s32_to_u16)
+SOP_DISPATCH(sop_narrow_array_s32_to_s16)
+SOP_DISPATCH(sop_narrow_array_s32_to_u32)
+SOP_DISPATCH(sop_narrow_array_s32_to_u64)
+SOP_DISPATCH(sop_narrow_array_u64_to_u8)
+SOP_DISPATCH(sop_narrow_array_u64_to_s8)
+SOP_DISPATCH(sop_narrow_array_u64_to_u16)
+SOP_DISPATCH(sop_narrow_array_u64_to_s16)
+SOP_DISPATCH(sop_narrow_array_u64_to_u32)
+SOP_DISPATCH(sop_narrow_array_u64_to_s32)
+SOP_DISPATCH(sop_narrow_array_u64_to_s64)
+SOP_DISPATCH(sop_narrow_array_s64_to_u8)
+SOP_DISPATCH(sop_narrow_array_s64_to_s8)
+SOP_DISPATCH(sop_narrow_array_s64_to_u16)
+SOP_DISPATCH(sop_narrow_array_s64_to_s16)
+SOP_DISPATCH(sop_narrow_array_s64_to_u32)
+SOP_DISPATCH(sop_narrow_array_s64_to_s32)
+SOP_DISPATCH(sop_narrow_array_s64_to_u64)
+
+SOP_DISPATCH_SAT(sop_add_sat_array)
+SOP_DISPATCH_SAT(sop_sub_sat_array)
+SOP_DISPATCH_SAT(sop_mul_sat_array)
+
+/* Each variant keeps its own parallel settings, so all of them are set. */
+extern __typeof__(sop_parallel_set) sop_parallel_set_sse2,
+  sop_parallel_set_avx2;
+
+void sop_parallel_set(unsigned int threads, size_t grain) {
+  sop_parallel_set_sse2(threads, grain);
+  sop_parallel_set_avx2(threads, grain);
+}
+
+#endif
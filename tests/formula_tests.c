@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
+#include <safe_iop.h>
+#include "formulas.h"
+
+#define EXPECT_FALSE(cmd) { \
+  printf("%s:%d:%s: EXPECT_FALSE(" #cmd ") => ", __FILE__, __LINE__, __func__); \
+  if ((cmd) != 0) { printf(" FAILED\n"); expect_fail++; r = 0; } \
+  else { printf(" PASSED\n"); expect_succ++; } \
+  expect++; \
+  }
+#define EXPECT_TRUE(cmd) { \
+  printf("%s:%d:%s: EXPECT_TRUE(" #cmd ") => ", __FILE__, __LINE__, __func__); \
+  if ((cmd) != 1) { printf(" FAILED\n"); expect_fail++; r = 0; } \
+  else { printf(" PASSED\n"); expect_succ++; } \
+  expect++; \
+  }
+/* Not perfect, but good for basic debugging */
+#define EXPECT_EQUAL(lhs,rhs) { \
+  printf("%s:%d:%s: EXPECT_EQUAL(" #lhs " == " #rhs ") -> ", \
+         __FILE__, __LINE__, __func__); \
+  if ((lhs) != (rhs)) { printf(" FAILED\n"); expect_fail++; r = 0; } \
+  else { printf(" PASSED\n"); expect_succ++; } \
+  expect++; \
+  }
+
+static int expect = 0, expect_succ = 0, expect_fail = 0;
+
+/* Generated functions must agree with sopf on the same formulas */
+int T_formula_basic() {
+  int r=1;
+  uint64_t u64 = 0;
+  uint32_t u32 = 0;
+  int16_t s16 = 0;
+  int32_t s32 = 0;
+  EXPECT_TRUE(image_bytes(&u64, UINT_MAX, UINT_MAX, 1, 7));
+  EXPECT_EQUAL(u64, (uint64_t) UINT_MAX * UINT_MAX + 7);
+  EXPECT_FALSE(image_bytes(&u64, UINT_MAX, UINT_MAX, 2, 0));
+  EXPECT_EQUAL(u64, (uint64_t) UINT_MAX * UINT_MAX + 7);
+  EXPECT_TRUE(avg3(&u32, 3, 4, 5, 3));
+  EXPECT_EQUAL(u32, 4);
+  EXPECT_FALSE(avg3(&u32, UINT_MAX, 1, 0, 3));
+  EXPECT_FALSE(avg3(&u32, 3, 4, 5, 0));
+  /* precedence: a + (b / c) */
+  EXPECT_TRUE(mixed(&u32, 10, 20, 2));
+  EXPECT_EQUAL(u32, 20);
+  EXPECT_FALSE(mixed(&u32, 10, -20, 2));
+  /* s16 << (u8 + u64) */
+  EXPECT_TRUE(shifted(&s16, 1, 2, 4));
+  EXPECT_EQUAL(s16, 64);
+  EXPECT_FALSE(shifted(&s16, 1, 15, 1));
+  EXPECT_TRUE(delta(&s32, 1, 5));
+  EXPECT_EQUAL(s32, -4);
+  EXPECT_FALSE(delta(&s32, INT_MIN, 1));
+  EXPECT_TRUE(delta(NULL, 1, 5));
+  return r;
+}
+
+int T_formula_wide() {
+  int r=1;
+  uint32_t u32 = 0;
+  uint8_t u8 = 0;
+  size_t szt = 0;
+  EXPECT_TRUE(scaled(&u32, 65536, 65536, 256));
+  EXPECT_EQUAL(u32, 16777216);
+  EXPECT_FALSE(scaled(&u32, 65536, 65536, 1));
+  EXPECT_TRUE(narrow(&u8, 1000, 999));
+  EXPECT_EQUAL(u8, 1);
+  EXPECT_FALSE(narrow(&u8, 999, 1000));
+  EXPECT_TRUE(pages(&szt, 8191, 200, 199, 4096));
+  EXPECT_EQUAL(szt, 2);
+  EXPECT_FALSE(pages(&szt, SIZE_MAX, 1, 1, 4096));
+  return r;
+}
+
+int main(int argc, char **argv) {
+  int tests = 0, succ = 0, fail = 0;
+  (void) argc;
+  (void) argv;
+  tests++; if (T_formula_basic()) succ++; else fail++;
+  tests++; if (T_formula_wide()) succ++; else fail++;
+
+  printf("%d/%d expects succeeded (%d failures)\n",
+         expect_succ, expect, expect_fail);
+  printf("%d/%d tests succeeded (%d failures)\n", succ, tests, fail);
+  return fail;
+}
@@ -2,6 +2,7 @@
 #include <stdint.h>
 #include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 #include <safe_iop.h>
 
 /* __LP64__ is given by GCC. Without more work, this is bound to GCC. */
@@ -2116,16 +2117,18 @@ int T_iopf_mixed_s16u8u64() {
 
   a=8, c=8; EXPECT_TRUE(sopf(&a, "s16/u64", a, c));
             EXPECT_EQUAL(a, 1);
-  a=132, b=4, c=8; EXPECT_TRUE(sopf(&a, "s16-u8/u64", a, b, c));
+  a=132, b=4, c=8; EXPECT_TRUE(sopf(&a, "(s16-u8)/u64", a, b, c));
                    EXPECT_EQUAL(a, 16);
+  a=132, b=4, c=8; EXPECT_TRUE(sopf(&a, "s16-u8/u64", a, b, c));
+                   EXPECT_EQUAL(a, 132);
   a=132, b=4, c=0; EXPECT_FALSE(sopf(&a, "s16-u8/u64", a, b, c));
                    EXPECT_EQUAL(a, 132);
-  a=1, b=4,c=2; EXPECT_TRUE(sopf(&a, "s16<<u8+u64", a, b, c));
+  a=1, b=4,c=2; EXPECT_TRUE(sopf(&a, "(s16<<u8)+u64", a, b, c));
                 EXPECT_EQUAL(a, 18);
-  /* TODO: check this out... 
+  a=1, b=4,c=2; EXPECT_TRUE(sopf(&a, "s16<<u8+u64", a, b, c));
+                EXPECT_EQUAL(a, 64);
   a=5, b=1, c=1; EXPECT_TRUE(sopf(&a, "s16>>u8-u64", a, b, c));
-                 EXPECT_EQUAL(a, 1);
-  */
+                 EXPECT_EQUAL(a, 5);
   a=16, b=1, c=2; EXPECT_TRUE(sopf(&a, "s16>>u8<<u64", a, b, c));
                  EXPECT_EQUAL(a, 32);
   a=16, b=1,c=100; EXPECT_FALSE(sopf(&a, "s16>>u8<<u64", a, b, c));
@@ -2134,8 +2137,1667 @@ int T_iopf_mixed_s16u8u64() {
   return r;
 }
 
+int T_iopf_precedence() {
+  int r=1;
+  uint32_t hdr = 54, w = 640, h = 480, bpp = 3, pal = 256, sz = 0;
+  int32_t a = 0;
+  /* EXPECT_* hands the stringified call to printf */
+  const char *mod_fmt = "((s32+s32))%(s32)";
+  /* header + w*h*bpp + palette*4 */
+  EXPECT_TRUE(sopf(&sz, "u32+u32*u32*u32+u32*u32", hdr, w, h, bpp, pal, 4));
+  EXPECT_EQUAL(sz, 54 + 640*480*3 + 256*4);
+  EXPECT_TRUE(sopf(&sz, "u32 + u32*u32*u32 + u32*u32", hdr, w, h, bpp, pal, 4));
+  EXPECT_EQUAL(sz, 54 + 640*480*3 + 256*4);
+  sz = 0;
+  w = 0x10000; h = 0x10000;
+  EXPECT_FALSE(sopf(&sz, "u32+u32*u32*u32+u32*u32", hdr, w, h, bpp, pal, 4));
+  EXPECT_EQUAL(sz, 0);
+
+  EXPECT_TRUE(sopf(&a, "s32-s32-s32", 10, 4, 3));
+  EXPECT_EQUAL(a, 3);
+  EXPECT_TRUE(sopf(&a, "s32-(s32-s32)", 10, 4, 3));
+  EXPECT_EQUAL(a, 9);
+  EXPECT_TRUE(sopf(&a, "s32*(s32+s32)*s32", 2, 3, 4, 5));
+  EXPECT_EQUAL(a, 70);
+  EXPECT_TRUE(sopf(&a, mod_fmt, 7, 6, 5));
+  EXPECT_EQUAL(a, 3);
+  EXPECT_TRUE(sopf(&a, "s32+s32<<s32+s32", 1, 1, 1, 1));
+  EXPECT_EQUAL(a, 8);
+  EXPECT_TRUE(sopf(&a, "s32", -12));
+  EXPECT_EQUAL(a, -12);
+  /* all intermediates are still checked in the lhs type */
+  a = 1;
+  EXPECT_FALSE(sopf(&a, "s32*s32-s32*s32", INT_MAX, 2, INT_MAX, 2));
+  EXPECT_EQUAL(a, 1);
+
+  /* malformed formats */
+  EXPECT_FALSE(sopf(&a, "(s32+s32", 1, 2));
+  EXPECT_FALSE(sopf(&a, "s32+s32)", 1, 2));
+  EXPECT_FALSE(sopf(&a, "s32<s32", 1, 2));
+  EXPECT_FALSE(sopf(&a, "s32+u7", 1, 2));
+  EXPECT_FALSE(sopf(&a, "s32 s32", 1, 2));
+  EXPECT_FALSE(sopf(&a, "s32+)(", 1, 2));
+  EXPECT_EQUAL(a, 1);
+  return r;
+}
+
+int T_iopf_wide() {
+  int r=1;
+  uint32_t a = 0x10000, b = 0x10000, c = 0x100, u32 = 0;
+  uint8_t u8 = 0;
+  int64_t s64 = 0;
+  uint64_t u64 = 0;
+  /* a*b overflows u32 but the final result fits */
+  EXPECT_FALSE(sopf(&u32, "u32*u32/u32", a, b, c));
+  EXPECT_EQUAL(u32, 0);
+  EXPECT_TRUE(sopf(&u32, "#u32*u32/u32", a, b, c));
+  EXPECT_EQUAL(u32, 0x1000000);
+  /* negative intermediates are fine for unsigned results */
+  EXPECT_FALSE(sopf(&u8, "u8-u8+u8", 5, 10, 10));
+  EXPECT_TRUE(sopf(&u8, "#u8-u8+u8", 5, 10, 10));
+  EXPECT_EQUAL(u8, 5);
+  EXPECT_TRUE(sopf(&u8, "#u8*u8/u8", 200, 200, 250));
+  EXPECT_EQUAL(u8, 160);
+  /* but the final result is still checked against the lhs type */
+  u8 = 1;
+  EXPECT_FALSE(sopf(&u8, "#u8-u8", 5, 10));
+  EXPECT_FALSE(sopf(&u8, "#u8*u8", 16, 16));
+  EXPECT_FALSE(sopf(&u8, "#u8/u8", 16, 0));
+  EXPECT_EQUAL(u8, 1);
+  EXPECT_TRUE(sopf(NULL, "#(s32-s32)*(s32-s32)", 1, 2, 3, 4));
+  EXPECT_TRUE(sopf(&s64, "#s64-s64-s64", 0, SAFE_INT64_MAX, 1));
+  EXPECT_EQUAL(s64, SAFE_INT64_MIN);
+#if defined(__SIZEOF_INT128__)
+  EXPECT_TRUE(sopf(&s64, "#s64*s64/s64", SAFE_INT64_MAX, 4, 8));
+  EXPECT_EQUAL(s64, SAFE_INT64_MAX / 2);
+  EXPECT_TRUE(sopf(&u64, "#u64*u64/u64", SAFE_UINT64_MAX, 6, 8));
+  EXPECT_EQUAL(u64, SAFE_UINT64_MAX - SAFE_UINT64_MAX / 4 - 1);
+#endif
+  /* the wide type itself can still overflow */
+  EXPECT_FALSE(sopf(&u64, "#u64*u64/u64", SAFE_UINT64_MAX, SAFE_UINT64_MAX,
+                    SAFE_UINT64_MAX));
+  return r;
+}
+int T_iopf_result_type() {
+  int r=1;
+  uint32_t a = UINT_MAX, b = UINT_MAX;
+  uint64_t u64 = 0;
+  int16_t s16 = 0;
+  uint8_t u8 = 0;
+  EXPECT_FALSE(sopf(&u64, "u32*u32", a, b));
+  EXPECT_EQUAL(u64, 0);
+  EXPECT_TRUE(sopf(&u64, "u64=u32*u32", a, b));
+  EXPECT_EQUAL(u64, (uint64_t)UINT_MAX * UINT_MAX);
+  EXPECT_TRUE(sopf(&u64, " u64 = u32*u32 + u32", a, b, a));
+  EXPECT_EQUAL(u64, (uint64_t)UINT_MAX * UINT_MAX + UINT_MAX);
+  /* untyped operands default to the result type */
+  EXPECT_TRUE(sopf(&u64, "u64=u32*", a, (uint64_t)4));
+  EXPECT_EQUAL(u64, (uint64_t)UINT_MAX * 4);
+  EXPECT_TRUE(sopf(&s16, "s16=u8-u8", 5, 10));
+  EXPECT_EQUAL(s16, -5);
+  /* operands must still be castable to the result type ... */
+  EXPECT_FALSE(sopf(&u8, "u8=u32-u32", 1000, 999));
+  EXPECT_EQUAL(u8, 0);
+  /* ... unless the intermediates are wide */
+  EXPECT_TRUE(sopf(&u8, "#u8=u32-u32", 1000, 999));
+  EXPECT_EQUAL(u8, 1);
+  EXPECT_FALSE(sopf(&u8, "#u8=u32*u32", 1000, 999));
+  EXPECT_FALSE(sopf(&u8, "u8=u32=u32", 1, 2));
+  EXPECT_FALSE(sopf(&u8, "=u32", 1));
+  EXPECT_FALSE(sopf(&u8, "u8=u32+u9", 1, 2));
+  EXPECT_EQUAL(u8, 1);
+  return r;
+}
+int T_iopf_batch() {
+  int r=1;
+  enum { N = 300 };
+  static uint32_t w[N], h[N];
+  static uint16_t pad[N];
+  static uint64_t out[N], want;
+  static int32_t s32[N], s32out[N];
+  static uint8_t u8out[N], mask[(N + 7) / 8];
+  sopf_prog_t prog;
+  size_t i;
+  int agree = 1, masked = 1;
+  ssize_t failed = 0;
+
+  for (i = 0; i < N; ++i) {
+    w[i] = (i % 7 == 0) ? UINT_MAX : (uint32_t) i * 1000;
+    h[i] = (i % 11 == 0) ? UINT_MAX : (uint32_t) i + 1;
+    pad[i] = (uint16_t) i;
+    s32[i] = (int32_t) i - 150;
+    out[i] = 0;
+  }
+  EXPECT_TRUE(sopf_compile(&prog, "u64=u32*u32*u32+u16"));
+  EXPECT_EQUAL(prog.nargs, 4);
+  /* Every row must agree with a single sopf call */
+  failed = sopf_batch(&prog, N, out, mask, w, h, w, pad);
+  for (i = 0; i < N; ++i) {
+    int ok = sopf(&want, "u64=u32*u32*u32+u16", w[i], h[i], w[i], pad[i]);
+    if (ok && out[i] != want)
+      agree = 0;
+    if (!ok && out[i] != 0)
+      agree = 0;
+    if (!ok != !!(mask[i / 8] & (1 << (i % 8))))
+      masked = 0;
+    failed -= !ok;
+  }
+  EXPECT_TRUE(agree);
+  EXPECT_TRUE(masked);
+  EXPECT_EQUAL(failed, 0);
+  /* 1000*2*1000+1 fits, UINT_MAX*78*UINT_MAX does not */
+  EXPECT_EQUAL(mask[0], 0x81);
+  EXPECT_EQUAL(out[1], 2000001);
+  EXPECT_EQUAL(out[77], 0);
+
+  /* Wide mode only range checks the final value */
+  EXPECT_TRUE(sopf_compile(&prog, "#u8=s32*s32/s32"));
+  EXPECT_EQUAL(sopf_batch(&prog, N, u8out, NULL, s32, s32, s32), 151);
+  EXPECT_EQUAL(u8out[0], 0);
+  EXPECT_EQUAL(u8out[160], 10);
+  EXPECT_EQUAL(u8out[299], 149);
+  EXPECT_TRUE(sopf_compile(&prog, "s32-s32"));
+  EXPECT_EQUAL(sopf_batch(&prog, N, s32out, NULL, s32, s32), 0);
+  EXPECT_EQUAL(s32out[0], 0);
+  EXPECT_EQUAL(sopf_batch(&prog, 0, s32out, NULL, s32, s32), 0);
+
+  EXPECT_FALSE(sopf_compile(&prog, "u32+(u32"));
+  EXPECT_TRUE(sopf_compile(&prog, "s32-s32"));
+  EXPECT_EQUAL(sopf_batch(&prog, N, NULL, NULL, s32, s32), -1);
+  EXPECT_EQUAL(sopf_batch(&prog, N, s32out, NULL, s32, NULL), -1);
+  prog.lhs = 0;
+  EXPECT_EQUAL(sopf_batch(&prog, N, s32out, NULL, s32, s32), -1);
+  return r;
+}
+
+/***** ARRAY *****/
+static uint64_t t_rand_state = 1;
+static uint64_t T_rand(void) {
+  t_rand_state = t_rand_state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return t_rand_state >> 11;
+}
+
+/* T_rand only has 53 bits */
+static uint64_t T_rand64(void) {
+  return T_rand() << 32 ^ T_rand();
+}
+
+/* A random element of a fixed size array */
+#define T_PICK(_a) ((_a)[T_rand() % (sizeof(_a) / sizeof((_a)[0]))])
+
+/* Appends the limits of _type and their neighbours, half the maximum and
+ * one past it, and every value from _lo to _hi to _v[_n]. */
+#define T_EDGES(_v, _n, _type, _min, _max, _lo, _hi) { \
+  int _e; \
+  _v[_n++] = (_min); _v[_n++] = (_max); _v[_n++] = (_type) ((_max) - 1); \
+  _v[_n++] = (_type) ((_min) + 1); \
+  _v[_n++] = (_type) ((_max) / 2); _v[_n++] = (_type) ((_max) / 2 + 1); \
+  for (_e = (_lo); _e <= (_hi); ++_e) \
+    _v[_n++] = (_type) _e; \
+  }
+
+/* Fills _v up to _len with random values */
+#define T_FILL(_v, _n, _type, _len) \
+  while (_n < (_len)) \
+    _v[_n++] = (_type) T_rand64();
+
+/* The randomized tests below build their inputs in a few numbered cases
+ * k, from values that never overflow through full range and extreme ones,
+ * and compare against a scalar reference for each. */
+
+/* Checks an array kernel against a serial loop over the same-type macro.
+ * k 1 and 2 overflow once in the vector body and in the tail, 4 is in
+ * place and 5 mixes signs (unsigned: values near the maximum).
+ */
+#define T_ARRAY_OP(_op, _m, _t, _s, _sign, _ova, _ovb) \
+int T_##_op##_array_##_m() { \
+  int r=1; \
+  enum { N = 203 }; \
+  _t a[N], b[N], d[N], e[N]; \
+  size_t i, fi, ref_at; \
+  int k, ok, ref; \
+  for (k = 0; k < 6; ++k) { \
+    for (i = 0; i < N; ++i) { \
+      a[i] = (_t) (k == 3 ? T_rand() : T_rand() % 16); \
+      b[i] = (_t) (k == 3 ? T_rand() : T_rand() % 4); \
+      if (k == 5) { \
+        a[i] = (_t) (a[i] - 8); \
+        b[i] = (_t) (b[i] - 2); \
+      } \
+      d[i] = e[i] = (_t) 0x5a; \
+    } \
+    if (k == 1 || k == 2) { \
+      i = (k == 1) ? 37 : N - 1; \
+      a[i] = (_ova); b[i] = (_ovb); \
+    } \
+    for (ref_at = 0, ref = 1; ref_at < N; ++ref_at) { \
+      if (!sop_##_s##_op(_sign, _t, &e[ref_at], _sign, _t, a[ref_at], \
+                         _sign, _t, b[ref_at])) { \
+        ref = 0; \
+        break; \
+      } \
+    } \
+    fi = N; \
+    if (k == 4) { \
+      memcpy(d, a, sizeof(d)); \
+      ok = sop_##_op##_array_##_m(d, d, b, N, &fi); \
+    } else { \
+      ok = sop_##_op##_array_##_m(d, a, b, N, &fi); \
+    } \
+    EXPECT_EQUAL(ok, ref); \
+    EXPECT_EQUAL(fi, ref ? (size_t) N : ref_at); \
+    if (k != 4) \
+      EXPECT_EQUAL(memcmp(d, e, sizeof(d)), 0); \
+  } \
+  EXPECT_FALSE(ref && k == 3); \
+  EXPECT_TRUE(sop_##_op##_array_##_m(NULL, a, a, 0, NULL)); \
+  return r; \
+}
+
+T_ARRAY_OP(add, u8, uint8_t, u, 0, UINT8_MAX, 1)
+T_ARRAY_OP(add, s8, int8_t, s, 1, INT8_MAX, 1)
+T_ARRAY_OP(add, u16, uint16_t, u, 0, UINT16_MAX, 1)
+T_ARRAY_OP(add, s16, int16_t, s, 1, INT16_MAX, 1)
+T_ARRAY_OP(add, u32, uint32_t, u, 0, UINT32_MAX, 1)
+T_ARRAY_OP(add, s32, int32_t, s, 1, INT32_MAX, 1)
+T_ARRAY_OP(add, u64, uint64_t, u, 0, UINT64_MAX, 1)
+T_ARRAY_OP(add, s64, int64_t, s, 1, INT64_MAX, 1)
+T_ARRAY_OP(sub, u8, uint8_t, u, 0, 0, 1)
+T_ARRAY_OP(sub, s8, int8_t, s, 1, INT8_MIN, 1)
+T_ARRAY_OP(sub, u16, uint16_t, u, 0, 0, 1)
+T_ARRAY_OP(sub, s16, int16_t, s, 1, INT16_MIN, 1)
+T_ARRAY_OP(sub, u32, uint32_t, u, 0, 0, 1)
+T_ARRAY_OP(sub, s32, int32_t, s, 1, INT32_MIN, 1)
+T_ARRAY_OP(sub, u64, uint64_t, u, 0, 0, 1)
+T_ARRAY_OP(sub, s64, int64_t, s, 1, INT64_MIN, 1)
+T_ARRAY_OP(mul, u8, uint8_t, u, 0, UINT8_MAX, 2)
+T_ARRAY_OP(mul, s8, int8_t, s, 1, INT8_MIN, -1)
+T_ARRAY_OP(mul, u16, uint16_t, u, 0, UINT16_MAX, 2)
+T_ARRAY_OP(mul, s16, int16_t, s, 1, INT16_MIN, -1)
+T_ARRAY_OP(mul, u32, uint32_t, u, 0, UINT32_MAX, 2)
+T_ARRAY_OP(mul, s32, int32_t, s, 1, INT32_MIN, -1)
+T_ARRAY_OP(mul, u64, uint64_t, u, 0, UINT64_MAX, 2)
+T_ARRAY_OP(mul, s64, int64_t, s, 1, INT64_MIN, -1)
+
+/* Sums must agree with a serial sop_add chain.  k 1 crosses the maximum
+ * late, 2 overflows part way through a signed sum that ends in range
+ * (unsigned: exactly the maximum), 4 mixes signs and 5 walks just below the
+ * maximum so that blocks have to be replayed. */
+#define T_SUM(_m, _t, _s, _sign, _min, _max) \
+int T_sum_##_m() { \
+  int r=1; \
+  enum { N = 2600 }; \
+  static _t a[N]; \
+  _t got, ref; \
+  size_t i; \
+  int k, ok, ref_ok; \
+  for (k = 0; k < 6; ++k) { \
+    for (i = 0; i < N; ++i) { \
+      a[i] = (_t) (k == 3 ? T_rand() : (_t) (T_rand() % 2)); \
+      if (k == 4) \
+        a[i] = (_t) (T_rand() % 5 - 2); \
+      if (k == 5) \
+        a[i] = (_t) ((i & 1) ? -1 : 1); \
+    } \
+    if (k == 5) \
+      a[0] = (_t) ((_max) - 1); \
+    if (k == 1) \
+      a[N - 3] = (_max); \
+    if (k == 2) { \
+      memset(a, 0, sizeof(a)); \
+      a[1500] = (_max); \
+      a[2100] = 1; \
+      a[2101] = (_t) ((_min) == 0 ? 0 : -1); \
+      if ((_min) == 0) \
+        a[2100] = 0; \
+    } \
+    ref = 0; \
+    ref_ok = 1; \
+    for (i = 0; i < N; ++i) { \
+      if (!sop_##_s##add(_sign, _t, &ref, _sign, _t, ref, _sign, _t, a[i])) { \
+        ref_ok = 0; \
+        break; \
+      } \
+    } \
+    got = (_t) 0x5a; \
+    ok = sop_sum_##_m(&got, a, N); \
+    EXPECT_EQUAL(ok, ref_ok); \
+    EXPECT_EQUAL(got, ref_ok ? ref : (_t) 0x5a); \
+  } \
+  EXPECT_TRUE(sop_sum_##_m(&got, a, 0)); \
+  EXPECT_EQUAL(got, 0); \
+  return r; \
+}
+
+T_SUM(u8, uint8_t, u, 0, 0, UINT8_MAX)
+T_SUM(s8, int8_t, s, 1, INT8_MIN, INT8_MAX)
+T_SUM(u16, uint16_t, u, 0, 0, UINT16_MAX)
+T_SUM(s16, int16_t, s, 1, INT16_MIN, INT16_MAX)
+T_SUM(u32, uint32_t, u, 0, 0, UINT32_MAX)
+T_SUM(s32, int32_t, s, 1, INT32_MIN, INT32_MAX)
+T_SUM(u64, uint64_t, u, 0, 0, UINT64_MAX)
+T_SUM(s64, int64_t, s, 1, INT64_MIN, INT64_MAX)
+
+/* Scans must write exactly the offsets a serial sop_uadd chain finds.
+ * k 1 overflows part way through, 2 only the end offset, 3 ends exactly at
+ * the maximum and 4 scans in place. */
+#define T_SCAN(_m, _t, _max) \
+int T_exclusive_scan_##_m() { \
+  int r=1; \
+  enum { N = 1003 }; \
+  static _t a[N], out[N], ref[N]; \
+  _t total; \
+  size_t i, written; \
+  int k, ok, ref_ok, same; \
+  for (k = 0; k < 5; ++k) { \
+    for (i = 0; i < N; ++i) \
+      a[i] = (_t) (T_rand() % 1000); \
+    if (k == 1) \
+      a[701] = (_max) - 1000; \
+    if (k == 2 || k == 3) { \
+      a[N - 1] = 0; \
+      for (i = 0, total = 0; i < N; ++i) \
+        total += a[i]; \
+      a[N - 1] = (_t) ((_max) - total + (k == 2)); \
+    } \
+    ref_ok = 1; \
+    written = N; \
+    for (i = 0, total = 0; i < N; ++i) { \
+      ref[i] = total; \
+      if (!sop_uadd(0, _t, &total, 0, _t, total, 0, _t, a[i])) { \
+        ref_ok = 0; \
+        written = i + 1; \
+        break; \
+      } \
+    } \
+    if (k == 4) { \
+      memcpy(out, a, sizeof(out)); \
+      ok = sop_exclusive_scan_##_m(out, out, N); \
+    } else { \
+      memset(out, 0x5a, sizeof(out)); \
+      ok = sop_exclusive_scan_##_m(out, a, N); \
+    } \
+    EXPECT_EQUAL(ok, ref_ok); \
+    for (i = 0, same = 1; i < N; ++i) { \
+      _t want = ref[i]; \
+      if (i >= written) \
+        memset(&want, 0x5a, sizeof(want)); \
+      if (out[i] != want) \
+        same = 0; \
+    } \
+    EXPECT_TRUE(same); \
+  } \
+  EXPECT_TRUE(sop_exclusive_scan_##_m(out, a, 0)); \
+  return r; \
+}
+
+T_SCAN(u32, uint32_t, UINT32_MAX)
+T_SCAN(u64, uint64_t, UINT64_MAX)
+T_SCAN(size_t, size_t, SIZE_MAX)
+
+/* Grouped sums must match a serial sop_uadd chain per row, including the
+ * failing row and the totals left behind.  k 1 overflows one group late,
+ * 2 brings a group exactly to the maximum, 3 has a bad key and 4 overflows
+ * before one.  The row counts cover partial blocks. */
+int T_group_sum_u64() {
+  int r=1;
+  enum { N = 2000, G = 37 };
+  static uint32_t keys[N];
+  static uint64_t values[N], out[G], ref[G];
+  size_t i, n, fail_index, ref_index;
+  int k, ok, ref_ok;
+  for (k = 0; k < 5; ++k) {
+    for (n = 1; n <= N; n += 333) {
+      for (i = 0; i < n; ++i) {
+        keys[i] = (uint32_t) (T_rand() % G);
+        values[i] = T_rand() % 1000;
+      }
+      for (i = 0; i < G; ++i)
+        ref[i] = out[i] = T_rand() % 1000;
+      if (k == 1 || k == 4)
+        values[n * 3 / 4] = UINT64_MAX - 1000;
+      if (k == 2) {
+        for (i = 0; i < n; ++i)
+          if (keys[i] == keys[n - 1])
+            values[i] = 0;
+        values[n - 1] = UINT64_MAX - out[keys[n - 1]];
+      }
+      if (k == 3 || k == 4)
+        keys[n - 1] = G + (uint32_t) (T_rand() % 3);
+      ref_ok = 1;
+      ref_index = n;
+      for (i = 0; i < n; ++i)
+        if (keys[i] >= G ||
+            !sop_uadd(0, uint64_t, &ref[keys[i]], 0, uint64_t, ref[keys[i]],
+                      0, uint64_t, values[i])) {
+          ref_ok = 0;
+          ref_index = i;
+          break;
+        }
+      fail_index = n;
+      ok = sop_group_sum_u64(keys, values, n, out, G, &fail_index);
+      EXPECT_EQUAL(ok, ref_ok);
+      EXPECT_EQUAL(fail_index, ref_index);
+      EXPECT_TRUE(!memcmp(out, ref, sizeof(out)));
+    }
+  }
+  EXPECT_TRUE(sop_group_sum_u64(keys, values, 0, out, G, NULL));
+  EXPECT_TRUE(!sop_group_sum_u64(keys, values, 1, out, 0, NULL));
+  EXPECT_TRUE(!memcmp(out, ref, sizeof(out)));
+  return r;
+}
+
+/* Parallel sums and scans must match the serial ones for any number of
+ * threads.  k 1 defeats the s64 block bounds, 2 overflows in the middle,
+ * and 3 and 4 start next to the maximum and minimum and come straight
+ * back, so signed chunks are replayed; unsigned 4 ends exactly at the
+ * maximum. */
+#define T_PARALLEL_SUM(_m, _t, _min, _max) \
+int T_parallel_sum_##_m() { \
+  int r=1; \
+  enum { N = 20011 }; \
+  static _t a[N]; \
+  _t got, ref; \
+  size_t i; \
+  int k, threads, ok, ref_ok; \
+  for (k = 0; k < 5; ++k) { \
+    for (i = 0; i < N; ++i) { \
+      a[i] = (_t) (k == 1 ? T_rand() : (T_rand() % 256 == 0)); \
+      if (k != 1 && (_min) != 0 && (i & 1)) \
+        a[i] = (_t) -a[i]; \
+    } \
+    if (k == 2) \
+      a[N / 2] = (_max); \
+    if (k == 3) { \
+      a[0] = (_t) ((_max) - 1); \
+      a[1] = (_t) -a[0]; \
+    } \
+    if (k == 4 && (_min) != 0) { \
+      a[0] = (_t) ((_min) + 1); \
+      a[1] = (_t) -a[0]; \
+    } \
+    if (k == 4 && (_min) == 0) { \
+      memset(a, 0, sizeof(a)); \
+      a[N - 1] = (_max); \
+    } \
+    ref = (_t) 0x5a; \
+    ref_ok = sop_sum_##_m(&ref, a, N); \
+    for (threads = 2; threads <= 7; threads += 5) { \
+      sop_parallel_set(threads, 1000); \
+      got = (_t) 0x5a; \
+      ok = sop_parallel_sum_##_m(&got, a, N); \
+      EXPECT_EQUAL(ok, ref_ok); \
+      EXPECT_EQUAL(got, ref); \
+    } \
+  } \
+  sop_parallel_set(0, 0); \
+  return r; \
+}
+
+T_PARALLEL_SUM(u8, uint8_t, 0, UINT8_MAX)
+T_PARALLEL_SUM(s8, int8_t, INT8_MIN, INT8_MAX)
+T_PARALLEL_SUM(u16, uint16_t, 0, UINT16_MAX)
+T_PARALLEL_SUM(s16, int16_t, INT16_MIN, INT16_MAX)
+T_PARALLEL_SUM(u32, uint32_t, 0, UINT32_MAX)
+T_PARALLEL_SUM(s32, int32_t, INT32_MIN, INT32_MAX)
+T_PARALLEL_SUM(u64, uint64_t, 0, UINT64_MAX)
+T_PARALLEL_SUM(s64, int64_t, INT64_MIN, INT64_MAX)
+
+/* k 1 overflows late and 2 scans in place. */
+#define T_PARALLEL_SCAN(_m, _t, _max) \
+int T_parallel_exclusive_scan_##_m() { \
+  int r=1; \
+  enum { N = 20011 }; \
+  static _t a[N], got[N], ref[N]; \
+  size_t i; \
+  int k, threads, ok, ref_ok; \
+  for (k = 0; k < 3; ++k) { \
+    for (i = 0; i < N; ++i) \
+      a[i] = (_t) (T_rand() % 1000); \
+    if (k == 1) \
+      a[15000] = (_max) - 1000; \
+    memset(ref, 0x5a, sizeof(ref)); \
+    ref_ok = sop_exclusive_scan_##_m(ref, a, N); \
+    for (threads = 2; threads <= 7; threads += 5) { \
+      sop_parallel_set(threads, 1000); \
+      if (k == 2) { \
+        memcpy(got, a, sizeof(got)); \
+        ok = sop_parallel_exclusive_scan_##_m(got, got, N); \
+      } else { \
+        memset(got, 0x5a, sizeof(got)); \
+        ok = sop_parallel_exclusive_scan_##_m(got, a, N); \
+      } \
+      EXPECT_EQUAL(ok, ref_ok); \
+      EXPECT_TRUE(memcmp(got, ref, sizeof(got)) == 0); \
+    } \
+  } \
+  sop_parallel_set(0, 0); \
+  return r; \
+}
+
+T_PARALLEL_SCAN(u32, uint32_t, UINT32_MAX)
+T_PARALLEL_SCAN(u64, uint64_t, UINT64_MAX)
+T_PARALLEL_SCAN(size_t, size_t, SIZE_MAX)
+
+/* Narrowing must agree with sop_safe_cast element by element.  k 1 and 2
+ * add a value that does not fit in a checked block and in the tail, and 4
+ * is the destination limits with one value just past them.  Values are
+ * made to fit by halving, which walks the source limits onto the
+ * destination's. */
+#define T_NARROW_FIT(_x, _st, _ss, _dt, _ds) \
+  while (!sop_safe_cast(_ds, _dt, 0, _ss, _st, _x)) \
+    _x = (_st) (_x / 2);
+
+#define T_NARROW(_sm, _st, _ss, _dm, _dt, _ds) \
+int T_narrow_array_##_sm##_to_##_dm() { \
+  int r=1; \
+  enum { N = 1003 }; \
+  static _st a[N]; \
+  static _dt d[N], e[N]; \
+  const _st hi = (_st) (_ss ? UINT64_MAX >> (65 - sizeof(_st) * CHAR_BIT) \
+                            : UINT64_MAX); \
+  const _st lo = (_st) (_ss ? -hi - 1 : 0); \
+  _st fhi = hi, flo = lo, out, x; \
+  size_t i, n, fi, ref_at; \
+  int k, ok, ref_ok; \
+  T_NARROW_FIT(fhi, _st, _ss, _dt, _ds) \
+  T_NARROW_FIT(flo, _st, _ss, _dt, _ds) \
+  out = (_st) (fhi != hi ? fhi + 1 : flo - 1); \
+  for (k = 0; k < 5; ++k) { \
+    for (i = 0; i < N; ++i) { \
+      x = (_st) T_rand(); \
+      if (k != 3) \
+        T_NARROW_FIT(x, _st, _ss, _dt, _ds) \
+      if (k == 4) \
+        x = (i & 1) ? fhi : flo; \
+      a[i] = x; \
+    } \
+    if (k == 1 || k == 4) \
+      a[k == 1 ? 600 : 777] = out; \
+    if (k == 2) \
+      a[N - 3] = sop_safe_cast(_ds, _dt, 0, _ss, _st, hi) ? lo : hi; \
+    for (n = N; n > 0; n = (n == N) ? 37 : 0) { \
+      ref_ok = 1; \
+      ref_at = 0; \
+      memset(e, 0x5a, sizeof(e)); \
+      for (i = 0; i < n; ++i) { \
+        if (!sop_safe_cast(_ds, _dt, 0, _ss, _st, a[i])) { \
+          ref_ok = 0; \
+          ref_at = i; \
+          break; \
+        } \
+        e[i] = (_dt) a[i]; \
+      } \
+      memset(d, 0x5a, sizeof(d)); \
+      fi = 12345; \
+      ok = sop_narrow_array_##_sm##_to_##_dm(d, a, n, &fi); \
+      EXPECT_EQUAL(ok, ref_ok); \
+      EXPECT_EQUAL(fi, ref_ok ? 12345 : ref_at); \
+      EXPECT_TRUE(memcmp(d, e, sizeof(d)) == 0); \
+      ok = sop_narrow_array_##_sm##_to_##_dm(NULL, a, n, NULL); \
+      EXPECT_EQUAL(ok, ref_ok); \
+    } \
+  } \
+  EXPECT_TRUE(sop_narrow_array_##_sm##_to_##_dm(d, a, 0, NULL)); \
+  /* An exactly sized heap buffer, 16 mod 32 long, must not be read past */ \
+  { \
+    _st *h = (_st *) malloc(48 * sizeof(_st)); \
+    for (i = 0; i < 48; ++i) \
+      h[i] = (i & 1) ? fhi : flo; \
+    EXPECT_TRUE(sop_narrow_array_##_sm##_to_##_dm(d, h, 48, NULL) && \
+                d[47] == (_dt) fhi); \
+    h[47] = out; \
+    fi = 0; \
+    EXPECT_FALSE(sop_narrow_array_##_sm##_to_##_dm(d, h, 48, &fi)); \
+    EXPECT_EQUAL(fi, 47); \
+    free(h); \
+  } \
+  return r; \
+}
+
+T_NARROW(u8, uint8_t, 0, s8, int8_t, 1)
+T_NARROW(s8, int8_t, 1, u8, uint8_t, 0)
+T_NARROW(s8, int8_t, 1, u16, uint16_t, 0)
+T_NARROW(s8, int8_t, 1, u32, uint32_t, 0)
+T_NARROW(s8, int8_t, 1, u64, uint64_t, 0)
+T_NARROW(u16, uint16_t, 0, u8, uint8_t, 0)
+T_NARROW(u16, uint16_t, 0, s8, int8_t, 1)
+T_NARROW(u16, uint16_t, 0, s16, int16_t, 1)
+T_NARROW(s16, int16_t, 1, u8, uint8_t, 0)
+T_NARROW(s16, int16_t, 1, s8, int8_t, 1)
+T_NARROW(s16, int16_t, 1, u16, uint16_t, 0)
+T_NARROW(s16, int16_t, 1, u32, uint32_t, 0)
+T_NARROW(s16, int16_t, 1, u64, uint64_t, 0)
+T_NARROW(u32, uint32_t, 0, u8, uint8_t, 0)
+T_NARROW(u32, uint32_t, 0, s8, int8_t, 1)
+T_NARROW(u32, uint32_t, 0, u16, uint16_t, 0)
+T_NARROW(u32, uint32_t, 0, s16, int16_t, 1)
+T_NARROW(u32, uint32_t, 0, s32, int32_t, 1)
+T_NARROW(s32, int32_t, 1, u8, uint8_t, 0)
+T_NARROW(s32, int32_t, 1, s8, int8_t, 1)
+T_NARROW(s32, int32_t, 1, u16, uint16_t, 0)
+T_NARROW(s32, int32_t, 1, s16, int16_t, 1)
+T_NARROW(s32, int32_t, 1, u32, uint32_t, 0)
+T_NARROW(s32, int32_t, 1, u64, uint64_t, 0)
+T_NARROW(u64, uint64_t, 0, u8, uint8_t, 0)
+T_NARROW(u64, uint64_t, 0, s8, int8_t, 1)
+T_NARROW(u64, uint64_t, 0, u16, uint16_t, 0)
+T_NARROW(u64, uint64_t, 0, s16, int16_t, 1)
+T_NARROW(u64, uint64_t, 0, u32, uint32_t, 0)
+T_NARROW(u64, uint64_t, 0, s32, int32_t, 1)
+T_NARROW(u64, uint64_t, 0, s64, int64_t, 1)
+T_NARROW(s64, int64_t, 1, u8, uint8_t, 0)
+T_NARROW(s64, int64_t, 1, s8, int8_t, 1)
+T_NARROW(s64, int64_t, 1, u16, uint16_t, 0)
+T_NARROW(s64, int64_t, 1, s16, int16_t, 1)
+T_NARROW(s64, int64_t, 1, u32, uint32_t, 0)
+T_NARROW(s64, int64_t, 1, s32, int32_t, 1)
+T_NARROW(s64, int64_t, 1, u64, uint64_t, 0)
+
+/* Saturating kernels must match clamping the exact result.  k 0 spans
+ * several counter blocks and 3 is in place. */
+#define T_SAT(_op, _c, _m, _t, _min, _max) \
+int T_##_op##_sat_array_##_m() { \
+  int r=1; \
+  enum { N = 9001 }; \
+  static _t a[N], b[N], d[N], e[N]; \
+  size_t i, ref, got; \
+  int k; \
+  int64_t v; \
+  for (k = 0; k < 4; ++k) { \
+    for (i = 0; i < N; ++i) { \
+      a[i] = (_t) T_rand(); \
+      b[i] = (_t) T_rand(); \
+      if (k == 1) { \
+        a[i] = (_t) (8 + a[i] % 8); \
+        b[i] = (_t) (b[i] % 8); \
+      } \
+      if (k == 2) { \
+        a[i] = (T_rand() & 1) ? (_min) : (_max); \
+        b[i] = (T_rand() & 1) ? (_min) : (_max); \
+      } \
+    } \
+    ref = 0; \
+    for (i = 0; i < N; ++i) { \
+      v = (int64_t) a[i] _c (int64_t) b[i]; \
+      if (v < (_min) || v > (_max)) { \
+        v = (v < (_min)) ? (_min) : (_max); \
+        ++ref; \
+      } \
+      e[i] = (_t) v; \
+    } \
+    EXPECT_EQUAL(sop_##_op##_sat_array_##_m(NULL, a, b, N), ref); \
+    if (k == 3) { \
+      got = sop_##_op##_sat_array_##_m(a, a, b, N); \
+      EXPECT_TRUE(memcmp(a, e, sizeof(a)) == 0); \
+    } else { \
+      memset(d, 0x5a, sizeof(d)); \
+      got = sop_##_op##_sat_array_##_m(d, a, b, N); \
+      EXPECT_TRUE(memcmp(d, e, sizeof(d)) == 0); \
+    } \
+    EXPECT_EQUAL(got, ref); \
+    if (k == 1) \
+      EXPECT_EQUAL(got, 0); \
+  } \
+  EXPECT_EQUAL(sop_##_op##_sat_array_##_m(d, a, b, 0), 0); \
+  return r; \
+}
+
+T_SAT(add, +, u8, uint8_t, 0, UINT8_MAX)
+T_SAT(add, +, s8, int8_t, INT8_MIN, INT8_MAX)
+T_SAT(add, +, u16, uint16_t, 0, UINT16_MAX)
+T_SAT(add, +, s16, int16_t, INT16_MIN, INT16_MAX)
+T_SAT(sub, -, u8, uint8_t, 0, UINT8_MAX)
+T_SAT(sub, -, s8, int8_t, INT8_MIN, INT8_MAX)
+T_SAT(sub, -, u16, uint16_t, 0, UINT16_MAX)
+T_SAT(sub, -, s16, int16_t, INT16_MIN, INT16_MAX)
+T_SAT(mul, *, u8, uint8_t, 0, UINT8_MAX)
+T_SAT(mul, *, s8, int8_t, INT8_MIN, INT8_MAX)
+T_SAT(mul, *, u16, uint16_t, 0, UINT16_MAX)
+T_SAT(mul, *, s16, int16_t, INT16_MIN, INT16_MAX)
+
+/* Vector ops must match the GNU C interface on each lane.  The lanes of
+ * _dst the mask clears must hold the checked result. */
+#define T_VEC_OP(_op, _m, _n) \
+    m = sop_v_##_op##_##_m(&c, a, b); \
+    ok = 1; \
+    for (j = 0; j < (_n); ++j) \
+      ok &= sop_##_op(&x, a[j], b[j]) ? (m[j] == 0 && c[j] == x) : \
+                                        (m[j] == -1); \
+    EXPECT_TRUE(ok); \
+    m2 = sop_v_##_op##_##_m(NULL, a, b) != m; \
+    EXPECT_TRUE(sop_v_any(m2) == 0);
+#define T_VEC(_s, _bits, _n) \
+int T_v_##_s##_bits##x##_n() { \
+  int r=1; \
+  typedef __typeof__(((sop_v_##_s##_bits##x##_n##_t) {0})[0]) _t; \
+  const _t edge[5] = { (_t) 0, (_t) 1, (_t) -1, \
+                       __sop(m)(smin)(_t), __sop(m)(smax)(_t) }; \
+  sop_v_##_s##_bits##x##_n##_t a, b, c; \
+  sop_v_s##_bits##x##_n##_t m, m2, all; \
+  _t x; \
+  int i, j, k, ok, any; \
+  for (k = 0; k < 3; ++k) { \
+    for (i = 0; i < 200; ++i) { \
+      any = 0; \
+      for (j = 0; j < (_n); ++j) { \
+        a[j] = (_t) T_rand64(); \
+        b[j] = (_t) T_rand64(); \
+        if (k == 1) { \
+          a[j] = (_t) (8 + a[j] % 8); \
+          b[j] = (_t) (b[j] % 8); \
+        } \
+        if (k == 2) { \
+          a[j] = T_PICK(edge); \
+          b[j] = T_PICK(edge); \
+        } \
+      } \
+      T_VEC_OP(add, _s##_bits##x##_n, _n) \
+      all = m; \
+      T_VEC_OP(sub, _s##_bits##x##_n, _n) \
+      all |= m; \
+      T_VEC_OP(mul, _s##_bits##x##_n, _n) \
+      all |= m; \
+      for (j = 0; j < (_n); ++j) \
+        any |= all[j] != 0; \
+      EXPECT_TRUE(sop_v_any(all) == any); \
+      if (k == 1) \
+        EXPECT_TRUE(any == 0); \
+    } \
+  } \
+  return r; \
+}
+
+T_VEC(u, 8, 16)
+T_VEC(s, 8, 16)
+T_VEC(u, 16, 8)
+T_VEC(s, 16, 8)
+T_VEC(u, 32, 4)
+T_VEC(s, 32, 4)
+T_VEC(u, 64, 2)
+T_VEC(s, 64, 2)
+T_VEC(u, 8, 32)
+T_VEC(s, 8, 32)
+T_VEC(u, 16, 16)
+T_VEC(s, 16, 16)
+T_VEC(u, 32, 8)
+T_VEC(s, 32, 8)
+T_VEC(u, 64, 4)
+T_VEC(s, 64, 4)
+T_VEC(u, 8, 64)
+T_VEC(s, 8, 64)
+T_VEC(u, 16, 32)
+T_VEC(s, 16, 32)
+T_VEC(u, 32, 16)
+T_VEC(s, 32, 16)
+T_VEC(u, 64, 8)
+T_VEC(s, 64, 8)
+
+#if defined(__SIZEOF_INT128__)
+/* Dot products must match the exact sum.  k 2 overflows part way through
+ * but (when signed) ends back in range, including pmaddwd pairs that reach
+ * 2^31. */
+#define T_DOT(_m, _t, _rt, _rmin, _rmax, _big) \
+int T_dot_##_m() { \
+  int r=1; \
+  enum { N = 2603 }; \
+  static _t a[N], b[N]; \
+  _rt got; \
+  __int128 ref; \
+  size_t i, n; \
+  int k, ok, ref_ok; \
+  for (k = 0; k < 4; ++k) { \
+    for (i = 0; i < N; ++i) { \
+      a[i] = (_t) (k == 1 ? T_rand() : T_rand() % 200); \
+      b[i] = (_t) (k == 1 ? T_rand() : T_rand() % 200); \
+      if (k == 0 && (_rmin) != 0) { \
+        a[i] -= 100; \
+        b[i] -= 100; \
+      } \
+      if (k == 2) \
+        a[i] = b[i] = 0; \
+      if (k == 2 && i < 16) \
+        a[i] = b[i] = (_big); \
+      if (k == 2 && i >= 8 && i < 16) \
+        b[i] = (_t) ~(_big); \
+      if (k == 3) \
+        a[i] = b[i] = (_big); \
+    } \
+    for (n = N; n > 0; n = (n == N) ? 5 : 0) { \
+      ref = 0; \
+      for (i = 0; i < n; ++i) \
+        ref += (__int128) a[i] * b[i]; \
+      ref_ok = (ref >= (_rmin) && ref <= (_rmax)); \
+      got = (_rt) 0x5a; \
+      ok = sop_dot_##_m(&got, a, b, n); \
+      EXPECT_EQUAL(ok, ref_ok); \
+      EXPECT_EQUAL(got, ref_ok ? (_rt) ref : (_rt) 0x5a); \
+    } \
+  } \
+  EXPECT_TRUE(sop_dot_##_m(&got, a, b, 0)); \
+  EXPECT_EQUAL(got, 0); \
+  return r; \
+}
+
+T_DOT(s16, int16_t, int32_t, INT32_MIN, INT32_MAX, INT16_MIN)
+T_DOT(s32, int32_t, int64_t, INT64_MIN, INT64_MAX, INT32_MIN)
+T_DOT(u32, uint32_t, uint64_t, 0, UINT64_MAX, UINT32_MAX)
+
+/* Matrix products must match the exact sums.  The shapes cover partial
+ * tiles, odd inner lengths and more than one accumulator block.  k 3 has
+ * pairs of _big * _big products (which wrap pmaddwd) brought back in range
+ * by a last product of 1 * -1. */
+#define T_GEMM(_m, _t, _rt, _rmin, _rmax, _big) \
+int T_gemm_##_m() { \
+  int r=1; \
+  static const size_t shape[][3] = { \
+    { 1, 1, 1 }, { 4, 8, 2 }, { 5, 9, 7 }, { 8, 16, 33 }, { 3, 20, 64 }, \
+    { 9, 13, 2051 }, { 0, 3, 3 }, { 3, 0, 3 }, { 3, 3, 0 } }; \
+  const _t edge[5] = { (_t) 0, (_t) 1, (_t) -1, \
+                       __sop(m)(smin)(_t), __sop(m)(smax)(_t) }; \
+  static _t a[9 * 2051], b[2051 * 13]; \
+  static _rt c[9 * 20]; \
+  __int128 ref; \
+  size_t s, i, j, p, m, n, kk; \
+  int k, ok, ref_ok, same; \
+  for (k = 0; k < 4; ++k) { \
+    for (s = 0; s < sizeof(shape) / sizeof(shape[0]); ++s) { \
+      m = shape[s][0]; \
+      n = shape[s][1]; \
+      kk = shape[s][2]; \
+      for (i = 0; i < m * kk; ++i) { \
+        a[i] = (_t) (k == 1 ? T_rand() : T_rand() % 200 - 100); \
+        if (k == 2) \
+          a[i] = T_PICK(edge); \
+        if (k == 3) \
+          a[i] = (i % kk == kk - 1) ? 1 : (_big); \
+      } \
+      for (i = 0; i < kk * n; ++i) { \
+        b[i] = (_t) (k == 1 ? T_rand() : T_rand() % 200 - 100); \
+        if (k == 2) \
+          b[i] = T_PICK(edge); \
+        if (k == 3) \
+          b[i] = (i / n == kk - 1) ? -1 : (_big); \
+      } \
+      ref_ok = 1; \
+      same = 1; \
+      memset(c, 0x5a, sizeof(c)); \
+      ok = sop_gemm_##_m(c, a, b, m, n, kk); \
+      for (i = 0; i < m; ++i) \
+        for (j = 0; j < n; ++j) { \
+          ref = 0; \
+          for (p = 0; p < kk; ++p) \
+            ref += (__int128) a[i * kk + p] * b[p * n + j]; \
+          if (ref < (_rmin) || ref > (_rmax)) \
+            ref_ok = 0; \
+          else if (c[i * n + j] != (_rt) ref) \
+            same = 0; \
+        } \
+      EXPECT_EQUAL(ok, ref_ok); \
+      EXPECT_EQUAL(sop_gemm_##_m(NULL, a, b, m, n, kk), ref_ok); \
+      if (ref_ok) \
+        EXPECT_TRUE(same); \
+    } \
+  } \
+  return r; \
+}
+
+T_GEMM(s16, int16_t, int32_t, INT32_MIN, INT32_MAX, INT16_MIN)
+T_GEMM(s32, int32_t, int64_t, INT64_MIN, INT64_MAX, INT32_MIN)
+
+/* Windows must always hold the exact sum of a model ring, and fail exactly
+ * when that sum would not fit.  k 0 stays within the bounds the window is
+ * proven for.  Out of bounds pushes must fail without changing the
+ * window. */
+#define T_WINDOW(_m, _type, _min, _max) \
+int T_window_##_m() { \
+  int r=1; \
+  enum { CAP = 7 }; \
+  _type buf[CAP], ring[CAP], lo, hi, v, got; \
+  const _type edge[3] = { (_min), 0, (_max) }; \
+  sop_window_##_m##_t w; \
+  size_t head, count, i; \
+  __int128 sum; \
+  int k, step, ok, ref_ok; \
+  EXPECT_TRUE(!sop_window_init_##_m(&w, buf, 0, 0, 1)); \
+  EXPECT_TRUE(!sop_window_init_##_m(&w, NULL, CAP, 0, 1)); \
+  EXPECT_TRUE(!sop_window_init_##_m(&w, buf, CAP, 1, 0)); \
+  for (k = 0; k < 3; ++k) { \
+    lo = (k == 0) ? (_type) ((_min) / CAP) : (_min); \
+    hi = (k == 0) ? (_type) ((_max) / CAP) : (_max); \
+    EXPECT_TRUE(sop_window_init_##_m(&w, buf, CAP, lo, hi)); \
+    EXPECT_EQUAL(w.proven, (k == 0)); \
+    head = count = 0; \
+    for (step = 0; step < 5000; ++step) { \
+      for (i = 0, sum = 0; i < count; ++i) \
+        sum += ring[(head + i) % CAP]; \
+      if (T_rand() % 3 == 0) { \
+        ref_ok = count > 0 && \
+                 sum - ring[head] >= (_min) && sum - ring[head] <= (_max); \
+        ok = sop_window_pop_##_m(&w, &got); \
+        EXPECT_EQUAL(ok, ref_ok); \
+        if (ok) { \
+          EXPECT_EQUAL(got, ring[head]); \
+          head = (head + 1) % CAP; \
+          --count; \
+        } \
+      } else { \
+        v = (_type) T_rand(); \
+        if (k == 0) \
+          v = (_type) (lo + (_type) (T_rand() % ((uint64_t) hi - lo + 1))); \
+        if (k == 2) \
+          v = T_PICK(edge); \
+        if (count == CAP) \
+          sum -= ring[head]; \
+        ref_ok = sum + v >= (_min) && sum + v <= (_max); \
+        ok = sop_window_push_##_m(&w, v); \
+        EXPECT_EQUAL(ok, ref_ok); \
+        if (ok && count == CAP) { \
+          ring[head] = v; \
+          head = (head + 1) % CAP; \
+        } else if (ok) { \
+          ring[(head + count++) % CAP] = v; \
+        } \
+      } \
+      for (i = 0, sum = 0; i < count; ++i) \
+        sum += ring[(head + i) % CAP]; \
+      EXPECT_EQUAL(w.count, count); \
+      EXPECT_TRUE(w.sum == (_type) sum); \
+      if (k == 0 && lo > (_min)) \
+        EXPECT_TRUE(!sop_window_push_##_m(&w, (_type) (lo - 1))); \
+      if (k == 0 && hi < (_max)) \
+        EXPECT_TRUE(!sop_window_push_##_m(&w, (_type) (hi + 1))); \
+    } \
+  } \
+  return r; \
+}
+
+T_WINDOW(u32, uint32_t, 0, UINT32_MAX)
+T_WINDOW(s32, int32_t, INT32_MIN, INT32_MAX)
+T_WINDOW(u64, uint64_t, 0, UINT64_MAX)
+T_WINDOW(s64, int64_t, INT64_MIN, INT64_MAX)
+
+/* Rounding helpers must match exact arithmetic, through both the markup
+ * and the GNU C interfaces.  Operands come from the limits, small values,
+ * powers of two and their neighbours and random values. */
+#define T_ROUND(_m, _type, _mk, _min, _max) \
+int T_round_##_m() { \
+  int r=1; \
+  _type v[64], x, y, got, got2; \
+  __int128 a, b, q, want; \
+  int i, j, n = 0, ok, ok2, ref_ok; \
+  T_EDGES(v, n, _type, _min, _max, -3, 9) \
+  for (i = 4; i < (int) sizeof(_type) * CHAR_BIT - 1; i += 5) { \
+    v[n++] = (_type) ((_type) 1 << i); \
+    v[n++] = (_type) (((_type) 1 << i) + 1); \
+    v[n++] = (_type) (((_type) 1 << i) - 1); \
+  } \
+  T_FILL(v, n, _type, 40) \
+  for (i = 0; i < n; ++i) { \
+    x = v[i]; \
+    a = x; \
+    for (want = 1; want < a; want *= 2) \
+      ; \
+    ref_ok = want <= (_max); \
+    got = got2 = 0; \
+    ok = sop_next_pow2x(_mk(&got), _mk(x)); \
+    ok2 = sop_next_pow2(&got2, x); \
+    EXPECT_EQUAL(ok, ref_ok); \
+    EXPECT_EQUAL(ok2, ref_ok); \
+    if (ref_ok) \
+      EXPECT_TRUE(got == (_type) want && got2 == (_type) want); \
+    for (j = 0; j < n; ++j) { \
+      y = v[j]; \
+      b = y; \
+      /* ceil_div */ \
+      ref_ok = b != 0; \
+      if (ref_ok) { \
+        q = a / b; \
+        if (a % b != 0 && (a < 0) == (b < 0)) \
+          ++q; \
+        ref_ok = q >= (_min) && q <= (_max); \
+      } \
+      ok = sop_ceil_divx(_mk(&got), _mk(x), _mk(y)); \
+      ok2 = sop_ceil_div(&got2, x, y); \
+      EXPECT_EQUAL(ok, ref_ok); \
+      EXPECT_EQUAL(ok2, ref_ok); \
+      if (ref_ok) \
+        EXPECT_TRUE(got == (_type) q && got2 == (_type) q); \
+      /* round_up_multiple and align_up */ \
+      ref_ok = b > 0; \
+      if (ref_ok) { \
+        q = a % b; \
+        want = a + (q > 0 ? b - q : -q); \
+        ref_ok = want <= (_max); \
+      } \
+      ok = sop_round_up_multiplex(_mk(&got), _mk(x), _mk(y)); \
+      ok2 = sop_round_up_multiple(&got2, x, y); \
+      EXPECT_EQUAL(ok, ref_ok); \
+      EXPECT_EQUAL(ok2, ref_ok); \
+      if (ref_ok) \
+        EXPECT_TRUE(got == (_type) want && got2 == (_type) want); \
+      if (b <= 0 || (b & (b - 1)) != 0) \
+        ref_ok = 0; \
+      ok = sop_align_upx(_mk(&got), _mk(x), _mk(y)); \
+      ok2 = sop_align_up(&got2, x, y); \
+      EXPECT_EQUAL(ok, ref_ok); \
+      EXPECT_EQUAL(ok2, ref_ok); \
+      if (ref_ok) \
+        EXPECT_TRUE(got == (_type) want && got2 == (_type) want); \
+    } \
+  } \
+  EXPECT_TRUE(sop_align_upx(NULL, _mk(x), _mk(1))); \
+  return r; \
+}
+
+T_ROUND(u8, uint8_t, sop_u8, 0, UINT8_MAX)
+T_ROUND(s8, int8_t, sop_s8, INT8_MIN, INT8_MAX)
+T_ROUND(u16, uint16_t, sop_u16, 0, UINT16_MAX)
+T_ROUND(s16, int16_t, sop_s16, INT16_MIN, INT16_MAX)
+T_ROUND(u32, uint32_t, sop_u32, 0, UINT32_MAX)
+T_ROUND(s32, int32_t, sop_s32, INT32_MIN, INT32_MAX)
+T_ROUND(u64, uint64_t, sop_u64, 0, UINT64_MAX)
+T_ROUND(s64, int64_t, sop_s64, INT64_MIN, INT64_MAX)
+T_ROUND(sizet, size_t, sop_szt, 0, SIZE_MAX)
+
+/* Negation, abs and absdiff against exact arithmetic.  abs and absdiff are
+ * checked into both the operand type and its unsigned twin _ut. */
+#define T_UNARY(_m, _type, _mk, _ut, _umk, _min, _max) \
+int T_unary_##_m() { \
+  int r=1; \
+  _type v[32], x, y, got, got2; \
+  _ut ugot, ugot2; \
+  __int128 a, want; \
+  int i, j, n = 0, ok, ok2, ref_ok; \
+  T_EDGES(v, n, _type, _min, _max, -3, 3) \
+  T_FILL(v, n, _type, 24) \
+  for (i = 0; i < n; ++i) { \
+    x = v[i]; \
+    a = x; \
+    ref_ok = -a >= (_min) && -a <= (_max); \
+    got = got2 = 1; \
+    ok = sop_negx(_mk(&got), _mk(x)); \
+    ok2 = sop_neg(&got2, x); \
+    EXPECT_EQUAL(ok, ref_ok); \
+    EXPECT_EQUAL(ok2, ref_ok); \
+    if (ref_ok) \
+      EXPECT_TRUE(got == (_type) -a && got2 == (_type) -a); \
+    want = a < 0 ? -a : a; \
+    ref_ok = want <= (_max); \
+    ok = sop_absx(_mk(&got), _mk(x)); \
+    ok2 = sop_abs(&got2, x); \
+    EXPECT_EQUAL(ok, ref_ok); \
+    EXPECT_EQUAL(ok2, ref_ok); \
+    if (ref_ok) \
+      EXPECT_TRUE(got == (_type) want && got2 == (_type) want); \
+    EXPECT_TRUE(sop_absx(_umk(&ugot), _mk(x)) && ugot == (_ut) want); \
+    EXPECT_EQUAL(sop_absx(NULL, _mk(x)), ref_ok); \
+    EXPECT_EQUAL(sop_abs(NULL, x), ref_ok); \
+    for (j = 0; j < n; ++j) { \
+      y = v[j]; \
+      want = a - y; \
+      if (want < 0) \
+        want = -want; \
+      ref_ok = want <= (_max); \
+      ok = sop_absdiffx(_mk(&got), _mk(x), _mk(y)); \
+      EXPECT_EQUAL(ok, ref_ok); \
+      if (ref_ok) \
+        EXPECT_TRUE(got == (_type) want); \
+      EXPECT_TRUE(sop_absdiffx(NULL, _mk(x), _mk(y)) == ref_ok && \
+                  sop_absdiff(NULL, x, y)); \
+      ugot = ugot2 = 0; \
+      ok = sop_absdiffx(_umk(&ugot), _mk(x), _mk(y)); \
+      ok2 = sop_absdiff(&ugot2, x, y); \
+      EXPECT_TRUE(ok && ok2 && ugot == (_ut) want && ugot2 == (_ut) want); \
+    } \
+  } \
+  EXPECT_EQUAL(sop_absdiffx(NULL, _mk(_min), _mk(_max)), (_min) == 0); \
+  EXPECT_FALSE(sop_absdiffx(_umk(&ugot), _mk(1), sop_s8(-1)) && \
+               (_type) -1 > 0); \
+  return r; \
+}
+
+T_UNARY(u8, uint8_t, sop_u8, uint8_t, sop_u8, 0, UINT8_MAX)
+T_UNARY(s8, int8_t, sop_s8, uint8_t, sop_u8, INT8_MIN, INT8_MAX)
+T_UNARY(u16, uint16_t, sop_u16, uint16_t, sop_u16, 0, UINT16_MAX)
+T_UNARY(s16, int16_t, sop_s16, uint16_t, sop_u16, INT16_MIN, INT16_MAX)
+T_UNARY(u32, uint32_t, sop_u32, uint32_t, sop_u32, 0, UINT32_MAX)
+T_UNARY(s32, int32_t, sop_s32, uint32_t, sop_u32, INT32_MIN, INT32_MAX)
+T_UNARY(u64, uint64_t, sop_u64, uint64_t, sop_u64, 0, UINT64_MAX)
+T_UNARY(s64, int64_t, sop_s64, uint64_t, sop_u64, INT64_MIN, INT64_MAX)
+T_UNARY(sl, long, sop_sl, unsigned long, sop_ul, LONG_MIN, LONG_MAX)
+
+/* muladd and mulsub must accept exactly the results that fit, including
+ * those whose product alone overflows. */
+#define T_MULADD(_m, _type, _mk, _min, _max) \
+int T_muladd_##_m() { \
+  int r=1; \
+  _type v[16], x, y, z, got, got2; \
+  __int128 want; \
+  int i, j, k, n = 0, ok, ok2, ref_ok, big; \
+  T_EDGES(v, n, _type, _min, _max, -2, 2) \
+  T_FILL(v, n, _type, 16) \
+  for (i = 0; i < n; ++i) \
+    for (j = 0; j < n; ++j) \
+      for (k = 0; k < n; ++k) { \
+        x = v[i]; y = v[j]; z = v[k]; \
+        /* u64 products can leave no headroom in __int128 for z, and \
+         * then nothing fits */ \
+        big = (_type) -1 > 0 && ((unsigned __int128) x * y) >> 126; \
+        want = big ? 0 : (__int128) x * y; \
+        ref_ok = !big && want + z >= (_min) && want + z <= (_max); \
+        ok = sop_muladdx(_mk(&got), _mk(x), _mk(y), _mk(z)); \
+        ok2 = sop_muladd(&got2, x, y, z); \
+        EXPECT_TRUE(ok == ref_ok && ok2 == ref_ok && \
+                    (!ref_ok || (got == (_type) (want + z) && \
+                                 got2 == (_type) (want + z)))); \
+        ref_ok = !big && want - z >= (_min) && want - z <= (_max); \
+        ok = sop_mulsubx(_mk(&got), _mk(x), _mk(y), _mk(z)); \
+        ok2 = sop_mulsub(&got2, x, y, z); \
+        EXPECT_TRUE(ok == ref_ok && ok2 == ref_ok && \
+                    (!ref_ok || (got == (_type) (want - z) && \
+                                 got2 == (_type) (want - z)))); \
+      } \
+  EXPECT_TRUE(sop_muladdx(NULL, _mk(3), _mk(4), _mk(5))); \
+  EXPECT_FALSE(sop_muladdx(_mk(&got), _mk(1), _mk(1), sop_s64(-1)) && \
+               (_type) -1 > 0); \
+  return r; \
+}
+
+T_MULADD(u8, uint8_t, sop_u8, 0, UINT8_MAX)
+T_MULADD(s8, int8_t, sop_s8, INT8_MIN, INT8_MAX)
+T_MULADD(u16, uint16_t, sop_u16, 0, UINT16_MAX)
+T_MULADD(s16, int16_t, sop_s16, INT16_MIN, INT16_MAX)
+T_MULADD(u32, uint32_t, sop_u32, 0, UINT32_MAX)
+T_MULADD(s32, int32_t, sop_s32, INT32_MIN, INT32_MAX)
+T_MULADD(u64, uint64_t, sop_u64, 0, UINT64_MAX)
+T_MULADD(s64, int64_t, sop_s64, INT64_MIN, INT64_MAX)
+T_MULADD(sizet, size_t, sop_szt, 0, SIZE_MAX)
+
+/* High halves through both interfaces, and full products, against
+ * unsigned __int128. */
+#define T_MULHI(_m, _type, _mk, _max) \
+int T_mulhi_##_m() { \
+  int r=1; \
+  _type v[24], x, y, got, got2; \
+  unsigned __int128 p; \
+  int i, j, n = 0; \
+  T_EDGES(v, n, _type, 0, _max, 0, 2) \
+  T_FILL(v, n, _type, 24) \
+  for (i = 0; i < n; ++i) \
+    for (j = 0; j < n; ++j) { \
+      x = v[i]; y = v[j]; \
+      p = (unsigned __int128) x * y; \
+      got = got2 = 0; \
+      EXPECT_TRUE(sop_mulhix(_mk(&got), _mk(x), _mk(y)) && \
+                  sop_mulhi(&got2, x, y) && \
+                  got == (_type) (p >> (sizeof(_type) * CHAR_BIT)) && \
+                  got2 == got); \
+    } \
+  EXPECT_FALSE(sop_mulhix(_mk(&got), _mk(1), sop_s8(-1))); \
+  EXPECT_TRUE(sop_mulhix(sop_s32(NULL), sop_s32(1), sop_s32(1))); \
+  return r; \
+}
+
+T_MULHI(u8, uint8_t, sop_u8, UINT8_MAX)
+T_MULHI(u16, uint16_t, sop_u16, UINT16_MAX)
+T_MULHI(u32, uint32_t, sop_u32, UINT32_MAX)
+T_MULHI(u64, uint64_t, sop_u64, UINT64_MAX)
+T_MULHI(sizet, size_t, sop_szt, SIZE_MAX)
+
+#define T_SMULHI(_m, _type, _mk, _min, _max) \
+int T_mulhi_##_m() { \
+  int r=1; \
+  _type v[24], x, y, got, got2; \
+  __int128 p; \
+  int i, j, n = 0; \
+  T_EDGES(v, n, _type, _min, _max, -1, 2) \
+  T_FILL(v, n, _type, 24) \
+  for (i = 0; i < n; ++i) \
+    for (j = 0; j < n; ++j) { \
+      x = v[i]; y = v[j]; \
+      p = (__int128) x * y; \
+      got = got2 = 0; \
+      EXPECT_TRUE(sop_mulhix(_mk(&got), _mk(x), _mk(y)) && \
+                  sop_mulhi(&got2, x, y) && \
+                  got == (_type) (p >> (sizeof(_type) * CHAR_BIT)) && \
+                  got2 == got); \
+    } \
+  EXPECT_FALSE(sop_mulhix(_mk(&got), _mk(1), sop_u64(UINT64_MAX))); \
+  return r; \
+}
+
+T_SMULHI(s8, int8_t, sop_s8, INT8_MIN, INT8_MAX)
+T_SMULHI(s16, int16_t, sop_s16, INT16_MIN, INT16_MAX)
+T_SMULHI(s32, int32_t, sop_s32, INT32_MIN, INT32_MAX)
+T_SMULHI(s64, int64_t, sop_s64, INT64_MIN, INT64_MAX)
+
+int T_mul_full() {
+  int r=1;
+  uint64_t v[24], hi, lo;
+  uint32_t hi32, lo32;
+  unsigned __int128 p;
+  int i, j, n = 0;
+  v[n++] = 0; v[n++] = 1; v[n++] = UINT64_MAX; v[n++] = UINT32_MAX;
+  v[n++] = (uint64_t) UINT32_MAX + 1;
+  while (n < 24)
+    v[n++] = T_rand64();
+  for (i = 0; i < n; ++i)
+    for (j = 0; j < n; ++j) {
+      p = (unsigned __int128) v[i] * v[j];
+      sop_mul_full_u64(&hi, &lo, v[i], v[j]);
+      EXPECT_TRUE(hi == (uint64_t) (p >> 64) && lo == (uint64_t) p);
+      p = (uint64_t) (uint32_t) v[i] * (uint32_t) v[j];
+      sop_mul_full_u32(&hi32, &lo32, (uint32_t) v[i], (uint32_t) v[j]);
+      EXPECT_TRUE(hi32 == (uint32_t) (p >> 32) && lo32 == (uint32_t) p);
+    }
+  sop_mul_full_u64(NULL, &lo, 3, 5);
+  EXPECT_EQUAL(lo, 15);
+  return r;
+}
+
+/* Rescales must give the exactly rounded quotient of the 128-bit product
+ * whenever it fits, including products sop_mul would reject.  k 2 uses
+ * small divisors so that many results fit. */
+int T_rescale_u64() {
+  int r=1;
+  const uint64_t edge[] = { 0, 1, 2, 3, 1000, UINT32_MAX, UINT64_MAX - 1,
+                            UINT64_MAX };
+  unsigned __int128 p, want;
+  uint64_t a, b, c, out;
+  int i, k, mode, ok, ref_ok;
+  for (i = 0; i < 3000; ++i) {
+    k = i % 3;
+    a = T_rand64();
+    b = T_rand64();
+    c = T_rand64();
+    if (k == 1) {
+      a = T_PICK(edge);
+      b = T_PICK(edge);
+      c = T_PICK(edge);
+    }
+    if (k == 2)
+      c = T_rand() % 100;
+    for (mode = SOP_ROUND_ZERO; mode <= SOP_ROUND_NEAREST; ++mode) {
+      p = (unsigned __int128) a * b;
+      ref_ok = (c != 0);
+      if (ref_ok) {
+        want = p / c;
+        if (p % c && (mode == SOP_ROUND_UP ||
+                      (mode == SOP_ROUND_NEAREST && 2 * (p % c) >= c)))
+          ++want;
+        ref_ok = (want <= UINT64_MAX);
+      }
+      out = 0;
+      ok = sop_rescale_u64(&out, a, b, c, (sop_round_t) mode);
+      EXPECT_EQUAL(ok, ref_ok);
+      if (ok)
+        EXPECT_TRUE(out == (uint64_t) want);
+      EXPECT_EQUAL(sop_rescale_u64(NULL, a, b, c, (sop_round_t) mode), ok);
+    }
+  }
+  EXPECT_TRUE(sop_rescale_u64(&out, 1ULL << 40, 1ULL << 40, 1ULL << 30,
+                              SOP_ROUND_ZERO));
+  EXPECT_TRUE(out == 1ULL << 50);
+  EXPECT_TRUE(!sop_rescale_u64(&out, 1, 1, 1, (sop_round_t) 4));
+  return r;
+}
+
+int T_rescale_s64() {
+  int r=1;
+  const int64_t edge[] = { 0, 1, -1, 2, -3, 1000, INT32_MIN, INT64_MIN,
+                           INT64_MIN + 1, INT64_MAX - 1, INT64_MAX };
+  __int128 p, want, rem;
+  int64_t a, b, c, out;
+  int i, k, mode, ok, ref_ok;
+  for (i = 0; i < 3000; ++i) {
+    k = i % 3;
+    a = (int64_t) T_rand64();
+    b = (int64_t) T_rand64();
+    c = (int64_t) T_rand64();
+    if (k == 1) {
+      a = T_PICK(edge);
+      b = T_PICK(edge);
+      c = T_PICK(edge);
+    }
+    if (k == 2)
+      c = (int64_t) (T_rand() % 200) - 100;
+    for (mode = SOP_ROUND_ZERO; mode <= SOP_ROUND_NEAREST; ++mode) {
+      p = (__int128) a * b;
+      ref_ok = (c != 0);
+      if (ref_ok) {
+        want = p / c;
+        rem = p % c;
+        if (rem && mode == SOP_ROUND_DOWN && (p < 0) != (c < 0))
+          --want;
+        if (rem && mode == SOP_ROUND_UP && (p < 0) == (c < 0))
+          ++want;
+        if (rem && mode == SOP_ROUND_NEAREST &&
+            2 * (rem < 0 ? -rem : rem) >= (c < 0 ? -(__int128) c : c))
+          want += ((p < 0) != (c < 0)) ? -1 : 1;
+        ref_ok = (want >= INT64_MIN && want <= INT64_MAX);
+      }
+      out = 0;
+      ok = sop_rescale_s64(&out, a, b, c, (sop_round_t) mode);
+      EXPECT_EQUAL(ok, ref_ok);
+      if (ok)
+        EXPECT_TRUE(out == (int64_t) want);
+      EXPECT_EQUAL(sop_rescale_s64(NULL, a, b, c, (sop_round_t) mode), ok);
+    }
+  }
+  EXPECT_TRUE(sop_rescale_s64(&out, -5, 1, 2, SOP_ROUND_NEAREST));
+  EXPECT_EQUAL(out, -3);
+  EXPECT_TRUE(sop_rescale_s64(&out, INT64_MIN, 1, 1, SOP_ROUND_ZERO));
+  EXPECT_TRUE(out == INT64_MIN);
+  EXPECT_TRUE(!sop_rescale_s64(&out, INT64_MIN, -1, 1, SOP_ROUND_ZERO));
+  return r;
+}
+#endif
+
+/* Fixed values for the double-width helpers.  None of these need a 128-bit
+ * type, so noint128_tests checks the fallbacks against them too.  muladd
+ * and dot rows avoid products and partial sums that only fit in 128 bits,
+ * since the fallbacks reject those. */
+int T_mul_full_fixed() {
+  int r=1;
+  static const struct { uint64_t a, b, hi, lo; } v[] = {
+    { UINT64_MAX, UINT64_MAX, UINT64_MAX - 1, 1 },
+    { UINT64_MAX, 2, 1, UINT64_MAX - 1 },
+    { 0x8000000000000000ULL, 2, 1, 0 },
+    { 0x123456789abcdef0ULL, 0xfedcba9876543210ULL,
+      0x121fa00ad77d7422ULL, 0x236d88fe5618cf00ULL },
+    { 0xffffffffULL, 0x100000001ULL, 0, UINT64_MAX },
+    { 0xffffffff00000000ULL, 0xffffffffULL, 0xfffffffeULL, 0x100000000ULL },
+  };
+  uint64_t hi, lo;
+  uint32_t hi32, lo32;
+  size_t i;
+  for (i = 0; i < sizeof(v) / sizeof(v[0]); ++i) {
+    sop_mul_full_u64(&hi, &lo, v[i].a, v[i].b);
+    EXPECT_TRUE(hi == v[i].hi && lo == v[i].lo);
+    hi = 0;
+    EXPECT_TRUE(sop_mulhix(sop_u64(&hi), sop_u64(v[i].a), sop_u64(v[i].b)));
+    EXPECT_TRUE(hi == v[i].hi);
+  }
+  sop_mul_full_u32(&hi32, &lo32, UINT32_MAX, UINT32_MAX);
+  EXPECT_TRUE(hi32 == UINT32_MAX - 1 && lo32 == 1);
+  return r;
+}
+
+int T_mulhi_fixed() {
+  int r=1;
+  static const struct { int64_t a, b, hi; } v[] = {
+    { INT64_MIN, INT64_MIN, 0x4000000000000000LL },
+    { INT64_MIN, -1, 0 },
+    { INT64_MIN, INT64_MAX, -0x4000000000000000LL },
+    { INT64_MAX, INT64_MAX, 0x3fffffffffffffffLL },
+    { -1, -1, 0 },
+    { -1, 1, -1 },
+    { -3, 2, -1 },
+    { -0x123456789abcdefLL, 0x7edcba9876543210LL, -40628384478392395LL },
+  };
+  int64_t hi;
+  size_t i;
+  for (i = 0; i < sizeof(v) / sizeof(v[0]); ++i) {
+    hi = 0x5a;
+    EXPECT_TRUE(sop_mulhix(sop_s64(&hi), sop_s64(v[i].a), sop_s64(v[i].b)));
+    EXPECT_TRUE(hi == v[i].hi);
+  }
+  return r;
+}
+
+int T_rescale_fixed() {
+  int r=1;
+  static const struct {
+    uint64_t a, b, c; sop_round_t mode; int ok; uint64_t out;
+  } u[] = {
+    { UINT64_MAX, UINT64_MAX, UINT64_MAX, SOP_ROUND_ZERO, 1, UINT64_MAX },
+    { UINT64_MAX, UINT64_MAX - 1, UINT64_MAX, SOP_ROUND_UP, 1,
+      UINT64_MAX - 1 },
+    { 0x8000000000000000ULL, 6, 4, SOP_ROUND_ZERO, 1, 0xc000000000000000ULL },
+    { UINT64_MAX, 3, 2, SOP_ROUND_ZERO, 0, 0 },
+    { UINT64_MAX, 3, 7, SOP_ROUND_NEAREST, 1, 0x6db6db6db6db6db6ULL },
+    { 0x123456789abcdef0ULL, 0xfedcba9876543210ULL, 0xfedcba9876543211ULL,
+      SOP_ROUND_DOWN, 1, 0x123456789abcdeefULL },
+    { 0x123456789abcdef0ULL, 0xfedcba9876543210ULL, 0xfedcba9876543211ULL,
+      SOP_ROUND_UP, 1, 0x123456789abcdef0ULL },
+    { 10, 10, 3, SOP_ROUND_NEAREST, 1, 33 },
+    { 1ULL << 40, 1ULL << 40, 1, SOP_ROUND_ZERO, 0, 0 },
+  };
+  static const struct {
+    int64_t a, b, c; sop_round_t mode; int ok; int64_t out;
+  } s[] = {
+    { INT64_MIN, INT64_MIN, INT64_MIN, SOP_ROUND_ZERO, 1, INT64_MIN },
+    { INT64_MIN, INT64_MAX, INT64_MAX, SOP_ROUND_ZERO, 1, INT64_MIN },
+    { INT64_MIN, -1, 1, SOP_ROUND_ZERO, 0, 0 },
+    { INT64_MIN, -1, -2, SOP_ROUND_ZERO, 1, -0x4000000000000000LL },
+    { INT64_MAX, -3, 8, SOP_ROUND_ZERO, 1, -3458764513820540927LL },
+    { INT64_MAX, -3, 8, SOP_ROUND_DOWN, 1, -3458764513820540928LL },
+    { INT64_MAX, -3, 8, SOP_ROUND_UP, 1, -3458764513820540927LL },
+    { INT64_MAX, -3, 8, SOP_ROUND_NEAREST, 1, -3458764513820540928LL },
+    { -0x123456789abcdef0LL, 0x7edcba9876543210LL, -0x7edcba9876543211LL,
+      SOP_ROUND_NEAREST, 1, 0x123456789abcdef0LL },
+    { -7, 3, -2, SOP_ROUND_DOWN, 1, 10 },
+    { -7, 3, -2, SOP_ROUND_UP, 1, 11 },
+    { INT64_MAX, INT64_MAX, 2, SOP_ROUND_ZERO, 0, 0 },
+  };
+  uint64_t uout;
+  int64_t sout;
+  size_t i;
+  for (i = 0; i < sizeof(u) / sizeof(u[0]); ++i) {
+    uout = 0x5a;
+    EXPECT_EQUAL(sop_rescale_u64(&uout, u[i].a, u[i].b, u[i].c, u[i].mode),
+                 u[i].ok);
+    EXPECT_TRUE(uout == (u[i].ok ? u[i].out : 0x5a));
+  }
+  for (i = 0; i < sizeof(s) / sizeof(s[0]); ++i) {
+    sout = 0x5a;
+    EXPECT_EQUAL(sop_rescale_s64(&sout, s[i].a, s[i].b, s[i].c, s[i].mode),
+                 s[i].ok);
+    EXPECT_TRUE(sout == (s[i].ok ? s[i].out : 0x5a));
+  }
+  return r;
+}
+
+int T_muladd_fixed() {
+  int r=1;
+  static const struct {
+    uint64_t a, b, c; int add_ok; uint64_t add; int sub_ok; uint64_t sub;
+  } u[] = {
+    { 0xffffffffULL, 0xffffffffULL, 0x1fffffffeULL,
+      1, UINT64_MAX, 1, 0xfffffffc00000003ULL },
+    { 0xffffffffULL, 0xffffffffULL, 0x1ffffffffULL,
+      0, 0, 1, 0xfffffffc00000002ULL },
+    { UINT64_MAX, 1, 0, 1, UINT64_MAX, 1, UINT64_MAX },
+    { UINT64_MAX, 1, 1, 0, 0, 1, UINT64_MAX - 1 },
+    { 1ULL << 62, 4, 0, 0, 0, 0, 0 },
+    { 3, 5, 16, 1, 31, 0, 0 },
+  };
+  static const struct {
+    int64_t a, b, c; int add_ok; int64_t add; int sub_ok; int64_t sub;
+  } s[] = {
+    { INT64_MIN, 1, -1, 0, 0, 1, INT64_MIN + 1 },
+    { -0x80000000LL, 0x100000000LL, 0, 1, INT64_MIN, 1, INT64_MIN },
+    { -0x80000000LL, 0x100000000LL, 1, 1, INT64_MIN + 1, 0, 0 },
+    { 0x7fffffffLL, 0x7fffffffLL, INT64_MAX,
+      0, 0, 1, -4611686022722355198LL },
+    { -3, 5, 2, 1, -13, 1, -17 },
+  };
+  uint64_t uout;
+  int64_t sout;
+  size_t i;
+  for (i = 0; i < sizeof(u) / sizeof(u[0]); ++i) {
+    uout = 0x5a;
+    EXPECT_EQUAL(sop_muladdx(sop_u64(&uout), sop_u64(u[i].a), sop_u64(u[i].b),
+                             sop_u64(u[i].c)), u[i].add_ok);
+    EXPECT_TRUE(uout == (u[i].add_ok ? u[i].add : 0x5a));
+    uout = 0x5a;
+    EXPECT_EQUAL(sop_mulsubx(sop_u64(&uout), sop_u64(u[i].a), sop_u64(u[i].b),
+                             sop_u64(u[i].c)), u[i].sub_ok);
+    EXPECT_TRUE(uout == (u[i].sub_ok ? u[i].sub : 0x5a));
+  }
+  for (i = 0; i < sizeof(s) / sizeof(s[0]); ++i) {
+    sout = 0x5a;
+    EXPECT_EQUAL(sop_muladdx(sop_s64(&sout), sop_s64(s[i].a), sop_s64(s[i].b),
+                             sop_s64(s[i].c)), s[i].add_ok);
+    EXPECT_TRUE(sout == (s[i].add_ok ? s[i].add : 0x5a));
+    sout = 0x5a;
+    EXPECT_EQUAL(sop_mulsubx(sop_s64(&sout), sop_s64(s[i].a), sop_s64(s[i].b),
+                             sop_s64(s[i].c)), s[i].sub_ok);
+    EXPECT_TRUE(sout == (s[i].sub_ok ? s[i].sub : 0x5a));
+  }
+  return r;
+}
+
+/* Long enough for the vector blocks; every partial sum fits. */
+int T_dot_fixed() {
+  int r=1;
+  enum { N = 37 };
+  int32_t a32[N], b32[N];
+  uint32_t ua[N], ub[N];
+  int64_t s64, want = 0;
+  uint64_t u64;
+  size_t i;
+  for (i = 0; i < N; ++i) {
+    a32[i] = (i % 3) ? INT32_MAX : INT32_MIN;
+    b32[i] = (i % 2) ? 1 - (int32_t) i : (int32_t) i;
+    want += (int64_t) a32[i] * b32[i];
+    ua[i] = UINT32_MAX;
+    ub[i] = 1;
+  }
+  EXPECT_TRUE(sop_dot_s32(&s64, a32, b32, N));
+  EXPECT_TRUE(s64 == want);
+  for (i = 0; i < N; ++i)
+    a32[i] = b32[i] = INT32_MIN;
+  EXPECT_TRUE(sop_dot_s32(&s64, a32, b32, 1));
+  EXPECT_TRUE(s64 == 0x4000000000000000LL);
+  EXPECT_FALSE(sop_dot_s32(&s64, a32, b32, 2));
+  EXPECT_FALSE(sop_dot_s32(NULL, a32, b32, N));
+  EXPECT_TRUE(sop_dot_u32(&u64, ua, ub, N));
+  EXPECT_TRUE(u64 == (uint64_t) UINT32_MAX * N);
+  ub[0] = UINT32_MAX;
+  EXPECT_TRUE(sop_dot_u32(&u64, ua, ub, 1));
+  EXPECT_TRUE(u64 == 0xfffffffe00000001ULL);
+  ub[1] = UINT32_MAX;
+  EXPECT_FALSE(sop_dot_u32(&u64, ua, ub, N));
+  EXPECT_TRUE(u64 == 0xfffffffe00000001ULL);
+  return r;
+}
+
+int T_neg_s8() {
+  int r=1;
+  int8_t a, c;
+  a=SCHAR_MIN; EXPECT_FALSE(sop_negx(sop_s8(&c), sop_s8(a)));
+  a=SCHAR_MIN+1; EXPECT_TRUE(sop_negx(sop_s8(&c), sop_s8(a)) && c == SCHAR_MAX);
+  a=-1; EXPECT_TRUE(sop_negx(sop_s8(&c), sop_s8(a)) && c == 1);
+  a=0; EXPECT_TRUE(sop_negx(sop_s8(&c), sop_s8(a)) && c == 0);
+  return r;
+}
+
+int T_neg_u32() {
+  int r=1;
+  uint32_t a, c;
+  a=0; EXPECT_TRUE(sop_negx(sop_u32(&c), sop_u32(a)) && c == 0);
+  a=1; EXPECT_FALSE(sop_negx(sop_u32(&c), sop_u32(a)));
+  a=UINT_MAX; EXPECT_FALSE(sop_negx(sop_u32(&c), sop_u32(a)));
+  return r;
+}
+
+int T_abs_s64() {
+  int r=1;
+  int64_t a, c;
+  uint64_t u;
+  a=SAFE_INT64_MIN; EXPECT_FALSE(sop_absx(sop_s64(&c), sop_s64(a)));
+  a=SAFE_INT64_MIN; EXPECT_TRUE(sop_absx(sop_u64(&u), sop_s64(a)) &&
+                                u == 0x8000000000000000ULL);
+  a=SAFE_INT64_MIN+1; EXPECT_TRUE(sop_absx(sop_s64(&c), sop_s64(a)) &&
+                                  c == SAFE_INT64_MAX);
+  a=-5; EXPECT_TRUE(sop_absx(sop_s64(&c), sop_s64(a)) && c == 5);
+  return r;
+}
+
+int T_absdiff_s32() {
+  int r=1;
+  int32_t a, b, c;
+  uint32_t u;
+  a=INT_MIN; b=INT_MAX; EXPECT_FALSE(sop_absdiffx(sop_s32(&c), sop_s32(a), sop_s32(b)));
+  a=INT_MIN; b=INT_MAX; EXPECT_TRUE(sop_absdiffx(sop_u32(&u), sop_s32(a), sop_s32(b)) && u == UINT_MAX);
+  a=INT_MAX; b=-1; EXPECT_FALSE(sop_absdiffx(sop_s32(&c), sop_s32(a), sop_s32(b)));
+  a=INT_MAX; b=0; EXPECT_TRUE(sop_absdiffx(sop_s32(&c), sop_s32(a), sop_s32(b)) && c == INT_MAX);
+  a=-3; b=4; EXPECT_TRUE(sop_absdiffx(sop_s32(&c), sop_s32(a), sop_s32(b)) && c == 7);
+  return r;
+}
+
+int T_absdiff_u8() {
+  int r=1;
+  uint8_t a, b, c;
+  a=0; b=UCHAR_MAX; EXPECT_TRUE(sop_absdiffx(sop_u8(&c), sop_u8(a), sop_u8(b)) && c == UCHAR_MAX);
+  a=200; b=10; EXPECT_TRUE(sop_absdiffx(sop_u8(&c), sop_u8(a), sop_u8(b)) && c == 190);
+  a=10; b=200; EXPECT_TRUE(sop_absdiffx(sop_u8(&c), sop_u8(a), sop_u8(b)) && c == 190);
+  return r;
+}
+
+int T_ceil_div_s32() {
+  int r=1;
+  int32_t a, b, c;
+  a=7; b=2; EXPECT_TRUE(sop_ceil_divx(sop_s32(&c), sop_s32(a), sop_s32(b)) && c == 4);
+  a=-7; b=2; EXPECT_TRUE(sop_ceil_divx(sop_s32(&c), sop_s32(a), sop_s32(b)) && c == -3);
+  a=-7; b=-2; EXPECT_TRUE(sop_ceil_divx(sop_s32(&c), sop_s32(a), sop_s32(b)) && c == 4);
+  a=INT_MIN; b=-1; EXPECT_FALSE(sop_ceil_divx(sop_s32(&c), sop_s32(a), sop_s32(b)));
+  a=INT_MAX; b=0; EXPECT_FALSE(sop_ceil_divx(sop_s32(&c), sop_s32(a), sop_s32(b)));
+  a=INT_MAX; b=2; EXPECT_TRUE(sop_ceil_divx(sop_s32(&c), sop_s32(a), sop_s32(b)) && c == INT_MAX/2+1);
+  return r;
+}
+
+int T_align_up_u8() {
+  int r=1;
+  uint8_t a, b, c;
+  a=248; b=8; EXPECT_TRUE(sop_align_upx(sop_u8(&c), sop_u8(a), sop_u8(b)) && c == 248);
+  a=249; b=8; EXPECT_FALSE(sop_align_upx(sop_u8(&c), sop_u8(a), sop_u8(b)));
+  a=UCHAR_MAX; b=1; EXPECT_TRUE(sop_align_upx(sop_u8(&c), sop_u8(a), sop_u8(b)) && c == UCHAR_MAX);
+  a=3; b=6; EXPECT_FALSE(sop_align_upx(sop_u8(&c), sop_u8(a), sop_u8(b)));
+  a=0; b=128; EXPECT_TRUE(sop_align_upx(sop_u8(&c), sop_u8(a), sop_u8(b)) && c == 0);
+  a=1; b=128; EXPECT_TRUE(sop_align_upx(sop_u8(&c), sop_u8(a), sop_u8(b)) && c == 128);
+  return r;
+}
+
+int T_round_up_multiple_u16() {
+  int r=1;
+  uint16_t a, b, c;
+  a=USHRT_MAX; b=3; EXPECT_TRUE(sop_round_up_multiplex(sop_u16(&c), sop_u16(a), sop_u16(b)) && c == USHRT_MAX);
+  a=USHRT_MAX; b=2; EXPECT_FALSE(sop_round_up_multiplex(sop_u16(&c), sop_u16(a), sop_u16(b)));
+  a=65530; b=7; EXPECT_TRUE(sop_round_up_multiplex(sop_u16(&c), sop_u16(a), sop_u16(b)) && c == 65534);
+  a=10; b=0; EXPECT_FALSE(sop_round_up_multiplex(sop_u16(&c), sop_u16(a), sop_u16(b)));
+  return r;
+}
+
+int T_next_pow2_u64() {
+  int r=1;
+  uint64_t a, c;
+  a=0; EXPECT_TRUE(sop_next_pow2x(sop_u64(&c), sop_u64(a)) && c == 1);
+  a=3; EXPECT_TRUE(sop_next_pow2x(sop_u64(&c), sop_u64(a)) && c == 4);
+  a=1ULL<<63; EXPECT_TRUE(sop_next_pow2x(sop_u64(&c), sop_u64(a)) && c == a);
+  a=(1ULL<<63)+1; EXPECT_FALSE(sop_next_pow2x(sop_u64(&c), sop_u64(a)));
+  return r;
+}
 
+int T_mulsub_u32() {
+  int r=1;
+  uint32_t a, b, x, c;
+  a=65536; b=65536; x=1; EXPECT_TRUE(sop_mulsubx(sop_u32(&c), sop_u32(a), sop_u32(b), sop_u32(x)) && c == UINT_MAX);
+  a=2; b=3; x=7; EXPECT_FALSE(sop_mulsubx(sop_u32(&c), sop_u32(a), sop_u32(b), sop_u32(x)));
+  a=0; b=0; x=0; EXPECT_TRUE(sop_mulsubx(sop_u32(&c), sop_u32(a), sop_u32(b), sop_u32(x)) && c == 0);
+  return r;
+}
 
+int T_mulsub_s8() {
+  int r=1;
+  int8_t a, b, x, c;
+  a=SCHAR_MIN; b=-1; x=1; EXPECT_TRUE(sop_mulsubx(sop_s8(&c), sop_s8(a), sop_s8(b), sop_s8(x)) && c == SCHAR_MAX);
+  a=SCHAR_MIN; b=1; x=1; EXPECT_FALSE(sop_mulsubx(sop_s8(&c), sop_s8(a), sop_s8(b), sop_s8(x)));
+  a=-3; b=5; x=-15; EXPECT_TRUE(sop_mulsubx(sop_s8(&c), sop_s8(a), sop_s8(b), sop_s8(x)) && c == 0);
+  return r;
+}
 
 /***** MISC *****/
 
@@ -2358,6 +4020,14 @@ int T_speed() {
 int main(int argc, char **argv) {
   /* test inlines */
   int tests = 0, succ = 0, fail = 0;
+#if defined(__AVX2__) && defined(__GNUC__) && defined(__x86_64__)
+  /* avx2_tests is built with -mavx2 and cannot run without it. */
+  __builtin_cpu_init();
+  if (!__builtin_cpu_supports("avx2")) {
+    printf("CPU lacks AVX2, skipping\n");
+    return 0;
+  }
+#endif
   tests++; if (T_shr_s8())  succ++; else fail++;
   tests++; if (T_shr_s16()) succ++; else fail++;
   tests++; if (T_shr_s32()) succ++; else fail++;
@@ -2502,6 +4172,198 @@ int main(int argc, char **argv) {
   tests++; if (T_iopf_add_u8u8s8()) succ++; else fail++;
   tests++; if (T_iopf_add_s8u8u8()) succ++; else fail++;
   tests++; if (T_iopf_mixed_s16u8u64()) succ++; else fail++;
+  tests++; if (T_iopf_precedence()) succ++; else fail++;
+  tests++; if (T_iopf_wide()) succ++; else fail++;
+  tests++; if (T_iopf_result_type()) succ++; else fail++;
+  tests++; if (T_iopf_batch()) succ++; else fail++;
+
+  tests++; if (T_add_array_u8()) succ++; else fail++;
+  tests++; if (T_add_array_s8()) succ++; else fail++;
+  tests++; if (T_add_array_u16()) succ++; else fail++;
+  tests++; if (T_add_array_s16()) succ++; else fail++;
+  tests++; if (T_add_array_u32()) succ++; else fail++;
+  tests++; if (T_add_array_s32()) succ++; else fail++;
+  tests++; if (T_add_array_u64()) succ++; else fail++;
+  tests++; if (T_add_array_s64()) succ++; else fail++;
+  tests++; if (T_sub_array_u8()) succ++; else fail++;
+  tests++; if (T_sub_array_s8()) succ++; else fail++;
+  tests++; if (T_sub_array_u16()) succ++; else fail++;
+  tests++; if (T_sub_array_s16()) succ++; else fail++;
+  tests++; if (T_sub_array_u32()) succ++; else fail++;
+  tests++; if (T_sub_array_s32()) succ++; else fail++;
+  tests++; if (T_sub_array_u64()) succ++; else fail++;
+  tests++; if (T_sub_array_s64()) succ++; else fail++;
+  tests++; if (T_mul_array_u8()) succ++; else fail++;
+  tests++; if (T_mul_array_s8()) succ++; else fail++;
+  tests++; if (T_mul_array_u16()) succ++; else fail++;
+  tests++; if (T_mul_array_s16()) succ++; else fail++;
+  tests++; if (T_mul_array_u32()) succ++; else fail++;
+  tests++; if (T_mul_array_s32()) succ++; else fail++;
+  tests++; if (T_mul_array_u64()) succ++; else fail++;
+  tests++; if (T_mul_array_s64()) succ++; else fail++;
+  tests++; if (T_sum_u8()) succ++; else fail++;
+  tests++; if (T_sum_s8()) succ++; else fail++;
+  tests++; if (T_sum_u16()) succ++; else fail++;
+  tests++; if (T_sum_s16()) succ++; else fail++;
+  tests++; if (T_sum_u32()) succ++; else fail++;
+  tests++; if (T_sum_s32()) succ++; else fail++;
+  tests++; if (T_sum_u64()) succ++; else fail++;
+  tests++; if (T_sum_s64()) succ++; else fail++;
+  tests++; if (T_exclusive_scan_u32()) succ++; else fail++;
+  tests++; if (T_exclusive_scan_u64()) succ++; else fail++;
+  tests++; if (T_exclusive_scan_size_t()) succ++; else fail++;
+  tests++; if (T_group_sum_u64()) succ++; else fail++;
+  tests++; if (T_parallel_sum_u8()) succ++; else fail++;
+  tests++; if (T_parallel_sum_s8()) succ++; else fail++;
+  tests++; if (T_parallel_sum_u16()) succ++; else fail++;
+  tests++; if (T_parallel_sum_s16()) succ++; else fail++;
+  tests++; if (T_parallel_sum_u32()) succ++; else fail++;
+  tests++; if (T_parallel_sum_s32()) succ++; else fail++;
+  tests++; if (T_parallel_sum_u64()) succ++; else fail++;
+  tests++; if (T_parallel_sum_s64()) succ++; else fail++;
+  tests++; if (T_parallel_exclusive_scan_u32()) succ++; else fail++;
+  tests++; if (T_parallel_exclusive_scan_u64()) succ++; else fail++;
+  tests++; if (T_parallel_exclusive_scan_size_t()) succ++; else fail++;
+  tests++; if (T_narrow_array_u8_to_s8()) succ++; else fail++;
+  tests++; if (T_narrow_array_s8_to_u8()) succ++; else fail++;
+  tests++; if (T_narrow_array_s8_to_u16()) succ++; else fail++;
+  tests++; if (T_narrow_array_s8_to_u32()) succ++; else fail++;
+  tests++; if (T_narrow_array_s8_to_u64()) succ++; else fail++;
+  tests++; if (T_narrow_array_u16_to_u8()) succ++; else fail++;
+  tests++; if (T_narrow_array_u16_to_s8()) succ++; else fail++;
+  tests++; if (T_narrow_array_u16_to_s16()) succ++; else fail++;
+  tests++; if (T_narrow_array_s16_to_u8()) succ++; else fail++;
+  tests++; if (T_narrow_array_s16_to_s8()) succ++; else fail++;
+  tests++; if (T_narrow_array_s16_to_u16()) succ++; else fail++;
+  tests++; if (T_narrow_array_s16_to_u32()) succ++; else fail++;
+  tests++; if (T_narrow_array_s16_to_u64()) succ++; else fail++;
+  tests++; if (T_narrow_array_u32_to_u8()) succ++; else fail++;
+  tests++; if (T_narrow_array_u32_to_s8()) succ++; else fail++;
+  tests++; if (T_narrow_array_u32_to_u16()) succ++; else fail++;
+  tests++; if (T_narrow_array_u32_to_s16()) succ++; else fail++;
+  tests++; if (T_narrow_array_u32_to_s32()) succ++; else fail++;
+  tests++; if (T_narrow_array_s32_to_u8()) succ++; else fail++;
+  tests++; if (T_narrow_array_s32_to_s8()) succ++; else fail++;
+  tests++; if (T_narrow_array_s32_to_u16()) succ++; else fail++;
+  tests++; if (T_narrow_array_s32_to_s16()) succ++; else fail++;
+  tests++; if (T_narrow_array_s32_to_u32()) succ++; else fail++;
+  tests++; if (T_narrow_array_s32_to_u64()) succ++; else fail++;
+  tests++; if (T_narrow_array_u64_to_u8()) succ++; else fail++;
+  tests++; if (T_narrow_array_u64_to_s8()) succ++; else fail++;
+  tests++; if (T_narrow_array_u64_to_u16()) succ++; else fail++;
+  tests++; if (T_narrow_array_u64_to_s16()) succ++; else fail++;
+  tests++; if (T_narrow_array_u64_to_u32()) succ++; else fail++;
+  tests++; if (T_narrow_array_u64_to_s32()) succ++; else fail++;
+  tests++; if (T_narrow_array_u64_to_s64()) succ++; else fail++;
+  tests++; if (T_narrow_array_s64_to_u8()) succ++; else fail++;
+  tests++; if (T_narrow_array_s64_to_s8()) succ++; else fail++;
+  tests++; if (T_narrow_array_s64_to_u16()) succ++; else fail++;
+  tests++; if (T_narrow_array_s64_to_s16()) succ++; else fail++;
+  tests++; if (T_narrow_array_s64_to_u32()) succ++; else fail++;
+  tests++; if (T_narrow_array_s64_to_s32()) succ++; else fail++;
+  tests++; if (T_narrow_array_s64_to_u64()) succ++; else fail++;
+  tests++; if (T_add_sat_array_u8()) succ++; else fail++;
+  tests++; if (T_add_sat_array_s8()) succ++; else fail++;
+  tests++; if (T_add_sat_array_u16()) succ++; else fail++;
+  tests++; if (T_add_sat_array_s16()) succ++; else fail++;
+  tests++; if (T_sub_sat_array_u8()) succ++; else fail++;
+  tests++; if (T_sub_sat_array_s8()) succ++; else fail++;
+  tests++; if (T_sub_sat_array_u16()) succ++; else fail++;
+  tests++; if (T_sub_sat_array_s16()) succ++; else fail++;
+  tests++; if (T_mul_sat_array_u8()) succ++; else fail++;
+  tests++; if (T_mul_sat_array_s8()) succ++; else fail++;
+  tests++; if (T_mul_sat_array_u16()) succ++; else fail++;
+  tests++; if (T_mul_sat_array_s16()) succ++; else fail++;
+  tests++; if (T_v_u8x16()) succ++; else fail++;
+  tests++; if (T_v_s8x16()) succ++; else fail++;
+  tests++; if (T_v_u16x8()) succ++; else fail++;
+  tests++; if (T_v_s16x8()) succ++; else fail++;
+  tests++; if (T_v_u32x4()) succ++; else fail++;
+  tests++; if (T_v_s32x4()) succ++; else fail++;
+  tests++; if (T_v_u64x2()) succ++; else fail++;
+  tests++; if (T_v_s64x2()) succ++; else fail++;
+  tests++; if (T_v_u8x32()) succ++; else fail++;
+  tests++; if (T_v_s8x32()) succ++; else fail++;
+  tests++; if (T_v_u16x16()) succ++; else fail++;
+  tests++; if (T_v_s16x16()) succ++; else fail++;
+  tests++; if (T_v_u32x8()) succ++; else fail++;
+  tests++; if (T_v_s32x8()) succ++; else fail++;
+  tests++; if (T_v_u64x4()) succ++; else fail++;
+  tests++; if (T_v_s64x4()) succ++; else fail++;
+  tests++; if (T_v_u8x64()) succ++; else fail++;
+  tests++; if (T_v_s8x64()) succ++; else fail++;
+  tests++; if (T_v_u16x32()) succ++; else fail++;
+  tests++; if (T_v_s16x32()) succ++; else fail++;
+  tests++; if (T_v_u32x16()) succ++; else fail++;
+  tests++; if (T_v_s32x16()) succ++; else fail++;
+  tests++; if (T_v_u64x8()) succ++; else fail++;
+  tests++; if (T_v_s64x8()) succ++; else fail++;
+#if defined(__SIZEOF_INT128__)
+  tests++; if (T_dot_s16()) succ++; else fail++;
+  tests++; if (T_dot_s32()) succ++; else fail++;
+  tests++; if (T_dot_u32()) succ++; else fail++;
+  tests++; if (T_gemm_s16()) succ++; else fail++;
+  tests++; if (T_gemm_s32()) succ++; else fail++;
+  tests++; if (T_window_u32()) succ++; else fail++;
+  tests++; if (T_window_s32()) succ++; else fail++;
+  tests++; if (T_window_u64()) succ++; else fail++;
+  tests++; if (T_window_s64()) succ++; else fail++;
+  tests++; if (T_rescale_u64()) succ++; else fail++;
+  tests++; if (T_rescale_s64()) succ++; else fail++;
+  tests++; if (T_round_u8()) succ++; else fail++;
+  tests++; if (T_round_s8()) succ++; else fail++;
+  tests++; if (T_round_u16()) succ++; else fail++;
+  tests++; if (T_round_s16()) succ++; else fail++;
+  tests++; if (T_round_u32()) succ++; else fail++;
+  tests++; if (T_round_s32()) succ++; else fail++;
+  tests++; if (T_round_u64()) succ++; else fail++;
+  tests++; if (T_round_s64()) succ++; else fail++;
+  tests++; if (T_round_sizet()) succ++; else fail++;
+  tests++; if (T_unary_u8()) succ++; else fail++;
+  tests++; if (T_unary_s8()) succ++; else fail++;
+  tests++; if (T_unary_u16()) succ++; else fail++;
+  tests++; if (T_unary_s16()) succ++; else fail++;
+  tests++; if (T_unary_u32()) succ++; else fail++;
+  tests++; if (T_unary_s32()) succ++; else fail++;
+  tests++; if (T_unary_u64()) succ++; else fail++;
+  tests++; if (T_unary_s64()) succ++; else fail++;
+  tests++; if (T_unary_sl()) succ++; else fail++;
+  tests++; if (T_muladd_u8()) succ++; else fail++;
+  tests++; if (T_muladd_s8()) succ++; else fail++;
+  tests++; if (T_muladd_u16()) succ++; else fail++;
+  tests++; if (T_muladd_s16()) succ++; else fail++;
+  tests++; if (T_muladd_u32()) succ++; else fail++;
+  tests++; if (T_muladd_s32()) succ++; else fail++;
+  tests++; if (T_muladd_u64()) succ++; else fail++;
+  tests++; if (T_muladd_s64()) succ++; else fail++;
+  tests++; if (T_muladd_sizet()) succ++; else fail++;
+  tests++; if (T_mulhi_u8()) succ++; else fail++;
+  tests++; if (T_mulhi_u16()) succ++; else fail++;
+  tests++; if (T_mulhi_u32()) succ++; else fail++;
+  tests++; if (T_mulhi_u64()) succ++; else fail++;
+  tests++; if (T_mulhi_sizet()) succ++; else fail++;
+  tests++; if (T_mulhi_s8()) succ++; else fail++;
+  tests++; if (T_mulhi_s16()) succ++; else fail++;
+  tests++; if (T_mulhi_s32()) succ++; else fail++;
+  tests++; if (T_mulhi_s64()) succ++; else fail++;
+  tests++; if (T_mul_full()) succ++; else fail++;
+#endif
+  tests++; if (T_mul_full_fixed()) succ++; else fail++;
+  tests++; if (T_mulhi_fixed()) succ++; else fail++;
+  tests++; if (T_rescale_fixed()) succ++; else fail++;
+  tests++; if (T_muladd_fixed()) succ++; else fail++;
+  tests++; if (T_dot_fixed()) succ++; else fail++;
+  tests++; if (T_neg_s8()) succ++; else fail++;
+  tests++; if (T_neg_u32()) succ++; else fail++;
+  tests++; if (T_abs_s64()) succ++; else fail++;
+  tests++; if (T_absdiff_s32()) succ++; else fail++;
+  tests++; if (T_absdiff_u8()) succ++; else fail++;
+  tests++; if (T_ceil_div_s32()) succ++; else fail++;
+  tests++; if (T_align_up_u8()) succ++; else fail++;
+  tests++; if (T_round_up_multiple_u16()) succ++; else fail++;
+  tests++; if (T_next_pow2_u64()) succ++; else fail++;
+  tests++; if (T_mulsub_u32()) succ++; else fail++;
+  tests++; if (T_mulsub_s8()) succ++; else fail++;
   /* TODO TODO
   tests++; if (T_iopf_add_u8u8s16()) succ++; else fail++;
   tests++; if (T_iopf_add_s16u8u8()) succ++; else fail++;
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
+#include <safe_iop.hpp>
+
+#define EXPECT_FALSE(cmd) { \
+  printf("%s:%d:%s: EXPECT_FALSE(" #cmd ") => ", __FILE__, __LINE__, __func__); \
+  if ((cmd) != 0) { printf(" FAILED\n"); expect_fail++; r = 0; } \
+  else { printf(" PASSED\n"); expect_succ++; } \
+  expect++; \
+  }
+#define EXPECT_TRUE(cmd) { \
+  printf("%s:%d:%s: EXPECT_TRUE(" #cmd ") => ", __FILE__, __LINE__, __func__); \
+  if ((cmd) != 1) { printf(" FAILED\n"); expect_fail++; r = 0; } \
+  else { printf(" PASSED\n"); expect_succ++; } \
+  expect++; \
+  }
+/* Not perfect, but good for basic debugging */
+#define EXPECT_EQUAL(lhs,rhs) { \
+  printf("%s:%d:%s: EXPECT_EQUAL(" #lhs " == " #rhs ") -> ", \
+         __FILE__, __LINE__, __func__); \
+  if ((lhs) != (rhs)) { printf(" FAILED\n"); expect_fail++; r = 0; } \
+  else { printf(" PASSED\n"); expect_succ++; } \
+  expect++; \
+  }
+
+static int expect = 0, expect_succ = 0, expect_fail = 0;
+
+/* Formats are checked while compiling */
+static_assert(sop::detail::compile("u32+s16/u64").ok);
+static_assert(sop::detail::compile("#u64 = u32*(u32+u8) << u8").ok);
+static_assert(sop::detail::compile("u16**+").nargs == 4);
+static_assert(sop::detail::compile("u32*u32").lhs == sop::detail::type::u32);
+static_assert(sop::detail::compile("u64=u32*u32").lhs ==
+              sop::detail::type::u64);
+static_assert(!sop::detail::compile("").ok);
+static_assert(!sop::detail::compile("(s32+s32").ok);
+static_assert(!sop::detail::compile("s32+s32)").ok);
+static_assert(!sop::detail::compile("s32<s32").ok);
+static_assert(!sop::detail::compile("s32+u7").ok);
+static_assert(!sop::detail::compile("s32 s32").ok);
+static_assert(!sop::detail::compile("u8=u32=u32").ok);
+
+int T_cxx_sopf_basic() {
+  int r=1;
+  uint32_t a = 10, u32 = 0;
+  int16_t b = 20;
+  uint64_t c = 2;
+  int32_t s32 = 0;
+  bool ok;
+  EXPECT_TRUE(sop::sopf<"u32+s16/u64">(&u32, a, b, c));
+  EXPECT_EQUAL(u32, 20);
+  EXPECT_TRUE(sop::sopf<"(u32+s16)/u64">(&u32, a, b, c));
+  EXPECT_EQUAL(u32, 15);
+  EXPECT_TRUE(sop::sopf<"s32-s32">(&s32, 1, 5));
+  EXPECT_EQUAL(s32, -4);
+  EXPECT_TRUE(sop::sopf<"u16**+">(&u32, 2, 3, 4, 5));
+  EXPECT_EQUAL(u32, 29);
+  /* u32 does not go below 0 */
+  EXPECT_FALSE(sop::sopf<"u32-u32">(&u32, 1, 5));
+  EXPECT_EQUAL(u32, 29);
+  EXPECT_FALSE(sop::sopf<"u32/u32">(&u32, 1, 0));
+  EXPECT_FALSE(sop::sopf<"u8<<u8">(&u32, 1, 8));
+  EXPECT_TRUE(sop::sopf<"u8<<u8">(&u32, 1, 7));
+  EXPECT_EQUAL(u32, 128);
+  /* NULL results only check */
+  ok = sop::sopf<"u32%u32">((uint32_t *) NULL, 7, 3);
+  EXPECT_TRUE(ok);
+  ok = sop::sopf<"u32%u32">((uint32_t *) NULL, 7, 0);
+  EXPECT_FALSE(ok);
+  ok = sop::sopf<"u32*u32">(NULL, 65536, 65535);
+  EXPECT_TRUE(ok);
+  ok = sop::sopf<"u32*u32">(NULL, 65536, 65536);
+  EXPECT_FALSE(ok);
+  ok = sop::sopf<"u64=u32*u32">(nullptr, 65536, 65536);
+  EXPECT_TRUE(ok);
+  return r;
+}
+
+int T_cxx_sopf_types() {
+  int r=1;
+  uint32_t w = UINT_MAX, h = UINT_MAX;
+  uint64_t u64 = 0;
+  uint8_t u8 = 0;
+  /* arguments are range checked against their markers */
+  EXPECT_FALSE(sop::sopf<"u8+u8">(&u8, 256, 1));
+  EXPECT_FALSE(sop::sopf<"u32+u32">(&u64, -1, 1));
+  /* and the result against *result */
+  EXPECT_FALSE(sop::sopf<"u32+u32">(&u8, 255, 1));
+  EXPECT_EQUAL(u8, 0);
+  EXPECT_TRUE(sop::sopf<"u32+u32">(&u8, 254, 1));
+  EXPECT_EQUAL(u8, 255);
+  EXPECT_FALSE(sop::sopf<"u32*u32">(&u64, w, h));
+  EXPECT_TRUE(sop::sopf<"u64=u32*u32">(&u64, w, h));
+  EXPECT_EQUAL(u64, (uint64_t) UINT_MAX * UINT_MAX);
+  EXPECT_FALSE(sop::sopf<"u32*u32/u32">(&u64, 65536, 65536, 256));
+  EXPECT_TRUE(sop::sopf<"#u32*u32/u32">(&u64, 65536, 65536, 256));
+  EXPECT_EQUAL(u64, 16777216);
+  EXPECT_FALSE(sop::sopf<"#u8=u32*u32">(&u8, 1000, 999));
+  EXPECT_TRUE(sop::sopf<"#u8=u32-u32">(&u8, 1000, 999));
+  EXPECT_EQUAL(u8, 1);
+  return r;
+}
+
+int main(int argc, char **argv) {
+  int tests = 0, succ = 0, fail = 0;
+  (void) argc;
+  (void) argv;
+  tests++; if (T_cxx_sopf_basic()) succ++; else fail++;
+  tests++; if (T_cxx_sopf_types()) succ++; else fail++;
+
+  printf("%d/%d expects succeeded (%d failures)\n",
+         expect_succ, expect, expect_fail);
+  printf("%d/%d tests succeeded (%d failures)\n", succ, tests, fail);
+  return fail;
+}
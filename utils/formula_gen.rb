@@ -0,0 +1,264 @@
+#!/usr/bin/ruby -w
+# License:: BSD (see LICENSE)
+# Author:: Will Drewry <redpig@dataspill.org>
+#
+# formula_gen.rb - compiles sopf formulas into checked C functions
+#
+# Usage: ruby -Iutils utils/formula_gen.rb formulas.txt > formulas.h
+#
+# Each non-blank line of the input names one formula:
+#
+#   # comment
+#   image_bytes(w, h, bpp, pad): u64=u32*u32*u32+u16
+#   pages: (szt+szt)/szt
+#
+# The formula uses the sopf format language (see safe_iop.h): C precedence,
+# parentheses, a leading '#' for wide intermediates and "<type>=" for an
+# explicit result type.  Any markup type from safe_iop.h is accepted as a
+# type marker (u8 ... s64, szt, sszt, ui, ul, ull, ...).  Argument names are
+# optional and default to a, b, c, ...
+#
+# For every formula this emits
+#   static inline int <name>(<lhs type> *result, <args...>)
+# which returns 1 and stores the value on success, or 0 leaving *result
+# untouched on failure.  result may be NULL.  The body is the straight-line
+# sequence of sop_safe_cast checks and same-type sop_[su]<op> macros the
+# formula describes, so there is no runtime parsing and nothing to link.
+
+require 'supported_types'
+
+# Longest prefixes first so that "ull" is not read as "ul" and a stray "l".
+TYPES = SupportedTypes::TYPES.sort_by { |t| -t.prefix.length }
+DEFAULT_TYPE = SupportedTypes::TYPES.find { |t| t.prefix == 's32' }
+
+# Same table as _sopf_read_op in src/safe_iop.c
+OPERATORS = [
+  ['<<', 'shl', 1], ['>>', 'shr', 1],
+  ['+', 'add', 2], ['-', 'sub', 2],
+  ['*', 'mul', 3], ['/', 'div', 3], ['%', 'mod', 3],
+]
+PREC_SHIFT = 1
+MAX_DEPTH = 16
+
+class FormulaError < StandardError; end
+
+# Turns one sopf format into a postfix program, the same way sopf_compile
+# does: operands in argument order with each operator after its operands.
+class Formula
+  attr_reader :name, :format, :lhs, :wide, :args, :insns
+
+  def initialize(name, format)
+    @name = name
+    @format = format
+    @s = format
+    @pos = 0
+    @lhs = DEFAULT_TYPE
+    @wide = false
+    @result_given = false
+    @nesting = 0
+    @depth = 0
+    @args = []    # operand types, in argument order
+    @insns = []   # [:arg, index] or [:op, name]
+    compile
+  end
+
+  private
+
+  def fail(why)
+    raise FormulaError, "#{@name}: #{why} at offset #{@pos} in '#{@format}'"
+  end
+
+  def peek(n = 1) @s[@pos, n] || ''; end
+
+  def skip_space
+    @pos += 1 while peek == ' ' || peek == "\t"
+  end
+
+  def read_type
+    t = TYPES.find { |x| @s[@pos, x.prefix.length] == x.prefix }
+    @pos += t.prefix.length if t
+    t
+  end
+
+  def compile
+    fail('empty formula') if @s.empty?
+    if peek == '#'
+      @wide = true
+      @pos += 1
+    end
+    parse_result
+    parse_expr(PREC_SHIFT)
+    fail('unexpected character') if @pos != @s.length
+    fail('unbalanced expression') if @depth != 1
+  end
+
+  # result := [type_marker '=']
+  def parse_result
+    skip_space
+    start = @pos
+    t = read_type
+    if t
+      skip_space
+      if peek == '='
+        @lhs = t
+        @result_given = true
+        @pos += 1
+        return
+      end
+    end
+    @pos = start
+  end
+
+  # primary := '(' expr ')' | [type_marker]
+  def parse_primary
+    skip_space
+    if peek == '('
+      @nesting += 1
+      fail('too deeply nested') if @nesting > MAX_DEPTH
+      @pos += 1
+      parse_expr(PREC_SHIFT)
+      skip_space
+      fail("expected ')'") if peek != ')'
+      @pos += 1
+      @nesting -= 1
+    else
+      t = read_type || @lhs
+      @lhs = t if @args.empty? and not @result_given
+      @insns << [:arg, @args.length]
+      @args << t
+      @depth += 1
+      fail('stack too deep') if @depth > MAX_DEPTH
+    end
+    skip_space
+  end
+
+  def parse_expr(min_prec)
+    parse_primary
+    loop do
+      skip_space
+      op = OPERATORS.find { |o| peek(o[0].length) == o[0] }
+      break if op.nil? or op[2] < min_prec
+      @pos += op[0].length
+      parse_expr(op[2] + 1)
+      @insns << [:op, op[1]]
+      @depth -= 1
+    end
+  end
+end
+
+# Emits the C for a compiled formula.
+def emit(f, names)
+  sign = lambda { |t| t.signed ? 1 : 0 }
+  work = f.wide ? 'sop_gen_wide_t' : f.lhs.name
+  params = f.args.each_with_index.map { |t, i| "#{t.name} #{names[i]}" }
+  stack = []
+  tmp = 0
+  body = []
+
+  f.insns.each do |kind, v|
+    if kind == :arg
+      t = f.args[v]
+      var = "_t#{tmp}"
+      tmp += 1
+      if f.wide
+        body << "  if (!sop_safe_cast(1, #{work}, 0, #{sign[t]}, #{t.name}, #{names[v]}))"
+      else
+        body << "  if (!sop_safe_cast(#{sign[f.lhs]}, #{work}, 0, #{sign[t]}, #{t.name}, #{names[v]}))"
+      end
+      body << "    return 0;"
+      body << "  #{var} = (#{work}) #{names[v]};"
+      stack << var
+    else
+      b = stack.pop
+      a = stack.pop
+      s = (f.wide or f.lhs.signed) ? 1 : 0
+      m = "sop_#{s == 1 ? 's' : 'u'}#{v}"
+      body << "  if (!#{m}(#{s}, #{work}, &#{a}, #{s}, #{work}, #{a}, #{s}, #{work}, #{b}))"
+      body << "    return 0;"
+      stack << a
+    end
+  end
+  final = stack.pop
+  if f.wide
+    body << "  /* single range check of the wide result */"
+    body << "  if (!sop_safe_cast(#{sign[f.lhs]}, #{f.lhs.name}, 0, 1, #{work}, #{final}))"
+    body << "    return 0;"
+  end
+  body << "  if (result)"
+  body << "    *result = (#{f.lhs.name}) #{final};"
+  body << "  return 1;"
+
+  decl = (0...tmp).map { |i| "_t#{i}" }.join(', ')
+  print "/* #{f.name}: #{f.format} */\n"
+  print "static inline int #{f.name}(#{f.lhs.name} *result"
+  params.each { |p| print ",\n    #{p}" }
+  print ") {\n"
+  print "  #{work} #{decl};\n"
+  print body.join("\n"), "\n"
+  print "}\n\n"
+end
+
+if ARGV.length != 1
+  $stderr.print "usage: #{$0} <formula file>\n"
+  exit 1
+end
+
+input = ARGV[0]
+guard = '_' + File.basename(input).upcase.gsub(/[^A-Z0-9]/, '_') + '_H'
+formulas = []
+seen = {}
+
+File.readlines(input).each_with_index do |line, lineno|
+  # '#' also starts wide formulas, so only whole lines are comments.
+  next if line =~ /\A\s*(#|\z)/
+  m = /\A\s*([A-Za-z_]\w*)\s*(?:\(([^)]*)\))?\s*:\s*(.*?)\s*\z/.match(line)
+  begin
+    raise FormulaError, "malformed line" if m.nil?
+    name, arglist, format = m[1], m[2], m[3]
+    raise FormulaError, "#{name}: defined twice" if seen[name]
+    seen[name] = true
+    f = Formula.new(name, format)
+    names = arglist ? arglist.split(',').map { |a| a.strip } :
+                      (0...f.args.length).map { |i| ('a'.ord + i).chr }
+    if names.length != f.args.length
+      raise FormulaError, "#{name}: #{names.length} names for #{f.args.length} operands"
+    end
+    if names.uniq.length != names.length or names.include?('result') or
+       names.any? { |a| a !~ /\A[A-Za-z]\w*\z/ }
+      raise FormulaError, "#{name}: bad argument names"
+    end
+    formulas << [f, names]
+  rescue FormulaError => e
+    $stderr.print "#{input}:#{lineno + 1}: #{e.message}\n"
+    exit 1
+  end
+end
+
+print <<-EOF
+/* Checked formulas
+ *
+ * NOTE: This file is automatically generated by 'formula_gen.rb' from
+ * '#{File.basename(input)}'.  Do not edit.
+ */
+#ifndef #{guard}
+#define #{guard}
+
+#include <safe_iop.h>
+
+EOF
+
+if formulas.any? { |f, _| f.wide }
+  print <<-EOF
+/* "#" formulas evaluate in the widest type available, as sopf does. */
+#if defined(__SIZEOF_INT128__)
+typedef __int128 sop_gen_wide_t;
+#else
+typedef intmax_t sop_gen_wide_t;
+#endif
+
+  EOF
+end
+
+formulas.each { |f, names| emit(f, names) }
+
+print "#endif  /* #{guard} */\n"